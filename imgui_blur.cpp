@@ -1,517 +1,2115 @@
 #include "imgui_blur.h"
-#include "imgui_impl_dx11.h"
+#include "imgui_blur_internal.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#ifndef IMGUI_BLUR_FRAMES_IN_FLIGHT
+#define IMGUI_BLUR_FRAMES_IN_FLIGHT 3
+#endif
+
+#ifndef IMGUI_BLUR_ARENA_SIZE
+#define IMGUI_BLUR_ARENA_SIZE (64 * 1024) // bytes of parameters and regions per frame
+#endif
+
+// Per-frame bump allocator shared by every recording thread. Each frame owns one block of the ring, tagged with the
+// frame number in the high half of its state and the bytes in use in the low half, so claiming a block for a new frame
+// and allocating from it are both a single compare-and-swap. A block is reclaimed IMGUI_BLUR_FRAMES_IN_FLIGHT frames
+// later, by then the draw callbacks reading it have run.
+class FrameArena {
+public:
+    void* allocate(ImU32 frame, ImU32 size, ImU32& offset) {
+        size = (size + 15) & ~15u;
+        Block& block = blocks[frame % IMGUI_BLUR_FRAMES_IN_FLIGHT];
+        ImU64 state = block.state.load(std::memory_order_acquire);
+        for (;;) {
+            const ImU32 tag = (ImU32)(state >> 32);
+            if (tag != frame && (int)(frame - tag) < 0)
+                return nullptr; // the block already belongs to a later frame
+
+            const ImU32 used = tag == frame ? (ImU32)state : 0;
+            if (used + size > IMGUI_BLUR_ARENA_SIZE)
+                return nullptr;
+
+            if (block.state.compare_exchange_weak(state, (ImU64)frame << 32 | (used + size), std::memory_order_acq_rel, std::memory_order_acquire)) {
+                offset = used;
+                return block.memory + used;
+            }
+        }
+    }
 
-#include <d3dcompiler.h>
-#pragma comment(lib, "d3dcompiler.lib")
+    void* resolve(ImU32 frame, ImU32 offset) const {
+        const Block& block = blocks[frame % IMGUI_BLUR_FRAMES_IN_FLIGHT];
+        const ImU64 state = block.state.load(std::memory_order_acquire);
+        if ((ImU32)(state >> 32) != frame || offset >= (ImU32)state)
+            return nullptr;
+        return (void*)(block.memory + offset);
+    }
 
-#include <d3d11.h>
-#pragma comment(lib, "d3d11.lib")
+private:
+    class Block {
+    public:
+        std::atomic<ImU64> state{ 0 };
+        alignas(16) unsigned char memory[IMGUI_BLUR_ARENA_SIZE];
+    };
 
-static const char* g_vertex_src = R"(
-struct VS_INPUT {
-    float2 pos : POSITION;
-    float2 uv : TEXCOORD0;
+    Block blocks[IMGUI_BLUR_FRAMES_IN_FLIGHT];
 };
 
-struct PS_INPUT {
-    float4 pos : SV_POSITION;
-    float2 uv : TEXCOORD0;
+static blur::Backend* g_backend = nullptr;
+
+// What a chain's output holds right now, so unchanged frames can keep it.
+class ChainCache {
+public:
+    bool valid = false;
+    bool output_valid = false; // Chain::output holds the result too, not just level 0
+    bool levels_valid = false; // levels 1..iterations hold the downsampled frame, see BlurParameters::levels_requested
+    blur::Algorithm algorithm = blur::Algorithm_Kawase;
+    int iterations = 0;
+    float offset = 0.0f, noise = 0.0f, scale = 0.0f;
+    blur::PyramidFormat format = blur::PyramidFormat_Auto, deep_format = blur::PyramidFormat_Auto;
+    int deep_level = 0;
+    blur::RegionSet regions;
+    double time = 0.0;
+    // ProcessFlags_Incremental: output pixels changed since the result was computed, known while every frame in
+    // between reported its damage to a callback of this chain.
+    blur::RegionSet damage;
+    bool damage_known = false;
+    int damage_frame = -1; // last frame whose damage was added
 };
 
-PS_INPUT main(VS_INPUT input) {
-    PS_INPUT output;
-    output.pos = float4(input.pos, 0.0f, 1.0f);
-    output.uv = input.uv;
-    return output;
-}
-)";
+class BlurContext;
 
-static const char* g_downsample_src = R"(
-cbuffer BlurConstants : register(b0) {
-    float2 half_pixel;
-    float offset;
-    float noise;
+class CachedChain : public blur::Chain {
+public:
+    BlurContext* context = nullptr;
+    ChainCache cache;
+    // Parameters of the last process() call that claimed this chain, used to match the next frame's calls.
+    blur::Algorithm algorithm = blur::Algorithm_Kawase;
+    int iterations = 0;
+    float offset = 0.0f, noise = 0.0f, scale = 0.0f;
+    bool incremental = false;
+    ImU32 claimed = 0; // frame
+    ImU32 output_requested = 0; // frame get_texture() last asked for the output
+    // A draw callback is running the chain outside g_chains_mutex. Until it is done the callback owns the levels, the
+    // scratch framebuffers and the graph, and only it changes the output.
+    bool running = false;
 };
 
-Texture2D input_texture : register(t0);
-SamplerState input_sampler : register(s0);
+// Chains of one ImGuiViewport. Each viewport renders into its own framebuffer, usually of its own size, so it claims
+// among its own chains instead of resizing the ones another viewport just used.
+class ViewportPyramids {
+public:
+    ImGuiID id = 0;
+    ImVector<CachedChain*> chains;
+};
 
-float4 main(float4 pos : SV_POSITION, float2 uv : TEXCOORD) : SV_Target {
-    float4 sum = input_texture.Sample(input_sampler, uv) * 4.0;
-    sum += input_texture.Sample(input_sampler, uv - half_pixel * offset);
-    sum += input_texture.Sample(input_sampler, uv + half_pixel * offset);
-    sum += input_texture.Sample(input_sampler, uv + float2(half_pixel.x, -half_pixel.y) * offset);
-    sum += input_texture.Sample(input_sampler, uv - float2(half_pixel.x, -half_pixel.y) * offset);
-    float4 result = sum / 8.0;
-    if (noise > 0.0) {
-        result.rgb += ((frac(sin(dot(pos.xy, float2(12.9898, 78.233))) * 43758.5453) 
-                      + frac(sin(dot(pos.xy * 0.1, float2(7.898, 4.233))) * 23421.631)) * 0.5 - 0.5) 
-                      * noise * 0.3;
-    }
-    return result;
-}
-)";
+// A draw command as add_damage(draw_data) saw it last frame.
+class CommandRecord {
+public:
+    ImVec4 bounds; // display space, empty for callbacks that draw nothing
+    ImU64 hash;
+};
 
-static const char* g_upsample_src = R"(
-cbuffer BlurConstants : register(b0) {
-    float2 half_pixel;
-    float offset;
-    float noise;
+// The draw commands of one viewport. Only the thread rendering the draw data calls add_damage(draw_data). Records are
+// double buffered, so diffing allocates nothing once they have grown.
+class CommandHistory {
+public:
+    ImGuiID viewport = 0;
+    int frame = -1;
+    ImVector<CommandRecord> records;
+    ImVector<int> lists; // first record of each draw list, then the end
+    ImVector<CommandRecord> next_records;
+    ImVector<int> next_lists;
 };
 
-Texture2D input_texture : register(t0);
-SamplerState input_sampler : register(s0);
-
-float4 main(float4 pos : SV_POSITION, float2 uv : TEXCOORD) : SV_Target {
-    float4 sum = input_texture.Sample(input_sampler, uv + float2(-half_pixel.x * 2.0, 0.0) * offset);
-    sum += input_texture.Sample(input_sampler, uv + float2(-half_pixel.x, half_pixel.y) * offset) * 2.0;
-    sum += input_texture.Sample(input_sampler, uv + float2(0.0, half_pixel.y * 2.0) * offset);
-    sum += input_texture.Sample(input_sampler, uv + float2(half_pixel.x, half_pixel.y) * offset) * 2.0;
-    sum += input_texture.Sample(input_sampler, uv + float2(half_pixel.x * 2.0, 0.0) * offset);
-    sum += input_texture.Sample(input_sampler, uv + float2(half_pixel.x, -half_pixel.y) * offset) * 2.0;
-    sum += input_texture.Sample(input_sampler, uv + float2(0.0, -half_pixel.y * 2.0) * offset);
-    sum += input_texture.Sample(input_sampler, uv + float2(-half_pixel.x, -half_pixel.y) * offset) * 2.0;
-    float4 result = sum / 12.0;
-    if (noise > 0.0) {
-        result.rgb += ((frac(sin(dot(pos.xy, float2(12.9898, 78.233))) * 43758.5453) 
-                      + frac(sin(dot(pos.xy * 0.1, float2(7.898, 4.233))) * 23421.631)) * 0.5 - 0.5) 
-                      * noise * 0.3;
-    }
-    return result;
-}
-)";
-
-class Framebuffer {
+// An ImGuiViewport as the first process() call of a frame saw it.
+class ViewportRect {
 public:
-    void destroy() {
-        if (tex != nullptr) { tex->Release(); tex = nullptr; }
-        if (rtv != nullptr) { rtv->Release(); rtv = nullptr; }
-        if (srv != nullptr) { srv->Release(); srv = nullptr; }
-    }
+    ImGuiID id;
+    ImVec2 pos, size;
+};
 
-    ID3D11Texture2D* tex = nullptr;
-    ID3D11RenderTargetView* rtv = nullptr;
-    ID3D11ShaderResourceView* srv = nullptr;
-    int width = 0, height = 0;
+class FrameCounters {
+public:
+    int frame = -1;
+    int counts[blur::Counter_COUNT] = {};
 };
 
-class BlurConstants {
+// The blur state of one ImGuiContext. Frame numbers and snapshots only mean something within a context, so each has
+// its own arena, pyramids, stats and adaptive controller; the backend with its shaders and samplers and the texture
+// pool are shared by every context.
+class BlurContext {
 public:
-    ImVec2 half_pixel;
-    float offset;
-    float noise;
+    ImGuiContext* imgui_context = nullptr;
+    FrameArena arena;
+    ImVector<ViewportPyramids*> viewports; // guarded by g_chains_mutex
+    ImVector<ViewportRect> viewport_rects;   // main viewport first, guarded by g_chains_mutex
+    ImU32 viewport_rects_frame = 0;
+    std::thread::id viewport_thread; // the first to copy the viewports, the main thread unless it was misused
+    ImVector<CommandHistory*> command_histories;
+
+    // Guarded by g_stats_mutex.
+    FrameCounters counting; // the frame ImGui is on
+    FrameCounters counted;  // the one before
+    int framebuffers_created_total = 0;
+    blur::Stats timing_sum; // pass times of 'timed_frame' so far, published once a later frame shows up
+    blur::Stats timed;      // last published pass times
+    float history[blur::Stats::history_size] = {};
+    int history_next = 0;
+
+    blur::AdaptiveController adaptive; // guarded by g_adaptive_mutex
 };
 
-class BlurParameters {
+// Guards the context list and nothing else, so it can be taken under any other lock. A context is created by the first
+// call that needs one and lives until destroy_context() or destroy().
+static std::mutex g_contexts_mutex;
+static ImVector<BlurContext*> g_contexts{};
+static std::atomic<ImU32> g_contexts_generation{ 0 }; // bumped whenever a context is destroyed
+static thread_local BlurContext* g_thread_context = nullptr;
+static thread_local ImU32 g_thread_generation = 0;
+static thread_local blur::Snapshot g_last_snapshot = 0;
+static thread_local const BlurContext* g_last_snapshot_context = nullptr;
+
+// Guards the chains, their caches and outputs. process() may run on several recording threads while the draw
+// callbacks of an earlier frame run the chains on the rendering thread. A callback only holds it to look at the cache
+// before the run and to store the result after it, see CachedChain::running.
+static std::mutex g_chains_mutex;
+// Chains with CachedChain::running set, notified through g_chain_finished whenever a run ends.
+static int g_running_chains = 0;
+static std::condition_variable g_chain_finished;
+// Settings any thread may change while process() reads them on the recording threads.
+static std::atomic<double> g_refresh_interval{ 0.0 };
+static std::atomic<blur::PyramidFormat> g_pyramid_format{ blur::PyramidFormat_Auto };
+static std::atomic<blur::PyramidFormat> g_deep_format{ blur::PyramidFormat_Auto };
+static std::atomic<int> g_deep_level{ 2 };
+static blur::FramebufferPool g_pool{};
+static size_t g_pool_budget = 32 * 1024 * 1024;
+
+// Until no draw callback runs 'chain', or any chain when it is null. Lets go of g_chains_mutex while waiting.
+static void wait_for_chains(std::unique_lock<std::mutex>& lock, const CachedChain* chain = nullptr) {
+    g_chain_finished.wait(lock, [chain] { return chain != nullptr ? !chain->running : g_running_chains == 0; });
+}
+
+// Guards the counters and the published pass times of every context, taken after g_chains_mutex when both are needed.
+static std::mutex g_stats_mutex;
+
+// Chains whose timer queries are in flight, slot id % IMGUI_BLUR_TIMER_QUERY_SETS. Ids only advance when a backend
+// accepted the queries, so the sets in flight never share a slot. Only draw callbacks touch these.
+class PendingTiming {
 public:
-    int iterations = 4;
-    float offset = 3.0f;
-    float noise = 0.0f;
-    float scale = 1.0f;
+    BlurContext* context = nullptr; // nullptr once the context is destroyed, its results are dropped
+    int frame = 0;
+    blur::ChainTiming timing{};
 };
 
-static ImVector<BlurParameters*> g_blur_parameters_current{};
-static ImVector<BlurParameters*> g_blur_parameters_previous{};
-
-static ID3D11Device* g_device = nullptr;
-static ID3D11PixelShader* g_downsample = nullptr;
-static ID3D11PixelShader* g_upsample = nullptr;
-static ID3D11VertexShader* g_vertex = nullptr;
-static ID3D11InputLayout* g_input_layout = nullptr;
-static ID3D11Buffer* g_constant_buffer = nullptr;
-static ID3D11Buffer* g_vertex_buffer = nullptr;
-static ID3D11SamplerState* g_linear_sampler = nullptr;
-static ID3D11SamplerState* g_mirror_sampler = nullptr;
-static ID3D11RasterizerState* g_rasterizer_state = nullptr;
-static ID3D11DepthStencilState* g_depth_stencil_state = nullptr;
-static ImVector<Framebuffer> g_framebuffers{};
-static Framebuffer g_framebuffer{};
-static int g_last_iterations = 0;
-static int g_last_width = 0;
-static int g_last_height = 0;
-
-static bool create_framebuffer(ID3D11Device* device, Framebuffer& framebuffer, int width, int height) {
-    D3D11_TEXTURE2D_DESC tex_desc = {};
-    tex_desc.Width = width;
-    tex_desc.Height = height;
-    tex_desc.MipLevels = 1;
-    tex_desc.ArraySize = 1;
-    tex_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-    tex_desc.SampleDesc.Count = 1;
-    tex_desc.Usage = D3D11_USAGE_DEFAULT;
-    tex_desc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+static PendingTiming g_pending_timings[IMGUI_BLUR_TIMER_QUERY_SETS];
+static ImU32 g_next_timing_id = 0;
+
+class StatsTimer : public blur::FrameTimer {
+public:
+    bool measure(int& frame, float& ms) override {
+        const blur::Stats stats = blur::get_stats();
+        frame = stats.timed_frame;
+        ms = stats.total_ms;
+        return frame >= 0;
+    }
+};
+
+// Guards the controllers, adaptive calls may come from several recording threads. Taken before any other lock.
+static std::mutex g_adaptive_mutex;
+static StatsTimer g_stats_timer{};
+static blur::FrameTimer* g_adaptive_timer = &g_stats_timer;
+
+
+static int clamp_int(int v, int mn, int mx) {
+    return v < mn ? mn : v > mx ? mx : v;
+}
+
+static double now_ms() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int level_size(int size, int level) {
+    size >>= level;
+    return size > 0 ? size : 1;
+}
+
+// Rounds up to an eighth of the next power of two, at least 16 texels.
+static int bucket_size(int size) {
+    size = size > 1 ? size : 1;
+    int step = 16;
+    while (step * 8 < size)
+        step <<= 1;
+    return (size + step - 1) / step * step;
+}
+
+static long long texture_area(const blur::Framebuffer& framebuffer) {
+    return (long long)framebuffer.texture_width * framebuffer.texture_height;
+}
+
+int blur::format_bytes(Format format) {
+    switch (format) {
+    case Format_RGBA16F: return 8;
+    case Format_RGB565: return 2;
+    default: return 4;
+    }
+}
+
+static size_t texture_bytes(const blur::Framebuffer& framebuffer) {
+    return (size_t)texture_area(framebuffer) * blur::format_bytes(framebuffer.format);
+}
+
+// Anything that holds the size and is at most twice its bucket, so shrinking does not reallocate right away.
+static bool framebuffer_fits(const blur::Framebuffer& framebuffer, int width, int height, blur::Format format) {
+    return framebuffer.handle != nullptr && framebuffer.format == format
+        && framebuffer.texture_width >= width && framebuffer.texture_height >= height
+        && texture_area(framebuffer) <= (long long)bucket_size(width) * bucket_size(height) * 2;
+}
+
+blur::Framebuffer blur::FramebufferPool::acquire(Backend* backend, int width, int height, Format format) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return acquire_locked(backend, width, height, format);
+}
+
+void blur::FramebufferPool::release(Framebuffer& framebuffer) {
+    std::lock_guard<std::mutex> lock(mutex);
+    release_locked(framebuffer);
+}
+
+blur::Framebuffer blur::FramebufferPool::acquire_locked(Backend* backend, int width, int height, Format format) {
+    int best = -1;
+    for (int i = 0; i < idle.Size; ++i) {
+        const Framebuffer& candidate = idle[i].framebuffer;
+        if (framebuffer_fits(candidate, width, height, format) && (best < 0 || texture_area(candidate) < texture_area(idle[best].framebuffer)))
+            best = i;
+    }
+
+    Framebuffer framebuffer;
+    if (best >= 0) {
+        framebuffer = idle[best].framebuffer;
+        idle.erase(idle.Data + best);
+    } else {
+        const int texture_width = bucket_size(width);
+        const int texture_height = bucket_size(height);
+        // LOG_DEBUG("allocating {}x{} framebuffer", texture_width, texture_height);
+        if (!backend->create_framebuffer(framebuffer, texture_width, texture_height, format)) {
+            backend->destroy_framebuffer(framebuffer);
+            return Framebuffer{};
+        }
+        count(Counter_FramebuffersCreated);
+        framebuffer.texture_width = texture_width;
+        framebuffer.texture_height = texture_height;
+        framebuffer.format = format;
+    }
 
     framebuffer.width = width;
     framebuffer.height = height;
+    return framebuffer;
+}
 
-    if (FAILED(device->CreateTexture2D(&tex_desc, nullptr, &framebuffer.tex)))
-        return false;
+void blur::FramebufferPool::release_locked(Framebuffer& framebuffer) {
+    if (framebuffer.handle != nullptr)
+        idle.push_back({ framebuffer, ++clock });
+    framebuffer = Framebuffer{};
+}
 
-    if (FAILED(device->CreateRenderTargetView(framebuffer.tex, nullptr, &framebuffer.rtv)))
-        return false;
+bool blur::FramebufferPool::resize(Backend* backend, Framebuffer& framebuffer, int width, int height, Format format) {
+    if (!framebuffer_fits(framebuffer, width, height, format)) {
+        std::lock_guard<std::mutex> lock(mutex);
+        release_locked(framebuffer);
+        framebuffer = acquire_locked(backend, width, height, format);
+    }
 
-    return SUCCEEDED(device->CreateShaderResourceView(framebuffer.tex, nullptr, &framebuffer.srv));
+    framebuffer.width = width;
+    framebuffer.height = height;
+    return framebuffer.handle != nullptr;
 }
 
-static bool create_vertex_shader(ID3D11Device* device, const char* shader_src, const char* name, const char* main, const char* target, ID3D11VertexShader** out_shader) {
-    ID3DBlob* shader_blob = nullptr;
-    ID3DBlob* error_blob = nullptr;
-    if (FAILED(D3DCompile(shader_src, strlen(shader_src), nullptr, nullptr, nullptr, main, target, 0, 0, &shader_blob, &error_blob))) {
-        if (error_blob == nullptr) {
-            // LOG_ERROR("shader {} failed to compile unexpectedly", name);
-            return false;
+void blur::FramebufferPool::trim(Backend* backend, size_t budget) {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t bytes = 0;
+    for (const Entry& entry : idle)
+        bytes += texture_bytes(entry.framebuffer);
+    while (bytes > budget) {
+        int oldest = 0;
+        for (int i = 1; i < idle.Size; ++i) {
+            if (idle[i].released < idle[oldest].released)
+                oldest = i;
         }
 
-        // LOG_ERROR("shader {} compilation failed:\n{}", name, (char*)error_blob->GetBufferPointer());
-        error_blob->Release();
-        return false;
+        bytes -= texture_bytes(idle[oldest].framebuffer);
+        backend->destroy_framebuffer(idle[oldest].framebuffer);
+        idle.erase(idle.Data + oldest);
     }
+}
 
-    if (error_blob != nullptr) error_blob->Release();
-    // LOG_TRACE("successfully compiled shader {}", name);
+void blur::FramebufferPool::clear(Backend* backend) {
+    trim(backend, 0);
+    std::lock_guard<std::mutex> lock(mutex);
+    clock = 0;
+}
 
-    if (FAILED(device->CreateVertexShader(shader_blob->GetBufferPointer(), shader_blob->GetBufferSize(), nullptr, out_shader))) {
-        // LOG_ERROR("Failed to create shader {}", name);
-        shader_blob->Release();
-        return false;
+size_t blur::FramebufferPool::idle_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t bytes = 0;
+    for (const Entry& entry : idle)
+        bytes += texture_bytes(entry.framebuffer);
+    return bytes;
+}
+
+static blur::Rect rect_union(const blur::Rect& a, const blur::Rect& b) {
+    blur::Rect rect;
+    rect.x0 = a.x0 < b.x0 ? a.x0 : b.x0;
+    rect.y0 = a.y0 < b.y0 ? a.y0 : b.y0;
+    rect.x1 = a.x1 > b.x1 ? a.x1 : b.x1;
+    rect.y1 = a.y1 > b.y1 ? a.y1 : b.y1;
+    return rect;
+}
+
+static bool rect_overlaps(const blur::Rect& a, const blur::Rect& b) {
+    return a.x0 <= b.x1 && b.x0 <= a.x1 && a.y0 <= b.y1 && b.y0 <= a.y1;
+}
+
+static long long rect_area(const blur::Rect& rect) {
+    return (long long)(rect.x1 - rect.x0) * (rect.y1 - rect.y0);
+}
+
+void blur::RegionSet::add(Rect rect) {
+    if (rect.x0 >= rect.x1 || rect.y0 >= rect.y1)
+        return;
+
+    // Absorb everything the new rectangle touches, repeating since the grown rectangle may touch more.
+    for (int i = 0; i < count; ++i) {
+        if (rect_overlaps(rects[i], rect)) {
+            rect = rect_union(rects[i], rect);
+            rects[i--] = rects[--count];
+        }
     }
 
-    D3D11_INPUT_ELEMENT_DESC layout[] = {
-        { "POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-        { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 8, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-    };
+    if (count == capacity) {
+        int best = 0;
+        long long best_growth = -1;
+        for (int i = 0; i < count; ++i) {
+            const long long growth = rect_area(rect_union(rects[i], rect)) - rect_area(rects[i]) - rect_area(rect);
+            if (best_growth < 0 || growth < best_growth) {
+                best = i;
+                best_growth = growth;
+            }
+        }
 
-    if (FAILED(device->CreateInputLayout(layout, 2, shader_blob->GetBufferPointer(),
-        shader_blob->GetBufferSize(), &g_input_layout))) {
-        // LOG_ERROR("Failed to create input layout");
+        rect = rect_union(rects[best], rect);
+        rects[best] = rects[--count];
+        add(rect);
+        return;
+    }
+
+    rects[count++] = rect;
+}
+
+bool blur::RegionSet::operator==(const RegionSet& other) const {
+    if (count != other.count)
         return false;
+    for (int i = 0; i < count; ++i) {
+        const Rect& a = rects[i];
+        const Rect& b = other.rects[i];
+        if (a.x0 != b.x0 || a.y0 != b.y0 || a.x1 != b.x1 || a.y1 != b.y1)
+            return false;
     }
+    return true;
+}
 
-    // LOG_INFO("created shader {} successfully", name);
-    shader_blob->Release();
+bool blur::RegionSet::covers(const RegionSet& other) const {
+    for (int i = 0; i < other.count; ++i) {
+        const Rect& rect = other.rects[i];
+        bool covered = false;
+        for (int j = 0; j < count && !covered; ++j)
+            covered = rects[j].x0 <= rect.x0 && rects[j].y0 <= rect.y0 && rects[j].x1 >= rect.x1 && rects[j].y1 >= rect.y1;
+        if (!covered)
+            return false;
+    }
     return true;
 }
 
-static bool create_pixel_shader(ID3D11Device* device, const char* shader_src, const char* name, const char* main, const char* target, ID3D11PixelShader** out_shader) {
-    ID3DBlob* shader_blob = nullptr;
-    ID3DBlob* error_blob = nullptr;
-    if (FAILED(D3DCompile(shader_src, strlen(shader_src), nullptr, nullptr, nullptr, main, target, 0, 0, &shader_blob, &error_blob))) {
-        if (error_blob == nullptr) {
-            LOG_ERROR("shader {} failed to compile unexpectedly", name);
+blur::PassBinds blur::BoundState::bind_pass(const void* target, const void* pass_input, const void* pass_shader, const void* pass_constants, const void* pass_kernel, int pass_width, int pass_height) {
+    PassBinds binds;
+    if (input == target) {
+        binds.unbind_input = true;
+        input = nullptr;
+    }
+    binds.viewport = width != pass_width || height != pass_height;
+    binds.shader = shader != pass_shader;
+    binds.constants = constants != pass_constants;
+    binds.kernel = pass_kernel != nullptr && kernel != pass_kernel;
+    binds.input = input != pass_input;
+
+    input = pass_input;
+    shader = pass_shader;
+    constants = pass_constants;
+    if (pass_kernel != nullptr)
+        kernel = pass_kernel;
+    width = pass_width;
+    height = pass_height;
+    return binds;
+}
+
+// Furthest tap of each kernel along x and y, in target pixels. Kawase taps are multiples of half_pixel * offset.
+static ImVec2 kernel_reach(blur::Kernel kernel, float offset) {
+    switch (kernel) {
+    case blur::Kernel_Downsample: return { offset * 0.5f, offset * 0.5f };
+    case blur::Kernel_Upsample: return { offset, offset };
+    case blur::Kernel_GaussianX: return { (float)blur::gaussian_kernel(offset).reach, 0.0f };
+    case blur::Kernel_GaussianY: return { 0.0f, (float)blur::gaussian_kernel(offset).reach };
+    case blur::Kernel_BoxX: return { (float)blur::make_box_kernel(offset).reach, 0.0f };
+    case blur::Kernel_BoxY: return { 0.0f, (float)blur::make_box_kernel(offset).reach };
+    }
+    return { 0.0f, 0.0f };
+}
+
+// Pixels of 'input' that 'kernel' reads while writing 'rect' of 'target'.
+static blur::Rect input_footprint(const blur::Rect& rect, const blur::Framebuffer& target, const blur::Framebuffer& input, blur::Kernel kernel, float offset) {
+    const float scale_x = (float)input.width / target.width;
+    const float scale_y = (float)input.height / target.height;
+    // one extra texel covers the bilinear footprint
+    const ImVec2 reach = kernel_reach(kernel, offset);
+    const float reach_x = reach.x * scale_x + 1.0f;
+    const float reach_y = reach.y * scale_y + 1.0f;
+
+    blur::Rect footprint;
+    footprint.x0 = clamp_int((int)floorf(rect.x0 * scale_x - reach_x), 0, input.width);
+    footprint.y0 = clamp_int((int)floorf(rect.y0 * scale_y - reach_y), 0, input.height);
+    footprint.x1 = clamp_int((int)ceilf(rect.x1 * scale_x + reach_x), 0, input.width);
+    footprint.y1 = clamp_int((int)ceilf(rect.y1 * scale_y + reach_y), 0, input.height);
+    return footprint;
+}
+
+// Pixels of 'target' whose taps read any of 'rect' of 'input', the inverse of input_footprint(). The kernels are
+// symmetric, so this is the same reach the other way round, with a pixel more on either side for its rounding.
+static blur::Rect output_footprint(const blur::Rect& rect, const blur::Framebuffer& target, const blur::Framebuffer& input, blur::Kernel kernel, float offset) {
+    const float scale_x = (float)input.width / target.width;
+    const float scale_y = (float)input.height / target.height;
+    const ImVec2 reach = kernel_reach(kernel, offset);
+    const float reach_x = reach.x * scale_x + 2.0f;
+    const float reach_y = reach.y * scale_y + 2.0f;
+
+    blur::Rect footprint;
+    footprint.x0 = clamp_int((int)floorf((rect.x0 - reach_x) / scale_x) - 1, 0, target.width);
+    footprint.y0 = clamp_int((int)floorf((rect.y0 - reach_y) / scale_y) - 1, 0, target.height);
+    footprint.x1 = clamp_int((int)ceilf((rect.x1 + reach_x) / scale_x) + 1, 0, target.width);
+    footprint.y1 = clamp_int((int)ceilf((rect.y1 + reach_y) / scale_y) + 1, 0, target.height);
+    return footprint;
+}
+
+// Damage is tracked and recomputed in tiles of this many pixels of each level.
+static const int g_damage_tile = 16;
+
+// Adds 'rect' grown to whole tiles of 'target' and clipped to 'regions'. Inside the regions every input texel is valid,
+// so recomputing a texel that did not change writes what it already held.
+static void add_damaged_tiles(blur::RegionSet& damaged, blur::Rect rect, const blur::Framebuffer& target, const blur::RegionSet& regions) {
+    rect.x0 = rect.x0 / g_damage_tile * g_damage_tile;
+    rect.y0 = rect.y0 / g_damage_tile * g_damage_tile;
+    rect.x1 = clamp_int((rect.x1 + g_damage_tile - 1) / g_damage_tile * g_damage_tile, 0, target.width);
+    rect.y1 = clamp_int((rect.y1 + g_damage_tile - 1) / g_damage_tile * g_damage_tile, 0, target.height);
+    for (int i = 0; i < regions.count; ++i) {
+        const blur::Rect& region = regions.rects[i];
+        damaged.add({
+            rect.x0 > region.x0 ? rect.x0 : region.x0, rect.y0 > region.y0 ? rect.y0 : region.y0,
+            rect.x1 < region.x1 ? rect.x1 : region.x1, rect.y1 < region.y1 ? rect.y1 : region.y1
+        });
+    }
+}
+
+// The passes of an incremental graph limited to the tiles 'damage' (source pixels) reaches. Every pass reads the
+// source or the target of an earlier one, and no target is written twice, so the damage of each input is known.
+static void damage_passes(const blur::PassGraph& graph, const blur::RegionSet& damage, ImVector<blur::Pass>& damaged) {
+    damaged.resize(0);
+    for (const blur::Pass& pass : graph.passes) {
+        const blur::RegionSet* input_damage = &damage;
+        for (const blur::Pass& earlier : damaged) {
+            if (earlier.target == pass.input)
+                input_damage = &earlier.regions;
+        }
+
+        blur::Pass limited = pass;
+        limited.regions = blur::RegionSet{};
+        for (int i = 0; i < input_damage->count; ++i)
+            add_damaged_tiles(limited.regions, output_footprint(input_damage->rects[i], *pass.target, *pass.input, pass.kernel, pass.offset), *pass.target, pass.regions);
+        damaged.push_back(limited);
+    }
+}
+
+class ChainPass {
+public:
+    int target, input; // slots, see compile_graph()
+    blur::Kernel kernel;
+    float offset;
+    int mark; // see ChainTiming::marks
+    blur::RegionSet regions;
+};
+
+static void mark_pass(blur::Backend* backend, blur::ChainTiming* timing, int mark) {
+    if (timing == nullptr || timing->count == blur::max_timestamps)
+        return;
+
+    if (timing->cpu)
+        timing->ms[timing->count] = (float)(now_ms() - timing->start_ms);
+    else
+        backend->timestamp();
+    timing->marks[timing->count++] = mark;
+}
+
+void blur::add_region_nodes(RegionSet& regions, const RegionNode* node, const Framebuffer& output) {
+    for (; node != nullptr; node = node->next) {
+        const ImVec4& region = node->rect;
+        regions.add({
+            clamp_int((int)floorf(region.x), 0, output.width), clamp_int((int)floorf(region.y), 0, output.height),
+            clamp_int((int)ceilf(region.z), 0, output.width), clamp_int((int)ceilf(region.w), 0, output.height)
+        });
+    }
+}
+
+blur::RegionSet blur::output_regions(const BlurParameters& parameters, const Framebuffer& output) {
+    RegionSet regions;
+    const RegionNode* node = parameters.regions.load(std::memory_order_acquire);
+    if (node == nullptr)
+        regions.add({ 0, 0, output.width, output.height });
+    add_region_nodes(regions, node, output);
+    return regions;
+}
+
+blur::Format blur::level_format(Backend* backend, const BlurParameters& parameters, Format source, int level) {
+    const bool srgb = source == Format_RGBA8_SRGB;
+    const PyramidFormat requested = level >= parameters.deep_level && parameters.deep_format != PyramidFormat_Auto ? parameters.deep_format : parameters.format;
+
+    Format format = srgb ? Format_RGBA8_SRGB : Format_RGBA8;
+    switch (requested) {
+    case PyramidFormat_Auto:
+        if (source == Format_RGB10A2)
+            format = Format_RGB10A2;
+        else if (source == Format_RGBA16F || source == Format_R11G11B10F)
+            format = Format_R11G11B10F;
+        break;
+    case PyramidFormat_RGBA8: break;
+    case PyramidFormat_RGB10A2: format = Format_RGB10A2; break;
+    case PyramidFormat_R11G11B10F: format = Format_R11G11B10F; break;
+    case PyramidFormat_RGBA16F: format = Format_RGBA16F; break;
+    case PyramidFormat_RGB565: format = Format_RGB565; break;
+    }
+
+    if (backend->supports_format(format))
+        return format;
+    return srgb && backend->supports_format(Format_RGBA8_SRGB) ? Format_RGBA8_SRGB : Format_RGBA8;
+}
+
+static bool is_separable(blur::Algorithm algorithm) {
+    return algorithm == blur::Algorithm_Gaussian || algorithm == blur::Algorithm_Box;
+}
+
+static void compile_graph(blur::PassGraph& graph, const blur::BlurParameters& parameters, const blur::Framebuffer& source, blur::Chain& chain, const blur::RegionSet& regions, bool write_output, bool keep_levels, bool incremental) {
+    using namespace blur;
+    const int iterations = parameters.iterations;
+    const float offset = parameters.offset;
+
+    // Slot 0 is the source, 1..iterations + 1 the pyramid levels, iterations + 2 the output and past it the scratch
+    // levels 1..iterations - 1 when the downsampled levels are kept, or the half blurred level 0 of a separable chain.
+    // An incremental Kawase chain downsamples level 0 into one more scratch level after them.
+    const int output_slot = iterations + 2;
+    const int downsampled = incremental && iterations > 0 && !is_separable(parameters.algorithm) ? output_slot + chain.scratch.Size : 1;
+    ImVector<const Framebuffer*> slots;
+    slots.resize(iterations + 2 + chain.scratch.Size + 1);
+    slots[0] = &source;
+    for (int i = 0; i <= iterations; ++i)
+        slots[i + 1] = &chain.levels[i];
+    slots[output_slot] = &chain.output;
+    for (int i = 0; i < chain.scratch.Size; ++i)
+        slots[output_slot + 1 + i] = &chain.scratch[i];
+
+    // Where the upsample passes read and write level i.
+    ImVector<int> upsampled;
+    upsampled.resize(iterations + 1);
+    for (int i = 0; i <= iterations; ++i)
+        upsampled[i] = keep_levels && i > 0 && i < iterations ? output_slot + i : i + 1;
+
+    // Slot i + 1 holds level i, see ChainTiming::marks. Level 0 of a separable chain already holds the whole blur,
+    // an upsample with offset 0 reads it back one texel per pixel.
+    ImVector<ChainPass> passes;
+    passes.reserve(iterations * 2 + 2);
+    if (is_separable(parameters.algorithm)) {
+        const bool box = parameters.algorithm == Algorithm_Box;
+        passes.push_back({ output_slot + 1, 0, box ? Kernel_BoxX : Kernel_GaussianX, offset, 1, {} });
+        passes.push_back({ 1, output_slot + 1, box ? Kernel_BoxY : Kernel_GaussianY, offset, 1, {} });
+        passes.push_back({ output_slot, 1, Kernel_Upsample, 0.0f, -1, {} });
+    } else {
+        passes.push_back({ downsampled, 0, Kernel_Downsample, offset, 1, {} });
+        for (int i = 0; i < iterations; ++i)
+            passes.push_back({ i + 2, i > 0 ? i + 1 : downsampled, Kernel_Downsample, offset, i + 2, {} });
+        for (int i = iterations; i > 0; --i)
+            passes.push_back({ upsampled[i - 1], upsampled[i], Kernel_Upsample, offset, -(i + 1), {} });
+        passes.push_back({ output_slot, 1, Kernel_Upsample, offset, -1, {} });
+    }
+
+    // Walk the chain backwards: a pass has to produce exactly what later passes read from its target,
+    // and what it reads itself is added to the needs of its input.
+    ImVector<RegionSet> needed;
+    needed.resize(slots.Size, RegionSet{});
+    needed[output_slot] = regions;
+
+    // Kept levels are also read by render(), upsampled with the taps of the pass into the level above them.
+    if (keep_levels) {
+        for (int i = 1; i < iterations; ++i) {
+            for (int r = 0; r < regions.count; ++r) {
+                const Rect above = input_footprint(regions.rects[r], chain.output, chain.levels[i - 1], Kernel_Upsample, 0.0f);
+                needed[i + 1].add(input_footprint(above, chain.levels[i - 1], chain.levels[i], Kernel_Upsample, offset));
+            }
+        }
+    }
+
+    for (int p = passes.Size - 1; p >= 0; --p) {
+        ChainPass& pass = passes[p];
+        pass.regions = needed[pass.target];
+        needed[pass.target] = RegionSet{};
+        for (int r = 0; r < pass.regions.count; ++r)
+            needed[pass.input].add(input_footprint(pass.regions.rects[r], *slots[pass.target], *slots[pass.input], pass.kernel, pass.offset));
+    }
+
+    // The final upsample still sizes the regions above, but unless someone reads the output texture it runs inside
+    // blur::render() instead, see Backend::begin_render_upsample().
+    graph.passes.resize(0);
+    graph.marks.resize(0);
+    for (const ChainPass& pass : passes) {
+        if (pass.target == output_slot && !write_output)
+            continue;
+        graph.passes.push_back({ slots[pass.target], slots[pass.input], pass.kernel, pass.offset, pass.regions });
+        graph.marks.push_back(pass.mark);
+    }
+
+    graph.algorithm = parameters.algorithm;
+    graph.iterations = iterations;
+    graph.source_width = source.width;
+    graph.source_height = source.height;
+    graph.output_width = chain.output.width;
+    graph.output_height = chain.output.height;
+    graph.scale = parameters.scale;
+    graph.offset = parameters.offset;
+    graph.write_output = write_output;
+    graph.keep_levels = keep_levels;
+    graph.incremental = incremental;
+    graph.output_regions = regions;
+    graph.source_regions = needed[0]; // whatever is left in the source slot
+}
+
+static void release_transient_levels(blur::FramebufferPool& pool, blur::Chain& chain, bool keep_levels, bool keep_scratch) {
+    for (int i = 0; i < chain.scratch.Size && !keep_scratch; ++i)
+        pool.release(chain.scratch[i]);
+    for (int i = 1; i < chain.levels.Size && !keep_levels; ++i)
+        pool.release(chain.levels[i]);
+}
+
+// Points 'framebuffer' at a size like FramebufferPool::resize() and clears 'kept' when its texels are lost.
+static bool resize_kept(blur::Backend* backend, blur::FramebufferPool& pool, blur::Framebuffer& framebuffer, int width, int height, blur::Format format, bool& kept) {
+    const void* handle = framebuffer.handle;
+    const bool resized = pool.resize(backend, framebuffer, width, height, format);
+    kept = kept && framebuffer.handle == handle;
+    return resized;
+}
+
+bool blur::run_chain(Backend* backend, FramebufferPool& pool, const BlurParameters& parameters, const Framebuffer& source, Chain& chain, bool reusable, const RegionSet* damage, ChainTiming* timing) {
+    ImVector<Framebuffer>& levels = chain.levels;
+    Framebuffer& output = chain.output;
+    const int iterations = parameters.iterations;
+    const int width = (int)(source.width * parameters.scale);
+    const int height = (int)(source.height * parameters.scale);
+    const bool separable = is_separable(parameters.algorithm);
+    const bool incremental = (parameters.flags & ProcessFlags_Incremental) != 0;
+    // A separable chain has nothing to keep, level 0 is the only one.
+    const bool keep_levels = (parameters.levels_requested.load(std::memory_order_relaxed) || incremental) && !separable;
+    const bool downsampled_scratch = incremental && !separable && iterations > 0;
+    const int scratch_count = separable ? 1 : (keep_levels && iterations > 1 ? iterations - 1 : 0) + (downsampled_scratch ? 1 : 0);
+    for (int i = iterations + 1; i < levels.Size; ++i)
+        pool.release(levels[i]);
+    for (int i = scratch_count; i < chain.scratch.Size; ++i)
+        pool.release(chain.scratch[i]);
+    levels.resize(iterations + 1, Framebuffer{});
+    chain.scratch.resize(scratch_count, Framebuffer{});
+
+    // Whether every texture still holds what the last run wrote.
+    bool kept = true;
+    for (int i = 0; i <= iterations; ++i) {
+        const Format format = level_format(backend, parameters, source.format, i);
+        bool resized = resize_kept(backend, pool, levels[i], level_size(width, i), level_size(height, i), format, kept);
+        if (resized && ((i > 0 && i < iterations && keep_levels) || separable))
+            resized = resize_kept(backend, pool, chain.scratch[separable ? 0 : i - 1], level_size(width, i), level_size(height, i), format, kept);
+        if (resized && i == 0 && downsampled_scratch)
+            resized = resize_kept(backend, pool, chain.scratch.back(), width, height, format, kept);
+        if (!resized) {
+            release_transient_levels(pool, chain, false, false);
             return false;
         }
-        
-        // LOG_ERROR("shader {} compilation failed:\n{}", name, (char*)error_blob->GetBufferPointer());
-        error_blob->Release();
-        return false;
     }
 
-    if (error_blob != nullptr) error_blob->Release();
-    // LOG_TRACE("successfully compiled shader {}", name);
+    // The output holds what level 0 would, in its format.
+    bool write_output = output.handle != nullptr && parameters.output_requested.load(std::memory_order_relaxed);
+    if (write_output && output.format != levels[0].format)
+        write_output = resize_kept(backend, pool, output, output.width, output.height, levels[0].format, kept);
+
+    PassGraph& graph = chain.graph;
+    const RegionSet regions = output_regions(parameters, output);
+    if (graph.algorithm != parameters.algorithm || graph.iterations != iterations || graph.source_width != source.width || graph.source_height != source.height
+        || graph.output_width != output.width || graph.output_height != output.height
+        || graph.scale != parameters.scale || graph.offset != parameters.offset
+        || graph.write_output != write_output || graph.keep_levels != keep_levels || graph.incremental != incremental
+        || !(graph.output_regions == regions)) {
+        compile_graph(graph, parameters, source, chain, regions, write_output, keep_levels, incremental);
+        kept = false;
+    }
+
+    // The source is captured anew by every callback.
+    graph.passes[0].input = &source;
 
-    if (FAILED(device->CreatePixelShader(shader_blob->GetBufferPointer(), shader_blob->GetBufferSize(), nullptr, out_shader))) {
-        // LOG_ERROR("Failed to create shader {}", name);
-        shader_blob->Release();
+    const bool check_content = (parameters.flags & ProcessFlags_ContentHash) != 0;
+    if (check_content && backend->begin_content_check(chain.content_state, source, graph.source_regions, reusable) == ContentCheck_Unchanged) {
+        backend->end_content_check();
+        release_transient_levels(pool, chain, keep_levels, incremental);
         return false;
     }
 
-    // LOG_INFO("created shader {} successfully", name);
-    shader_blob->Release();
+    // Damage is in output pixels, the passes start from the source.
+    const Pass* passes = graph.passes.Data;
+    if (incremental && reusable && kept && damage != nullptr) {
+        const float scale_x = (float)source.width / output.width;
+        const float scale_y = (float)source.height / output.height;
+        RegionSet source_damage;
+        for (int i = 0; i < damage->count; ++i) {
+            const Rect& rect = damage->rects[i];
+            source_damage.add({
+                clamp_int((int)floorf(rect.x0 * scale_x), 0, source.width), clamp_int((int)floorf(rect.y0 * scale_y), 0, source.height),
+                clamp_int((int)ceilf(rect.x1 * scale_x), 0, source.width), clamp_int((int)ceilf(rect.y1 * scale_y), 0, source.height)
+            });
+        }
+        damage_passes(graph, source_damage, chain.damaged_passes);
+        passes = chain.damaged_passes.Data;
+    }
+
+    // Started after the content check so its compare is not billed to the first pass.
+    if (timing != nullptr) {
+        timing->count = 0;
+        timing->started = timing->cpu || backend->begin_timing(timing->id);
+        timing->start_ms = now_ms();
+        if (!timing->started)
+            timing = nullptr;
+    }
+
+    // Whole chain batches are left to full runs, the damaged tiles of each pass go through render_pass().
+    int pass_count = 0;
+    if (passes == graph.passes.Data && backend->render_passes(passes, graph.passes.Size, parameters.offset, parameters.noise)) {
+        mark_pass(backend, timing, 0);
+        for (const Pass& pass : graph.passes)
+            pass_count += pass.regions.count > 0 ? 1 : 0;
+    } else {
+        for (int p = 0; p < graph.passes.Size; ++p) {
+            const Pass& pass = passes[p];
+            if (pass.regions.count == 0)
+                continue;
+
+            backend->render_pass(*pass.target, *pass.input, pass.kernel, pass.offset, parameters.noise, pass.regions);
+            mark_pass(backend, timing, graph.marks[p]);
+            ++pass_count;
+        }
+    }
+
+    if (timing != nullptr && !timing->cpu)
+        backend->end_timing();
+
+    count(Counter_Chains);
+    count(Counter_Passes, pass_count);
+
+    if (check_content)
+        backend->end_content_check();
+    release_transient_levels(pool, chain, keep_levels, incremental);
     return true;
 }
 
-bool blur::setup(ID3D11Device* device, ID3D11DeviceContext* device_context) {
-    if (!create_vertex_shader(device, g_vertex_src, "vertex", "main", "vs_5_0", &g_vertex))
-        return false;
+bool blur::set_backend(Backend* backend) {
+    std::lock_guard<std::mutex> lock(g_chains_mutex);
+    IM_ASSERT(g_backend == nullptr && "blur::destroy() must be called before switching backends");
+    g_backend = backend;
+    return g_backend != nullptr;
+}
 
-    if (!create_pixel_shader(device, g_downsample_src, "kawase downsample", "main", "ps_5_0", &g_upsample))
-        return false;
+blur::Backend* blur::get_backend() {
+    return g_backend;
+}
 
-    if (!create_pixel_shader(device, g_upsample_src, "kawase upsample", "main", "ps_5_0", &g_downsample))
-        return false;
+blur::Backend* blur::exchange_backend(Backend* backend) {
+    std::unique_lock<std::mutex> lock(g_chains_mutex);
+    wait_for_chains(lock);
+    Backend* previous = g_backend;
+    g_backend = backend;
+    return previous;
+}
 
-    // LOG_INFO("all blur shaders initialized successfully");
+// Blur state of the current ImGuiContext, nullptr when it has none yet and 'create' is not set. Each thread remembers
+// the last one it looked up, so only the first call after switching contexts takes the lock.
+static BlurContext* find_context(bool create) {
+    ImGuiContext* imgui_context = ImGui::GetCurrentContext();
+    const ImU32 generation = g_contexts_generation.load(std::memory_order_acquire);
+    if (g_thread_context != nullptr && g_thread_generation == generation && g_thread_context->imgui_context == imgui_context)
+        return g_thread_context;
+
+    std::lock_guard<std::mutex> lock(g_contexts_mutex);
+    BlurContext* found = nullptr;
+    for (BlurContext* context : g_contexts) {
+        if (context->imgui_context == imgui_context)
+            found = context;
+    }
+    if (found == nullptr && create && imgui_context != nullptr) {
+        found = IM_NEW(BlurContext);
+        found->imgui_context = imgui_context;
+        g_contexts.push_back(found);
+    }
 
-    struct Vertex {
-        float pos[2];
-        float uv[2];
-    };
+    g_thread_context = found;
+    g_thread_generation = generation;
+    return found;
+}
 
-    Vertex vertices[] = {
-        { { -1.0f,  1.0f }, { 0.0f, 0.0f } },
-        { {  1.0f,  1.0f }, { 1.0f, 0.0f } },
-        { { -1.0f, -1.0f }, { 0.0f, 1.0f } },
-        { {  1.0f, -1.0f }, { 1.0f, 1.0f } },
-    };
+// Call with g_stats_mutex held.
+static void roll_counters(BlurContext& context, int frame) {
+    if (context.counting.frame == frame)
+        return;
 
-    D3D11_BUFFER_DESC vb_desc = {};
-    vb_desc.Usage = D3D11_USAGE_DEFAULT;
-    vb_desc.ByteWidth = sizeof(vertices);
-    vb_desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    context.counted = context.counting.frame == frame - 1 ? context.counting : FrameCounters{};
+    context.counted.frame = frame - 1;
+    context.counting = FrameCounters{};
+    context.counting.frame = frame;
+}
 
-    D3D11_SUBRESOURCE_DATA vb_data = {};
-    vb_data.pSysMem = vertices;
-    if (FAILED(device->CreateBuffer(&vb_desc, &vb_data, &g_vertex_buffer)))
-        return false;
+void blur::count(Counter counter, int amount) {
+    BlurContext* context = find_context(true);
+    if (context == nullptr)
+        return;
 
-    D3D11_BUFFER_DESC cb_desc = {};
-    cb_desc.Usage = D3D11_USAGE_DYNAMIC;
-    cb_desc.ByteWidth = sizeof(BlurConstants);
-    cb_desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-    cb_desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-    if (FAILED(device->CreateBuffer(&cb_desc, nullptr, &g_constant_buffer)))
-        return false;
+    std::lock_guard<std::mutex> lock(g_stats_mutex);
+    roll_counters(*context, ImGui::GetFrameCount());
+    context->counting.counts[counter] += amount;
+    if (counter == Counter_FramebuffersCreated)
+        context->framebuffers_created_total += amount;
+}
 
-    D3D11_SAMPLER_DESC sampler_desc = {};
-    sampler_desc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
-    sampler_desc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
-    sampler_desc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
-    sampler_desc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
-    sampler_desc.ComparisonFunc = D3D11_COMPARISON_NEVER;
-    sampler_desc.MaxLOD = D3D11_FLOAT32_MAX;
-    if (FAILED(device->CreateSamplerState(&sampler_desc, &g_linear_sampler)))
-        return false;
+// Call with g_stats_mutex held.
+static void publish_timing(BlurContext& context) {
+    context.timed = context.timing_sum;
+    context.history[context.history_next] = context.timing_sum.total_ms;
+    context.history_next = (context.history_next + 1) % blur::Stats::history_size;
+}
 
-    sampler_desc.AddressU = D3D11_TEXTURE_ADDRESS_MIRROR;
-    sampler_desc.AddressV = D3D11_TEXTURE_ADDRESS_MIRROR;
-    sampler_desc.AddressW = D3D11_TEXTURE_ADDRESS_MIRROR;
-    if (FAILED(device->CreateSamplerState(&sampler_desc, &g_mirror_sampler)))
-        return false;
+static void add_timing(BlurContext* context, int frame, const blur::ChainTiming& timing, const float* ms, int count, bool gpu) {
+    std::lock_guard<std::mutex> lock(g_stats_mutex);
+    if (context == nullptr)
+        return;
 
-    D3D11_RASTERIZER_DESC raster_desc = {};
-    raster_desc.FillMode = D3D11_FILL_SOLID;
-    raster_desc.CullMode = D3D11_CULL_NONE;
-    raster_desc.ScissorEnable = FALSE;
-    raster_desc.DepthClipEnable = FALSE;
-    if (FAILED(device->CreateRasterizerState(&raster_desc, &g_rasterizer_state)))
-        return false;
-    
-    g_device = device;
-    return create_framebuffer(device, g_framebuffer, 1, 1);
-}
+    blur::Stats& sum = context->timing_sum;
+    if (frame < sum.timed_frame)
+        return; // a later frame was published already
+    if (frame != sum.timed_frame) {
+        if (sum.timed_frame >= 0)
+            publish_timing(*context);
+        sum = blur::Stats{};
+        sum.timed_frame = frame;
+    }
 
-void blur::destroy() {
-    if (g_downsample) { g_downsample->Release(); g_downsample = nullptr; }
-    if (g_upsample) { g_upsample->Release(); g_upsample = nullptr; }
-    if (g_vertex) { g_vertex->Release(); g_vertex = nullptr; }
-    if (g_input_layout) { g_input_layout->Release(); g_input_layout = nullptr; }
-    if (g_constant_buffer) { g_constant_buffer->Release(); g_constant_buffer = nullptr; }
-    if (g_vertex_buffer) { g_vertex_buffer->Release(); g_vertex_buffer = nullptr; }
-    if (g_linear_sampler) { g_linear_sampler->Release(); g_linear_sampler = nullptr; }
-    if (g_mirror_sampler) { g_mirror_sampler->Release(); g_mirror_sampler = nullptr; }
-    if (g_rasterizer_state) { g_rasterizer_state->Release(); g_rasterizer_state = nullptr; }
-    if (g_depth_stencil_state) { g_depth_stencil_state->Release(); g_depth_stencil_state = nullptr; }
+    sum.gpu_timing = gpu;
+    float previous = 0.0f;
+    for (int i = 0; i < count; ++i) {
+        const float pass_ms = ms[i] - previous;
+        previous = ms[i];
+
+        const int mark = timing.marks[i];
+        const int level = clamp_int((mark > 0 ? mark : -mark) - 1, 0, blur::Stats::max_levels - 1);
+        if (mark > 0)
+            sum.downsample_ms[level] += pass_ms;
+        else if (mark < 0)
+            sum.upsample_ms[level] += pass_ms;
+        if (mark != 0 && level >= sum.levels)
+            sum.levels = level + 1;
+    }
+    sum.total_ms += previous;
+}
 
-    for (Framebuffer& framebuffer : g_framebuffers)
-        framebuffer.destroy();
-    g_framebuffers.clear();
+// Collects the timer results that arrived and hands out the timing of the next chain, nullptr when every slot is
+// still waiting for its results.
+static blur::ChainTiming* begin_chain_timing(BlurContext* context, int frame) {
+    ImU32 id = 0;
+    float ms[blur::max_timestamps];
+    int count = 0;
+    while (g_backend->read_timing(id, ms, count)) {
+        PendingTiming& pending = g_pending_timings[id % IMGUI_BLUR_TIMER_QUERY_SETS];
+        if (pending.timing.started && pending.timing.id == id) {
+            add_timing(pending.context, pending.frame, pending.timing, ms, count, true);
+            pending.timing.started = false;
+        }
+    }
 
-    g_framebuffer.destroy();
+    PendingTiming& next = g_pending_timings[g_next_timing_id % IMGUI_BLUR_TIMER_QUERY_SETS];
+    if (next.timing.started)
+        return nullptr;
 
-    garbage_collect();
+    next.context = context;
+    next.frame = frame;
+    next.timing.id = g_next_timing_id;
+    next.timing.cpu = !g_backend->has_timer_queries();
+    return &next.timing;
 }
 
-static void render_fullscreen_quad(ID3D11DeviceContext* device_context) {
-    UINT stride = sizeof(float) * 4;
-    UINT offset = 0;
-    device_context->IASetVertexBuffers(0, 1, &g_vertex_buffer, &stride, &offset);
-    device_context->IASetInputLayout(g_input_layout);
-    device_context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
-    device_context->Draw(4, 0);
+static void end_chain_timing(BlurContext* context, blur::ChainTiming* timing, int frame) {
+    if (timing == nullptr || !timing->started)
+        return;
+
+    if (timing->cpu) {
+        add_timing(context, frame, *timing, timing->ms, timing->count, false);
+        timing->started = false;
+    } else {
+        ++g_next_timing_id;
+    }
 }
 
-static void render_shader_pass(ID3D11DeviceContext* device_context, const Framebuffer& framebuffer, ID3D11ShaderResourceView* input_srv, ID3D11PixelShader* shader, float offset, float noise) {
-    D3D11_MAPPED_SUBRESOURCE mapped;
-    device_context->Map(g_constant_buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+static void destroy_chain(CachedChain* chain) {
+    for (blur::Framebuffer& framebuffer : chain->levels)
+        g_pool.release(framebuffer);
+    for (blur::Framebuffer& framebuffer : chain->scratch)
+        g_pool.release(framebuffer);
+    g_pool.release(chain->output);
+    if (chain->content_state != nullptr)
+        g_backend->destroy_content_state(chain->content_state);
+    IM_DELETE(chain);
+}
 
-    BlurConstants* constants = (BlurConstants*)mapped.pData;
-    constants->half_pixel = ImVec2(0.5f / framebuffer.width, 0.5f / framebuffer.height);
-    constants->offset = offset;
-    constants->noise = noise;
+// Needs g_chains_mutex. The context must already be out of g_contexts.
+static void destroy_context_chains(BlurContext* context) {
+    for (ViewportPyramids* pyramids : context->viewports) {
+        for (CachedChain* chain : pyramids->chains)
+            destroy_chain(chain);
+        IM_DELETE(pyramids);
+    }
+    context->viewports.clear();
+}
 
-    device_context->Unmap(g_constant_buffer, 0);
+static void delete_context(BlurContext* context) {
+    for (CommandHistory* history : context->command_histories)
+        IM_DELETE(history);
+    IM_DELETE(context);
+}
 
-    float clear_color[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
-    device_context->ClearRenderTargetView(framebuffer.rtv, clear_color);
-    device_context->OMSetRenderTargets(1, &framebuffer.rtv, nullptr);
+void blur::destroy_context(ImGuiContext* imgui_context) {
+    if (imgui_context == nullptr)
+        imgui_context = ImGui::GetCurrentContext();
+
+    BlurContext* context = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(g_contexts_mutex);
+        for (int i = 0; i < g_contexts.Size; ++i) {
+            if (g_contexts[i]->imgui_context == imgui_context) {
+                context = g_contexts[i];
+                g_contexts.erase(g_contexts.Data + i);
+                g_contexts_generation.fetch_add(1, std::memory_order_acq_rel);
+                break;
+            }
+        }
+    }
+    if (context == nullptr)
+        return;
 
-    D3D11_VIEWPORT viewport = {};
-    viewport.Width = (float)framebuffer.width;
-    viewport.Height = (float)framebuffer.height;
-    viewport.MinDepth = 0.0f;
-    viewport.MaxDepth = 1.0f;
-    device_context->RSSetViewports(1, &viewport);
+    {
+        std::unique_lock<std::mutex> lock(g_chains_mutex);
+        wait_for_chains(lock);
+        if (g_backend != nullptr)
+            destroy_context_chains(context);
+    }
+    {
+        // Queries still in flight are read back into nothing.
+        std::lock_guard<std::mutex> stats_lock(g_stats_mutex);
+        for (PendingTiming& pending : g_pending_timings) {
+            if (pending.context == context)
+                pending.context = nullptr;
+        }
+    }
+    delete_context(context);
+}
 
-    device_context->PSSetShader(shader, nullptr, 0);
-    device_context->PSSetConstantBuffers(0, 1, &g_constant_buffer);
-    device_context->PSSetShaderResources(0, 1, &input_srv);
+void blur::destroy() {
+    // Parameters and snapshots live in the contexts, so they go with the chains they point to.
+    ImVector<BlurContext*> contexts;
+    {
+        std::lock_guard<std::mutex> lock(g_contexts_mutex);
+        contexts.swap(g_contexts);
+        g_contexts_generation.fetch_add(1, std::memory_order_acq_rel);
+    }
 
-    device_context->PSSetSamplers(0, 1, &g_mirror_sampler);
+    std::unique_lock<std::mutex> lock(g_chains_mutex);
+    wait_for_chains(lock);
+    if (g_backend != nullptr) {
+        for (BlurContext* context : contexts)
+            destroy_context_chains(context);
+        g_pool.clear(g_backend);
 
-    render_fullscreen_quad(device_context);
+        IM_DELETE(g_backend);
+        g_backend = nullptr;
+    }
 
-    ID3D11ShaderResourceView* null_srv[2] = { nullptr, nullptr };
-    device_context->PSSetShaderResources(0, 2, null_srv);
+    std::lock_guard<std::mutex> stats_lock(g_stats_mutex);
+    for (PendingTiming& pending : g_pending_timings)
+        pending = PendingTiming{};
+    g_next_timing_id = 0;
+    for (BlurContext* context : contexts)
+        delete_context(context);
 }
 
 static void post_process_callback(const ImDrawList*, const ImDrawCmd* cmd) {
-    BlurParameters* blur_parameters = reinterpret_cast<BlurParameters*>(cmd->UserCallbackData);
+    blur::BlurParameters* blur_parameters = reinterpret_cast<blur::BlurParameters*>(cmd->UserCallbackData);
     if (blur_parameters == nullptr) {
         // LOG_ERROR("blur received null parameters");
         return;
     }
 
-    if (g_framebuffer.srv == nullptr) {
-        // LOG_WARN("blur has no valid target... skipping frame");
-        return;
+    // The cache is looked at and the damage added under the lock, the chain runs without it.
+    CachedChain* chain = (CachedChain*)blur_parameters->chain;
+    blur::Backend* backend = nullptr;
+    blur::RegionSet regions, damage;
+    bool wants_output = false, wants_levels = false, reusable = false, damage_known = false;
+    const int frame = ImGui::GetFrameCount();
+    const double time = ImGui::GetTime();
+    {
+        std::lock_guard<std::mutex> lock(g_chains_mutex);
+        backend = g_backend;
+        if (backend == nullptr || chain == nullptr || chain->output.width == 0) {
+            // LOG_WARN("blur has no valid target... skipping frame");
+            return;
+        }
+
+        ChainCache& cache = chain->cache;
+        regions = blur::output_regions(*blur_parameters, chain->output);
+        wants_output = blur_parameters->output_requested.load(std::memory_order_relaxed);
+        wants_levels = blur_parameters->levels_requested.load(std::memory_order_relaxed);
+        reusable = cache.valid && (cache.output_valid || !wants_output) && (cache.levels_valid || !wants_levels)
+            && cache.algorithm == blur_parameters->algorithm && cache.iterations == blur_parameters->iterations && cache.offset == blur_parameters->offset
+            && cache.noise == blur_parameters->noise && cache.scale == blur_parameters->scale
+            && cache.format == blur_parameters->format && cache.deep_format == blur_parameters->deep_format
+            && cache.deep_level == blur_parameters->deep_level
+            && cache.regions.covers(regions);
+
+        // The damage adds up while the result is kept, and stays known as long as every frame reports it.
+        if (blur_parameters->flags & blur::ProcessFlags_Incremental) {
+            cache.damage_known = cache.damage_known && cache.damage_frame == frame - 1 && blur_parameters->damage_state.load(std::memory_order_acquire) == blur::DamageState_Reported;
+            cache.damage_frame = frame;
+            blur::add_region_nodes(cache.damage, blur_parameters->damage.load(std::memory_order_acquire), chain->output);
+        }
+        damage = cache.damage;
+        damage_known = cache.damage_known;
+
+        if (reusable) {
+            if (blur_parameters->flags & blur::ProcessFlags_BackgroundClean)
+                return;
+            const double refresh_interval = g_refresh_interval.load(std::memory_order_relaxed);
+            if (refresh_interval > 0.0 && time - cache.time < refresh_interval)
+                return;
+        }
+
+        chain->running = true;
+        ++g_running_chains;
     }
 
-    ImGuiPlatformIO& platform_io = ImGui::GetPlatformIO();
-    ImGui_ImplDX11_RenderState* render_state = (ImGui_ImplDX11_RenderState*)platform_io.Renderer_RenderState;
-    if (render_state == nullptr) {
-        LOG_ERROR("blur has no render state");
-        return;
+    blur::Framebuffer source{};
+    bool computed = false;
+    if (backend->begin_chain(source)) {
+        // process() reads the output under the lock, so it takes level 0's format here rather than in run_chain().
+        const blur::Format format = blur::level_format(backend, *blur_parameters, source.format, 0);
+        if (chain->output.handle != nullptr && chain->output.format != format) {
+            std::lock_guard<std::mutex> lock(g_chains_mutex);
+            g_pool.resize(backend, chain->output, chain->output.width, chain->output.height, format);
+            reusable = false;
+        }
+
+        blur::ChainTiming* timing = begin_chain_timing(chain->context, frame);
+        computed = blur::run_chain(backend, g_pool, *blur_parameters, source, *chain, reusable, damage_known ? &damage : nullptr, timing);
+        end_chain_timing(chain->context, timing, frame);
+
+        backend->end_chain();
     }
 
-    ID3D11Device* device = render_state->Device;
-    ID3D11DeviceContext* device_context = render_state->DeviceContext;
+    {
+        std::lock_guard<std::mutex> lock(g_chains_mutex);
+        chain->running = false;
+        --g_running_chains;
+
+        ChainCache& cache = chain->cache;
+        if (computed) {
+            cache.valid = true;
+            cache.output_valid = wants_output && chain->output.handle != nullptr;
+            cache.levels_valid = wants_levels;
+            cache.algorithm = blur_parameters->algorithm;
+            cache.iterations = blur_parameters->iterations;
+            cache.offset = blur_parameters->offset;
+            cache.noise = blur_parameters->noise;
+            cache.scale = blur_parameters->scale;
+            cache.format = blur_parameters->format;
+            cache.deep_format = blur_parameters->deep_format;
+            cache.deep_level = blur_parameters->deep_level;
+            cache.regions = regions;
+            cache.time = time;
+            cache.damage = blur::RegionSet{};
+            cache.damage_known = true;
+        }
+    }
+    g_chain_finished.notify_all();
+}
 
-    ID3D11RenderTargetView* screen_rtv = nullptr;
-    device_context->OMGetRenderTargets(1, &screen_rtv, nullptr);
+// Spread of a whole chain in display pixels.
+static float blur_radius(blur::Algorithm algorithm, int iterations, float offset, float scale) {
+    return is_separable(algorithm) ? offset / scale : blur::get_blur_radius(iterations, offset, scale);
+}
 
-    ID3D11Texture2D* screen_tex = nullptr;
-    screen_rtv->GetResource(reinterpret_cast<ID3D11Resource**>(&screen_tex));
+// A blur::render() call with a radius, allocated in the frame arena next to the parameters.
+class RenderCall {
+public:
+    blur::BlurParameters* parameters;
+    float radius;
+};
 
-    D3D11_TEXTURE2D_DESC tex_desc;
-    screen_tex->GetDesc(&tex_desc);
+// Mixing two blurs with weights 1 - t and t adds their variances the same way, so t is picked for the variance of a
+// gaussian of 'radius'. Below the first kept level the blur fades out, which mixes in the sharp frame underneath.
+static float mix_weight(float radius, float low, float high) {
+    const float t = (radius * radius - low * low) / (high * high - low * low);
+    return t < 0.0f ? 0.0f : t > 1.0f ? 1.0f : t;
+}
 
-    const float scale = blur_parameters->scale;
-    const int width = tex_desc.Width * scale;
-    const int height = tex_desc.Height * scale;
-    if (g_last_iterations != blur_parameters->iterations || g_last_width != width || g_last_height != height) {
-        for (Framebuffer& framebuffer : g_framebuffers)
-            framebuffer.destroy();
-        g_framebuffers.resize(blur_parameters->iterations + 1);
+// Kept level i upsampled straight into the output spreads about as far as a whole chain of i iterations, the impulse
+// response on the GPU backends stays within a few percent of get_blur_radius(). Level 0 stands for the full chain.
+static float level_radius(const ChainCache& cache, int level) {
+    return blur_radius(cache.algorithm, level < cache.iterations ? level : cache.iterations, cache.offset, cache.scale);
+}
 
-        // LOG_DEBUG("rebuilding framebuffers");
+// Taps of the pass that would upsample 'level' into the level above it, or into the output for level 0.
+static ImVec2 level_spacing(const CachedChain& chain, int level) {
+    const blur::Framebuffer& above = level > 0 ? chain.levels[level - 1] : chain.output;
+    return { 0.5f / above.width, 0.5f / above.height };
+}
 
-        create_framebuffer(device, g_framebuffers[0], width, height);
-        for (int i = 1; i <= blur_parameters->iterations; ++i) {
-            create_framebuffer(
-                device, g_framebuffers[i],
-                width / (1 << i),
-                height / (1 << i)
-            );
-        }
+static blur::RenderSource select_levels(const CachedChain& chain, float radius) {
+    const ChainCache& cache = chain.cache;
+    blur::RenderSource source;
+    // Without a result the shapes are hidden rather than drawn with whatever the levels held before.
+    if (!cache.valid || chain.levels.Size == 0)
+        return source;
+
+    // Steps are the kept levels 1..iterations - 1, then level 0 for the full radius. "first" is the last one within it.
+    int first = cache.levels_valid && radius >= 0.0f ? 1 : cache.iterations;
+    while (first < cache.iterations && radius >= level_radius(cache, first + 1))
+        ++first;
+    const int level = first < cache.iterations ? first : 0;
+    if (chain.levels[level].handle == nullptr)
+        return source;
+
+    source.levels[0] = &chain.levels[level];
+    source.spacing[0] = level_spacing(chain, level);
+    source.spacing[1] = source.spacing[0];
+    if (radius < 0.0f || level == 0) {
+        if (radius >= 0.0f)
+            source.opacity = mix_weight(radius, 0.0f, level_radius(cache, cache.iterations));
+        return source;
+    }
 
-        g_last_iterations = blur_parameters->iterations;
-        g_last_width = width;
-        g_last_height = height;
+    if (first == 1 && radius < level_radius(cache, 1)) {
+        source.opacity = mix_weight(radius, 0.0f, level_radius(cache, 1));
+        return source;
     }
 
-    D3D11_SHADER_RESOURCE_VIEW_DESC srv_desc = {};
-    srv_desc.Format = tex_desc.Format;
-    srv_desc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-    srv_desc.Texture2D.MipLevels = 1;
-    srv_desc.Texture2D.MostDetailedMip = 0;
+    const int next = first + 1 < cache.iterations ? first + 1 : 0;
+    if (chain.levels[next].handle == nullptr)
+        return source;
+    source.levels[1] = &chain.levels[next];
+    source.spacing[1] = level_spacing(chain, next);
+    source.blend = mix_weight(radius, level_radius(cache, first), level_radius(cache, first + 1));
+    return source;
+}
+
+// Around the shapes of blur::render() when the backend fuses the final upsample, see Backend::begin_render_upsample().
+// The data is the BlurParameters, or a RenderCall for render() with a radius.
+static void begin_render(const blur::BlurParameters* blur_parameters, float radius) {
+    std::lock_guard<std::mutex> lock(g_chains_mutex);
+    const CachedChain* chain = (const CachedChain*)blur_parameters->chain;
+    if (g_backend == nullptr || chain == nullptr)
+        return;
 
-    ID3D11ShaderResourceView* screen_srv = nullptr;
-    device->CreateShaderResourceView(screen_tex, &srv_desc, &screen_srv);
+    // Level 0 of a separable chain is the finished blur, offset 0 upsamples it without widening it.
+    const float offset = is_separable(chain->cache.algorithm) ? 0.0f : chain->cache.offset;
+    g_backend->begin_render_upsample(select_levels(*chain, radius), chain->output, offset, chain->cache.noise);
+}
 
-    if (screen_tex) screen_tex->Release();
-    if (screen_rtv) screen_rtv->Release();
+static void render_begin_callback(const ImDrawList*, const ImDrawCmd* cmd) {
+    begin_render(reinterpret_cast<const blur::BlurParameters*>(cmd->UserCallbackData), -1.0f);
+}
 
-    D3D11_VIEWPORT old_viewport;
-    UINT num_viewports = 1;
-    device_context->RSGetViewports(&num_viewports, &old_viewport);
+static void render_radius_callback(const ImDrawList*, const ImDrawCmd* cmd) {
+    const RenderCall* call = reinterpret_cast<const RenderCall*>(cmd->UserCallbackData);
+    begin_render(call->parameters, call->radius);
+}
 
-    ID3D11RenderTargetView* old_rtv = nullptr;
-    ID3D11DepthStencilView* old_dsv = nullptr;
-    device_context->OMGetRenderTargets(1, &old_rtv, &old_dsv);
+static void render_end_callback(const ImDrawList*, const ImDrawCmd*) {
+    std::lock_guard<std::mutex> lock(g_chains_mutex);
+    if (g_backend != nullptr)
+        g_backend->end_render_upsample();
+}
 
-    ID3D11RasterizerState* old_rasterizer_state = nullptr;
-    device_context->RSGetState(&old_rasterizer_state);
+// Unclaimed chains with identical parameters come first, then ones with the same pyramid layout, then any.
+// A call whose parameters animate keeps reusing the pyramid of its previous frame instead of piling up chains.
+// Only chains of the same viewport are considered. Needs g_chains_mutex.
+static CachedChain* claim_chain(BlurContext& context, ViewportPyramids& pyramids, const blur::BlurParameters& parameters, ImU32 frame) {
+    const bool incremental = (parameters.flags & blur::ProcessFlags_Incremental) != 0;
+    CachedChain* best = nullptr;
+    int best_score = -1;
+    for (CachedChain* chain : pyramids.chains) {
+        if (chain->claimed == frame)
+            continue;
+
+        int score = 0;
+        if (chain->algorithm == parameters.algorithm && chain->iterations == parameters.iterations && chain->scale == parameters.scale)
+            score = chain->offset == parameters.offset && chain->noise == parameters.noise && chain->incremental == incremental ? 2 : 1;
+
+        if (score > best_score || (score == best_score && chain->claimed > best->claimed)) {
+            best = chain;
+            best_score = score;
+        }
+    }
 
-    ID3D11DepthStencilState* old_depth_stencil_state;
-    UINT old_stencil_ref;
-    device_context->OMGetDepthStencilState(&old_depth_stencil_state, &old_stencil_ref);
+    if (best == nullptr) {
+        best = IM_NEW(CachedChain);
+        best->context = &context;
+        pyramids.chains.push_back(best);
+    }
+
+    best->algorithm = parameters.algorithm;
+    best->iterations = parameters.iterations;
+    best->offset = parameters.offset;
+    best->noise = parameters.noise;
+    best->scale = parameters.scale;
+    best->incremental = incremental;
+    best->claimed = frame;
+    return best;
+}
 
-    device_context->VSSetShader(g_vertex, nullptr, 0);
-    device_context->RSSetState(g_rasterizer_state);
-    device_context->OMSetDepthStencilState(g_depth_stencil_state, 0);
+// Pyramids of the viewport 'id', created by its first process() call. Needs g_chains_mutex.
+static ViewportPyramids* find_pyramids(BlurContext& context, ImGuiID id) {
+    for (ViewportPyramids* pyramids : context.viewports) {
+        if (pyramids->id == id)
+            return pyramids;
+    }
 
-    render_shader_pass(device_context, g_framebuffers[0], screen_srv, g_downsample, blur_parameters->offset, blur_parameters->noise);
-    
-    for (int i = 0; i < blur_parameters->iterations; ++i)
-        render_shader_pass(device_context, g_framebuffers[i + 1], g_framebuffers[i].srv, g_downsample, blur_parameters->offset, blur_parameters->noise);
+    ViewportPyramids* pyramids = IM_NEW(ViewportPyramids);
+    pyramids->id = id;
+    context.viewports.push_back(pyramids);
+    return pyramids;
+}
 
-    for (int i = blur_parameters->iterations; i > 0; --i)
-        render_shader_pass(device_context, g_framebuffers[i - 1], g_framebuffers[i].srv, g_upsample, blur_parameters->offset, blur_parameters->noise);
+// Chains of the context no process() call claimed in the last frame, once no parameters still in the arena can point
+// to them, then viewports left without any. Needs g_chains_mutex.
+static void evict_chains(BlurContext& context, ImU32 frame) {
+    for (int v = 0; v < context.viewports.Size; ++v) {
+        ImVector<CachedChain*>& chains = context.viewports[v]->chains;
+        for (int i = 0; i < chains.Size; ++i) {
+            if ((int)(frame - chains[i]->claimed) >= IMGUI_BLUR_FRAMES_IN_FLIGHT && !chains[i]->running) {
+                destroy_chain(chains[i]);
+                chains.erase(chains.Data + i--);
+            }
+        }
+        if (chains.Size == 0) {
+            IM_DELETE(context.viewports[v]);
+            context.viewports.erase(context.viewports.Data + v--);
+        }
+    }
+}
+
+// Snapshots are the frame in the high half and the arena offset + 1 in the low half, both of the current context.
+static blur::BlurParameters* find_parameters(blur::Snapshot snapshot) {
+    BlurContext* context = snapshot != 0 ? find_context(false) : nullptr;
+    if (context == nullptr)
+        return nullptr;
+    return (blur::BlurParameters*)context->arena.resolve((ImU32)(snapshot >> 32), (ImU32)snapshot - 1);
+}
+
+// The last process() call of this thread, as long as it was for the current context.
+static blur::Snapshot last_snapshot() {
+    return g_last_snapshot_context == find_context(false) ? g_last_snapshot : 0;
+}
+
+// Where regions, render calls and damage of the parameters go: next to them, in their context's arena.
+static FrameArena& parameters_arena(const blur::BlurParameters& parameters) {
+    return ((const CachedChain*)parameters.chain)->context->arena;
+}
+
+// Recording threads cannot read the viewports while the main thread updates them, so they pick from a copy taken
+// once per frame, by new_frame() or else the first process() call. Needs g_chains_mutex.
+static void copy_viewports(BlurContext& context, ImU32 frame) {
+    if (context.viewport_thread == std::thread::id())
+        context.viewport_thread = std::this_thread::get_id();
+    IM_ASSERT(context.viewport_thread == std::this_thread::get_id() && "the viewports were copied on two threads, call blur::new_frame() on the main thread");
+
+    const ImGuiViewport* main_viewport = ImGui::GetMainViewport();
+    context.viewport_rects.resize(0);
+    context.viewport_rects.push_back({ main_viewport->ID, main_viewport->Pos, main_viewport->Size });
+#ifdef IMGUI_HAS_VIEWPORT
+    for (const ImGuiViewport* viewport : ImGui::GetPlatformIO().Viewports) {
+        if (viewport != main_viewport)
+            context.viewport_rects.push_back({ viewport->ID, viewport->Pos, viewport->Size });
+    }
+#endif
+    context.viewport_rects_frame = frame;
+}
 
-    render_shader_pass(device_context, g_framebuffer, g_framebuffers[0].srv, g_upsample, blur_parameters->offset, blur_parameters->noise);
+// The viewport a draw list renders into, from its clip rectangle alone: the smallest viewport holding all of it (a
+// window's clip rectangle lies inside its window's viewport, a background or foreground list's is its viewport),
+// otherwise the one holding its center, otherwise the main viewport. Recording threads cannot read the current window
+// either. Needs g_chains_mutex.
+static ViewportRect find_viewport(BlurContext& context, const ImDrawList* draw_list, ImU32 frame) {
+    if (context.viewport_rects_frame != frame || context.viewport_rects.Size == 0)
+        copy_viewports(context, frame);
+
+    const ImVec2 clip_min = draw_list->GetClipRectMin();
+    const ImVec2 clip_max = draw_list->GetClipRectMax();
+    const ImVec2 center = { (clip_min.x + clip_max.x) * 0.5f, (clip_min.y + clip_max.y) * 0.5f };
+    const ViewportRect* holding = nullptr;
+    const ViewportRect* centered = nullptr;
+    for (const ViewportRect& viewport : context.viewport_rects) {
+        const ImVec2 max = { viewport.pos.x + viewport.size.x, viewport.pos.y + viewport.size.y };
+        if (clip_min.x >= viewport.pos.x && clip_min.y >= viewport.pos.y && clip_max.x <= max.x && clip_max.y <= max.y
+            && (holding == nullptr || viewport.size.x * viewport.size.y < holding->size.x * holding->size.y))
+            holding = &viewport;
+        if (centered == nullptr && center.x >= viewport.pos.x && center.y >= viewport.pos.y && center.x < max.x && center.y < max.y)
+            centered = &viewport;
+    }
+    return holding != nullptr ? *holding : centered != nullptr ? *centered : context.viewport_rects[0];
+}
 
-    device_context->RSSetViewports(1, &old_viewport);
-    device_context->OMSetRenderTargets(1, &old_rtv, old_dsv);
-    device_context->RSSetState(old_rasterizer_state);
-    device_context->OMSetDepthStencilState(old_depth_stencil_state, old_stencil_ref);
+// Makes the chain write its final upsample to Chain::output this frame. Needs g_chains_mutex, and waits for a draw
+// callback still running the chain before it allocates the output.
+static bool request_output(std::unique_lock<std::mutex>& lock, blur::BlurParameters& parameters, ImU32 frame) {
+    CachedChain* chain = (CachedChain*)parameters.chain;
+    if (chain->output.handle == nullptr) {
+        wait_for_chains(lock, chain);
+        const blur::Format format = chain->levels.Size > 0 ? chain->levels[0].format : blur::Format_RGBA8;
+        if (!g_pool.resize(g_backend, chain->output, chain->output.width, chain->output.height, format))
+            return false;
+        chain->cache.output_valid = false;
+    }
 
-    if (old_rtv) old_rtv->Release();
-    if (old_dsv) old_dsv->Release();
-    if (old_rasterizer_state) old_rasterizer_state->Release();
-    if (old_depth_stencil_state) old_depth_stencil_state->Release();
-    if (screen_srv) screen_srv->Release();
+    chain->output_requested = frame;
+    parameters.output_requested.store(true, std::memory_order_relaxed);
+    return true;
 }
 
-void blur::process(ImDrawList* draw_list, int iterations, float offset, float noise, float scale) {
-    if (g_vertex == nullptr) {
+static blur::Snapshot queue_process(ImDrawList* draw_list, blur::Algorithm algorithm, int iterations, float offset, float noise, float scale, blur::ProcessFlags flags) {
+    using namespace blur;
+    if (g_backend == nullptr) {
         // LOG_ERROR("cannot process! blur was not initialized");
-        return;
+        return 0;
     }
 
-    ImGuiIO& io = ImGui::GetIO();
-    if (g_framebuffer.width != io.DisplaySize.x || g_framebuffer.height != io.DisplaySize.y)
-        create_framebuffer(g_device, g_framebuffer, io.DisplaySize.x, io.DisplaySize.y);
+    BlurContext* context = find_context(true);
+    if (context == nullptr) {
+        // LOG_ERROR("cannot process! no ImGui context is current");
+        return 0;
+    }
 
-    BlurParameters* blur_parameters = IM_NEW(BlurParameters);
+    const ImU32 frame = (ImU32)ImGui::GetFrameCount();
+    ImU32 arena_offset = 0;
+    void* memory = context->arena.allocate(frame, sizeof(BlurParameters), arena_offset);
+    if (memory == nullptr) {
+        // LOG_ERROR("blur frame arena is full, raise IMGUI_BLUR_ARENA_SIZE");
+        return 0;
+    }
+
+    BlurParameters* blur_parameters = IM_PLACEMENT_NEW(memory) BlurParameters();
+    blur_parameters->algorithm = algorithm;
     blur_parameters->iterations = iterations;
     blur_parameters->offset = offset;
     blur_parameters->noise = noise;
     blur_parameters->scale = scale;
+    blur_parameters->flags = flags;
+    blur_parameters->format = g_pyramid_format.load(std::memory_order_relaxed);
+    blur_parameters->deep_format = g_deep_format.load(std::memory_order_relaxed);
+    blur_parameters->deep_level = g_deep_level.load(std::memory_order_relaxed);
+
+    {
+        std::unique_lock<std::mutex> lock(g_chains_mutex);
+        evict_chains(*context, frame);
+
+        // The output covers the viewport, whose top left pixel is the origin of its regions and texture coordinates.
+        const ViewportRect viewport = find_viewport(*context, draw_list, frame);
+        blur_parameters->origin = viewport.pos;
+        const int width = (int)viewport.size.x > 1 ? (int)viewport.size.x : 1;
+        const int height = (int)viewport.size.y > 1 ? (int)viewport.size.y : 1;
+
+        CachedChain* chain = claim_chain(*context, *find_pyramids(*context, viewport.id), *blur_parameters, frame);
+        if (chain->output.width != width || chain->output.height != height) {
+            // The last frame's callback may still be running the chain at the old size.
+            wait_for_chains(lock, chain);
+            if (chain->output.handle != nullptr)
+                g_pool.resize(g_backend, chain->output, width, height, chain->output.format);
+            chain->output.width = width;
+            chain->output.height = height;
+            chain->cache.valid = false;
+        }
+        // Backends that fuse the final upsample into render() only keep the display sized output while get_texture() uses it.
+        // Left for a later frame while a callback still runs the chain.
+        if (chain->output.handle != nullptr && g_backend->can_render_upsample() && !chain->running
+            && (int)(frame - chain->output_requested) >= IMGUI_BLUR_FRAMES_IN_FLIGHT) {
+            g_pool.release(chain->output);
+            chain->output.width = width;
+            chain->output.height = height;
+            chain->cache.output_valid = false;
+        }
+        blur_parameters->chain = chain;
+        if (!g_backend->can_render_upsample())
+            request_output(lock, *blur_parameters, frame);
+    }
 
-    g_blur_parameters_current.push_back(blur_parameters);
+    g_last_snapshot = (ImU64)frame << 32 | (arena_offset + 1);
+    g_last_snapshot_context = context;
 
     draw_list->AddCallback(post_process_callback, blur_parameters);
     draw_list->AddCallback(ImDrawCallback_ResetRenderState, nullptr);
+    return g_last_snapshot;
+}
+
+void blur::new_frame() {
+    if (g_backend == nullptr)
+        return;
+    BlurContext* context = find_context(true);
+    if (context == nullptr)
+        return;
+    std::lock_guard<std::mutex> lock(g_chains_mutex);
+    copy_viewports(*context, (ImU32)ImGui::GetFrameCount());
+}
+
+blur::Snapshot blur::process(ImDrawList* draw_list, int iterations, float offset, float noise, float scale, ProcessFlags flags) {
+    return queue_process(draw_list, Algorithm_Kawase, iterations, offset, noise, scale, flags);
+}
+
+// Fitted to the impulse response of the CPU backend: the spread doubles with every iteration and with every halving
+// of the scale, offsets between 1 and 3 widen it linearly.
+static const float g_radius_base = 0.3f;
+static const float g_radius_per_offset = 0.44f;
+static const float g_adaptive_scales[blur::AdaptiveController::max_steps] = { 1.0f, 0.75f, 0.5f, 0.375f, 0.25f };
+static const float g_adaptive_min_offset = 1.0f;
+static const float g_adaptive_max_offset = 3.0f; // beyond this the sparse taps start to alias
+static const float g_min_box_radius = 3.0f;       // below this the odd box widths miss the variance by a third or more
+static const int g_adaptive_max_iterations = 8;
+
+float blur::get_blur_radius(int iterations, float offset, float scale) {
+    return (float)(1 << iterations) / scale * (g_radius_base + g_radius_per_offset * offset);
+}
+
+// Relative to one full resolution pass: the copy of the frame, two passes per level with each level a quarter of the
+// one above, and a fixed cost per pass that dominates the small levels. Offset is free, iterations are not.
+static float adaptive_cost(float scale, int iterations) {
+    float cost = 0.25f;
+    float area = scale * scale;
+    for (int i = 0; i <= iterations; ++i) {
+        cost += 2.0f * area + 0.1f;
+        area *= 0.25f;
+    }
+    return cost;
+}
+
+// Work of a full scale Kawase chain in bilinear taps: 5 per pixel for every downsample, 8 for every upsample, with each
+// level a quarter of the one above. The last 8 go into the display, fused into render() or not.
+static float kawase_taps(int iterations, float pixels) {
+    float taps = pixels * 8.0f;
+    float area = pixels;
+    for (int i = 0; i <= iterations; ++i) {
+        taps += area * (i < iterations ? 13.0f : 5.0f);
+        area *= 0.25f;
+    }
+    return taps;
+}
+
+// The fewest iterations that keep the offset at most g_adaptive_max_offset. Lower scales blur by themselves and are
+// left out once a single iteration already spreads further than 'radius'; full scale is always kept.
+int blur::AdaptiveController::build_ladder(float radius, AdaptiveSetting* ladder) {
+    const float max_spread = g_radius_base + g_radius_per_offset * g_adaptive_max_offset;
+    int count = 0;
+    for (int i = 0; i < max_steps; ++i) {
+        const float scale = g_adaptive_scales[i];
+        int iterations = 1;
+        while (iterations < g_adaptive_max_iterations && radius * scale / (float)(1 << iterations) > max_spread)
+            ++iterations;
+
+        float offset = (radius * scale / (float)(1 << iterations) - g_radius_base) / g_radius_per_offset;
+        if (offset < g_adaptive_min_offset) {
+            if (count > 0)
+                break;
+            offset = g_adaptive_min_offset;
+        }
+
+        AdaptiveSetting& setting = ladder[count++];
+        setting.scale = scale;
+        setting.iterations = iterations;
+        setting.offset = offset < g_adaptive_max_offset ? offset : g_adaptive_max_offset;
+        setting.cost = adaptive_cost(scale, iterations);
+    }
+    return count;
+}
+
+// Drops as far as the measured time scaled by the cost model says is needed, right away when far over budget and
+// after two measurements otherwise. Climbs one step only after climb_wait measurements predicting the better step
+// fits with room to spare; a climb that has to be undone doubles the wait, so a wrong cost model cannot make it
+// oscillate. Either way, measurements of frames before the last change are ignored.
+void blur::AdaptiveController::update(int frame, const AdaptiveParameters& parameters, FrameTimer& timer) {
+    if (frame == updated_frame)
+        return;
+    updated_frame = frame;
+
+    AdaptiveSetting ladder[max_steps];
+    const int count = build_ladder(parameters.radius, ladder);
+    if (step >= count) {
+        step = count - 1;
+        changed_frame = frame;
+    }
+
+    int timed_frame = -1;
+    float ms = 0.0f;
+    if (!timer.measure(timed_frame, ms) || timed_frame <= measured_frame || timed_frame < changed_frame)
+        return;
+    measured_frame = timed_frame;
+
+    const float budget = parameters.budget_ms;
+    if (budget <= 0.0f)
+        return;
+
+    if (ms > budget) {
+        under_budget = 0;
+        if (++over_budget < 2 && ms < budget * 1.5f)
+            return;
+
+        int next = step;
+        while (next + 1 < count && ms * ladder[next].cost / ladder[step].cost > budget * 0.9f)
+            ++next;
+        if (next != step) {
+            if (climbed && climb_wait < max_climb_wait)
+                climb_wait *= 2;
+            step = next;
+            changed_frame = frame;
+            climbed = false;
+        }
+        over_budget = 0;
+    } else {
+        over_budget = 0;
+        if (step > 0 && ms * ladder[step - 1].cost / ladder[step].cost < budget * 0.85f) {
+            if (++under_budget >= climb_wait) {
+                --step;
+                changed_frame = frame;
+                under_budget = 0;
+                climbed = true;
+            }
+        } else {
+            under_budget = 0;
+        }
+    }
+}
+
+blur::AdaptiveSetting blur::AdaptiveController::setting(float radius) const {
+    AdaptiveSetting ladder[max_steps];
+    const int count = build_ladder(radius, ladder);
+    return ladder[step < count ? step : count - 1];
+}
+
+void blur::set_adaptive_timer(FrameTimer* timer) {
+    std::lock_guard<std::mutex> lock(g_adaptive_mutex);
+    g_adaptive_timer = timer != nullptr ? timer : &g_stats_timer;
+}
+
+// Both separable chains cost two passes over level 0 plus the upsample into the display, the gaussian's grow with the
+// radius while the box blur's sliding windows do not. Kawase is taken at the full scale setting of the ladder.
+blur::Algorithm blur::select_algorithm(float radius, int width, int height) {
+    if (g_backend == nullptr)
+        return Algorithm_Kawase;
+    // A single iteration at the smallest offset already spreads further.
+    if (radius < get_blur_radius(1, g_adaptive_min_offset, 1.0f))
+        return Algorithm_Gaussian;
+
+    const KernelCosts costs = g_backend->kernel_costs();
+    const float pixels = (float)(width > 1 ? width : 1) * (float)(height > 1 ? height : 1);
+    const float separable_cost = pixels * 8.0f * costs.tap + costs.pass * 3.0f;
+
+    AdaptiveSetting ladder[AdaptiveController::max_steps];
+    AdaptiveController::build_ladder(radius, ladder);
+    Algorithm best = Algorithm_Kawase;
+    float best_cost = kawase_taps(ladder[0].iterations, pixels) * costs.tap + (ladder[0].iterations * 2 + 2) * costs.pass;
+
+    if (radius <= max_gaussian_sigma) {
+        const float cost = separable_cost + pixels * (gaussian_kernel(radius).tap_count * 4 - 2) * costs.tap;
+        if (cost < best_cost) {
+            best = Algorithm_Gaussian;
+            best_cost = cost;
+        }
+    }
+    if (costs.box_axis > 0.0f && radius >= g_min_box_radius && separable_cost + pixels * 2.0f * costs.box_axis < best_cost)
+        best = Algorithm_Box;
+    return best;
+}
+
+blur::Snapshot blur::process(ImDrawList* draw_list, const AdaptiveParameters& parameters) {
+    BlurContext* context = find_context(true);
+    if (context == nullptr)
+        return 0;
+
+    AdaptiveSetting setting;
+    bool full_scale = false;
+    {
+        std::lock_guard<std::mutex> lock(g_adaptive_mutex);
+        context->adaptive.update(ImGui::GetFrameCount(), parameters, *g_adaptive_timer);
+        setting = context->adaptive.setting(parameters.radius);
+        full_scale = context->adaptive.step == 0;
+    }
+
+    Algorithm algorithm = parameters.algorithm;
+    if (algorithm == Algorithm_Auto) {
+        ImVec2 display;
+        {
+            std::lock_guard<std::mutex> lock(g_chains_mutex);
+            display = find_viewport(*context, draw_list, (ImU32)ImGui::GetFrameCount()).size;
+        }
+        algorithm = full_scale ? select_algorithm(parameters.radius, (int)display.x, (int)display.y) : Algorithm_Kawase;
+    }
+    if ((algorithm == Algorithm_Gaussian && parameters.radius > max_gaussian_sigma)
+        || (algorithm == Algorithm_Box && (g_backend == nullptr || g_backend->kernel_costs().box_axis <= 0.0f)))
+        algorithm = Algorithm_Kawase;
+
+    // The separable chains blur level 0 at full scale by the radius itself.
+    if (algorithm != Algorithm_Kawase)
+        return queue_process(draw_list, algorithm, 0, parameters.radius, parameters.noise, 1.0f, parameters.flags);
+    return process(draw_list, setting.iterations, setting.offset, parameters.noise, setting.scale, parameters.flags);
 }
 
 void blur::render(ImDrawList* draw_list, const ImVec2 min, const ImVec2 max, ImU32 col, float rounding, ImDrawFlags draw_flags) {
-    ImGuiIO& io = ImGui::GetIO();
-    if (g_framebuffer.srv == nullptr)
+    render(draw_list, last_snapshot(), min, max, col, rounding, draw_flags);
+}
+
+static void add_clipped_region(ImDrawList* draw_list, blur::Snapshot snapshot, const ImVec2 min, const ImVec2 max) {
+    const ImVec2 clip_min = draw_list->GetClipRectMin();
+    const ImVec2 clip_max = draw_list->GetClipRectMax();
+    blur::add_region(snapshot,
+        { min.x > clip_min.x ? min.x : clip_min.x, min.y > clip_min.y ? min.y : clip_min.y },
+        { max.x < clip_max.x ? max.x : clip_max.x, max.y < clip_max.y ? max.y : clip_max.y });
+}
+
+void blur::render(ImDrawList* draw_list, Snapshot snapshot, const ImVec2 min, const ImVec2 max, ImU32 col, float rounding, ImDrawFlags draw_flags) {
+    BlurParameters* parameters = find_parameters(snapshot);
+    if (g_backend == nullptr || parameters == nullptr)
         return;
 
-    ImTextureID texture_id = blur::get_texture();
+    add_clipped_region(draw_list, snapshot, min, max);
+
+    // The shape itself runs the final upsample from level 0, tinted by its vertex color.
+    if (g_backend->can_render_upsample()) {
+        draw_list->AddCallback(render_begin_callback, parameters);
+        draw_list->AddRectFilled(min, max, col, rounding, draw_flags);
+        draw_list->AddCallback(render_end_callback, nullptr);
+        draw_list->AddCallback(ImDrawCallback_ResetRenderState, nullptr);
+        return;
+    }
+
+    ImTextureID texture_id = blur::get_texture(snapshot);
     if (texture_id == 0)
         return;
+    draw_list->AddImageRounded(texture_id, min, max, get_texture_uv(snapshot, min), get_texture_uv(snapshot, max), col, rounding, draw_flags);
+}
 
-    draw_list->AddImageRounded(texture_id, min, max,
-        { min.x / io.DisplaySize.x, min.y / io.DisplaySize.y },
-        { max.x / io.DisplaySize.x, max.y / io.DisplaySize.y },
-        col, rounding, draw_flags);
+void blur::render(ImDrawList* draw_list, const ImVec2 min, const ImVec2 max, float radius, ImU32 col, float rounding, ImDrawFlags draw_flags) {
+    render(draw_list, last_snapshot(), min, max, radius, col, rounding, draw_flags);
 }
 
-void blur::garbage_collect() {
-    for (int i = 0; i < g_blur_parameters_previous.Size; ++i) {
-        BlurParameters* object = g_blur_parameters_previous[i];
-        //LOG_DEBUG("garbage collecting blur object {}", (void*)object);
-        IM_FREE(object);
+void blur::render(ImDrawList* draw_list, Snapshot snapshot, const ImVec2 min, const ImVec2 max, float radius, ImU32 col, float rounding, ImDrawFlags draw_flags) {
+    BlurParameters* parameters = find_parameters(snapshot);
+    if (g_backend == nullptr || parameters == nullptr)
+        return;
+
+    // Only the full blur exists as a texture without a fused upsample, smaller radii fade it out instead.
+    if (!g_backend->can_render_upsample()) {
+        const float full = blur_radius(parameters->algorithm, parameters->iterations, parameters->offset, parameters->scale);
+        const float alpha = radius < full ? mix_weight(radius, 0.0f, full) : 1.0f;
+        const ImU32 col_alpha = (ImU32)(((col >> IM_COL32_A_SHIFT) & 0xFF) * alpha + 0.5f);
+        render(draw_list, snapshot, min, max, (col & ~IM_COL32_A_MASK) | (col_alpha << IM_COL32_A_SHIFT), rounding, draw_flags);
+        return;
+    }
+
+    ImU32 arena_offset = 0;
+    RenderCall* call = (RenderCall*)parameters_arena(*parameters).allocate((ImU32)(snapshot >> 32), sizeof(RenderCall), arena_offset);
+    if (call == nullptr) {
+        // LOG_ERROR("blur frame arena is full, raise IMGUI_BLUR_ARENA_SIZE");
+        return;
+    }
+    call->parameters = parameters;
+    call->radius = radius > 0.0f ? radius : 0.0f;
+    parameters->levels_requested.store(true, std::memory_order_relaxed);
+
+    add_clipped_region(draw_list, snapshot, min, max);
+    draw_list->AddCallback(render_radius_callback, call);
+    draw_list->AddRectFilled(min, max, col, rounding, draw_flags);
+    draw_list->AddCallback(render_end_callback, nullptr);
+    draw_list->AddCallback(ImDrawCallback_ResetRenderState, nullptr);
+}
+
+void blur::add_region(const ImVec2 min, const ImVec2 max) {
+    add_region(last_snapshot(), min, max);
+}
+
+void blur::add_region(Snapshot snapshot, const ImVec2 min, const ImVec2 max) {
+    BlurParameters* parameters = find_parameters(snapshot);
+    if (parameters == nullptr || min.x >= max.x || min.y >= max.y)
+        return;
+
+    ImU32 arena_offset = 0;
+    void* memory = parameters_arena(*parameters).allocate((ImU32)(snapshot >> 32), sizeof(RegionNode), arena_offset);
+    if (memory == nullptr) {
+        // LOG_WARN("blur frame arena is full, dropping region");
+        return;
+    }
+
+    RegionNode* node = IM_PLACEMENT_NEW(memory) RegionNode();
+    node->rect = { min.x - parameters->origin.x, min.y - parameters->origin.y, max.x - parameters->origin.x, max.y - parameters->origin.y };
+    node->next = parameters->regions.load(std::memory_order_relaxed);
+    while (!parameters->regions.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed)) {}
+}
+
+// Pushes a display space rectangle onto the damage of 'parameters', an empty one only marks the frame as reported.
+static void push_damage(blur::BlurParameters& parameters, ImU32 frame, const ImVec4& rect) {
+    if (rect.x < rect.z && rect.y < rect.w) {
+        ImU32 arena_offset = 0;
+        void* memory = parameters_arena(parameters).allocate(frame, sizeof(blur::RegionNode), arena_offset);
+        if (memory == nullptr) {
+            // LOG_WARN("blur frame arena is full, recomputing the whole blur");
+            parameters.damage_state.store(blur::DamageState_Lost, std::memory_order_release);
+            return;
+        }
+
+        blur::RegionNode* node = IM_PLACEMENT_NEW(memory) blur::RegionNode();
+        node->rect = { rect.x - parameters.origin.x, rect.y - parameters.origin.y, rect.z - parameters.origin.x, rect.w - parameters.origin.y };
+        node->next = parameters.damage.load(std::memory_order_relaxed);
+        while (!parameters.damage.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed)) {}
+    }
+
+    int state = blur::DamageState_Unknown;
+    parameters.damage_state.compare_exchange_strong(state, blur::DamageState_Reported, std::memory_order_acq_rel);
+}
+
+void blur::add_damage(const ImVec2 min, const ImVec2 max) {
+    add_damage(last_snapshot(), min, max);
+}
+
+void blur::add_damage(Snapshot snapshot, const ImVec2 min, const ImVec2 max) {
+    BlurParameters* parameters = find_parameters(snapshot);
+    if (parameters != nullptr)
+        push_damage(*parameters, (ImU32)(snapshot >> 32), { min.x, min.y, max.x, max.y });
+}
+
+// 64-bit multiply-xorshift over whole words.
+static ImU64 hash_bytes(const void* data, size_t size, ImU64 hash) {
+    const ImU64 prime = 0x9E3779B97F4A7C15ull;
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (; size >= 8; bytes += 8, size -= 8) {
+        ImU64 word;
+        memcpy(&word, bytes, 8);
+        hash = (hash ^ word) * prime;
+        hash ^= hash >> 32;
+    }
+    for (; size > 0; ++bytes, --size)
+        hash = (hash ^ *bytes) * prime;
+    return hash;
+}
+
+// Bounds of the vertices a command draws inside its clip rectangle, and a hash of everything that decides its pixels.
+// Every command is read in full each frame, about the bytes the renderer uploads: ImGui refills the same buffers at the
+// same offsets every frame, so an unchanged VtxOffset, IdxOffset, ElemCount and buffer pointer say nothing about what
+// the vertices hold.
+static CommandRecord record_command(const ImDrawList* list, const ImDrawCmd& cmd) {
+    const ImDrawIdx* indices = list->IdxBuffer.Data + cmd.IdxOffset;
+    const ImDrawVert* vertices = list->VtxBuffer.Data + cmd.VtxOffset;
+    ImVec4 bounds = { FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX };
+    unsigned int first = ~0u, last = 0;
+    for (unsigned int i = 0; i < cmd.ElemCount; ++i) {
+        const unsigned int index = indices[i];
+        first = index < first ? index : first;
+        last = index > last ? index : last;
+        const ImVec2 pos = vertices[index].pos;
+        bounds.x = pos.x < bounds.x ? pos.x : bounds.x;
+        bounds.y = pos.y < bounds.y ? pos.y : bounds.y;
+        bounds.z = pos.x > bounds.z ? pos.x : bounds.z;
+        bounds.w = pos.y > bounds.w ? pos.y : bounds.w;
     }
-    g_blur_parameters_previous.clear();
 
-    g_blur_parameters_previous.swap(g_blur_parameters_current);
-    g_blur_parameters_current.clear();
+    const ImTextureID texture = cmd.GetTexID();
+    ImU64 hash = hash_bytes(&cmd.ClipRect, sizeof(cmd.ClipRect), 0xCBF29CE484222325ull);
+    hash = hash_bytes(&texture, sizeof(texture), hash);
+    hash = hash_bytes(indices, cmd.ElemCount * sizeof(ImDrawIdx), hash);
+    if (first <= last)
+        hash = hash_bytes(vertices + first, (last - first + 1) * sizeof(ImDrawVert), hash);
+
+    CommandRecord record;
+    record.bounds.x = bounds.x > cmd.ClipRect.x ? bounds.x : cmd.ClipRect.x;
+    record.bounds.y = bounds.y > cmd.ClipRect.y ? bounds.y : cmd.ClipRect.y;
+    record.bounds.z = bounds.z < cmd.ClipRect.z ? bounds.z : cmd.ClipRect.z;
+    record.bounds.w = bounds.w < cmd.ClipRect.w ? bounds.w : cmd.ClipRect.w;
+    record.hash = hash;
+    return record;
+}
+
+static void add_damage_rect(blur::RegionSet& damage, const ImVec4& rect) {
+    if (rect.x < rect.z && rect.y < rect.w)
+        damage.add({ (int)floorf(rect.x), (int)floorf(rect.y), (int)ceilf(rect.z), (int)ceilf(rect.w) });
+}
+
+// History of the viewport 'id', dropping those of viewports that were not rendered last frame along the way.
+static CommandHistory* find_command_history(BlurContext& context, ImGuiID id, int frame) {
+    CommandHistory* found = nullptr;
+    for (int i = 0; i < context.command_histories.Size; ++i) {
+        CommandHistory* history = context.command_histories[i];
+        if (history->viewport == id) {
+            found = history;
+        } else if (history->frame < frame - 1) {
+            IM_DELETE(history);
+            context.command_histories.erase(context.command_histories.Data + i--);
+        }
+    }
+
+    if (found == nullptr) {
+        found = IM_NEW(CommandHistory);
+        found->viewport = id;
+        context.command_histories.push_back(found);
+    }
+    return found;
+}
+
+// Walks the commands in drawing order, so each process() callback gets what changed underneath it. Commands are matched
+// by their index in their draw list: a mismatch damages both the old and the new bounds. Shapes blur::render() draws
+// change whenever their blur does, which is whenever anything before them changed; under set_max_refresh_rate() a blur
+// can also catch up on an older change, so they are always damaged then. Other user callbacks may draw anything
+// inside their clip rectangle. Every viewport is diffed against its own draw data of the last frame.
+void blur::add_damage(const ImDrawData* draw_data) {
+    BlurContext* context = find_context(true);
+    if (context == nullptr)
+        return;
+
+    ImGuiID viewport = ImGui::GetMainViewport()->ID;
+#ifdef IMGUI_HAS_VIEWPORT
+    if (draw_data->OwnerViewport != nullptr)
+        viewport = draw_data->OwnerViewport->ID;
+#endif
+    const int frame = ImGui::GetFrameCount();
+    CommandHistory& history = *find_command_history(*context, viewport, frame);
+    // The records have to be of the previous frame, or what changed in between is unknown.
+    const bool report = history.frame == frame - 1;
+    history.frame = frame;
+
+    history.next_records.resize(0);
+    history.next_lists.resize(0);
+    RegionSet damage;
+    for (int l = 0; l < draw_data->CmdLists.Size; ++l) {
+        const ImDrawList* list = draw_data->CmdLists[l];
+        const int old_first = l + 1 < history.lists.Size ? history.lists[l] : 0;
+        const int old_count = l + 1 < history.lists.Size ? history.lists[l + 1] - old_first : 0;
+        const BlurParameters* blurred = nullptr; // between the callbacks around a blur::render() shape
+        float blurred_radius = -1.0f;
+        history.next_lists.push_back(history.next_records.Size);
+
+        for (int c = 0; c < list->CmdBuffer.Size; ++c) {
+            const ImDrawCmd& cmd = list->CmdBuffer[c];
+            CommandRecord record = { { 0.0f, 0.0f, 0.0f, 0.0f }, (ImU64)(intptr_t)cmd.UserCallback };
+            if (cmd.UserCallback == post_process_callback) {
+                BlurParameters* parameters = (BlurParameters*)cmd.UserCallbackData;
+                for (int i = 0; i < damage.count && report; ++i) {
+                    const Rect& rect = damage.rects[i];
+                    push_damage(*parameters, (ImU32)frame, { (float)rect.x0, (float)rect.y0, (float)rect.x1, (float)rect.y1 });
+                }
+                if (report)
+                    push_damage(*parameters, (ImU32)frame, { 0.0f, 0.0f, 0.0f, 0.0f });
+            } else if (cmd.UserCallback == render_begin_callback || cmd.UserCallback == render_radius_callback) {
+                const bool radius = cmd.UserCallback == render_radius_callback;
+                blurred = radius ? ((const RenderCall*)cmd.UserCallbackData)->parameters : (const BlurParameters*)cmd.UserCallbackData;
+                blurred_radius = radius ? ((const RenderCall*)cmd.UserCallbackData)->radius : -1.0f;
+            } else if (cmd.UserCallback == render_end_callback) {
+                blurred = nullptr;
+            } else if (cmd.UserCallback != nullptr && cmd.UserCallback != ImDrawCallback_ResetRenderState) {
+                add_damage_rect(damage, cmd.ClipRect);
+            } else if (cmd.UserCallback == nullptr) {
+                record = record_command(list, cmd);
+                if (blurred != nullptr) {
+                    const float settings[] = { (float)blurred->algorithm, (float)blurred->iterations, blurred->offset, blurred->noise, blurred->scale, blurred_radius };
+                    record.hash = hash_bytes(settings, sizeof(settings), record.hash);
+                }
+            }
+
+            const CommandRecord* old = c < old_count ? &history.records[old_first + c] : nullptr;
+            if (old == nullptr || old->hash != record.hash || (blurred != nullptr && (damage.count > 0 || g_refresh_interval.load(std::memory_order_relaxed) > 0.0))) {
+                add_damage_rect(damage, record.bounds);
+                if (old != nullptr)
+                    add_damage_rect(damage, old->bounds);
+            }
+            history.next_records.push_back(record);
+        }
+        // Commands past the end of the list are gone.
+        for (int c = list->CmdBuffer.Size; c < old_count; ++c)
+            add_damage_rect(damage, history.records[old_first + c].bounds);
+    }
+    history.next_lists.push_back(history.next_records.Size);
+
+    history.records.swap(history.next_records);
+    history.lists.swap(history.next_lists);
+}
+
+void blur::set_max_refresh_rate(float hz) {
+    g_refresh_interval.store(hz > 0.0f ? 1.0 / hz : 0.0, std::memory_order_relaxed);
+}
+
+void blur::set_pyramid_format(PyramidFormat format, PyramidFormat deep_format, int deep_level) {
+    g_pyramid_format.store(format, std::memory_order_relaxed);
+    g_deep_format.store(deep_format, std::memory_order_relaxed);
+    g_deep_level.store(deep_level > 0 ? deep_level : 0, std::memory_order_relaxed);
+}
+
+void blur::set_framebuffer_budget(size_t bytes) {
+    g_pool_budget = bytes;
+}
+
+void blur::garbage_collect() {
+    BlurContext* context = find_context(false);
+    std::lock_guard<std::mutex> lock(g_chains_mutex);
+    if (g_backend == nullptr)
+        return;
+
+    if (context != nullptr)
+        evict_chains(*context, (ImU32)ImGui::GetFrameCount());
+    g_pool.trim(g_backend, g_pool_budget);
 }
 
 ImTextureID blur::get_texture() {
-    return (ImTextureID)g_framebuffer.srv;
+    return get_texture(last_snapshot());
+}
+
+ImTextureID blur::get_texture(Snapshot snapshot) {
+    BlurParameters* parameters = find_parameters(snapshot);
+    if (g_backend == nullptr || parameters == nullptr)
+        return 0;
+
+    std::unique_lock<std::mutex> lock(g_chains_mutex);
+    if (!request_output(lock, *parameters, (ImU32)(snapshot >> 32)))
+        return 0;
+    return g_backend->get_texture_id(parameters->chain->output);
 }
 
+ImVec2 blur::get_texture_uv(const ImVec2 pos) {
+    return get_texture_uv(last_snapshot(), pos);
+}
+
+ImVec2 blur::get_texture_uv(Snapshot snapshot, const ImVec2 pos) {
+    BlurParameters* parameters = find_parameters(snapshot);
+    if (g_backend == nullptr || parameters == nullptr)
+        return { 0.0f, 0.0f };
+
+    std::unique_lock<std::mutex> lock(g_chains_mutex);
+    if (!request_output(lock, *parameters, (ImU32)(snapshot >> 32)))
+        return { 0.0f, 0.0f };
+    const Framebuffer& output = parameters->chain->output;
+    return { (pos.x - parameters->origin.x) / output.texture_width, (pos.y - parameters->origin.y) / output.texture_height };
+}
+
+blur::Stats blur::get_stats() {
+    Stats stats;
+    BlurContext* context = find_context(false);
+    if (context != nullptr) {
+        std::lock_guard<std::mutex> lock(g_stats_mutex);
+        roll_counters(*context, ImGui::GetFrameCount());
+        stats = context->timed;
+        for (int i = 0; i < Stats::history_size; ++i)
+            stats.total_history_ms[i] = context->history[(context->history_next + i) % Stats::history_size];
+
+        stats.chains = context->counted.counts[Counter_Chains];
+        stats.passes = context->counted.counts[Counter_Passes];
+        stats.framebuffers_created = context->counted.counts[Counter_FramebuffersCreated];
+        stats.views_created = context->counted.counts[Counter_ViewsCreated];
+        stats.constant_updates = context->counted.counts[Counter_ConstantUpdates];
+        stats.framebuffers_created_total = context->framebuffers_created_total;
+    }
+
+    // The levels of a chain being run change size under the callback.
+    std::unique_lock<std::mutex> lock(g_chains_mutex);
+    wait_for_chains(lock);
+    if (context != nullptr) {
+        stats.viewports = context->viewports.Size;
+        for (const ViewportPyramids* pyramids : context->viewports) {
+            for (const CachedChain* chain : pyramids->chains) {
+                for (int i = 0; i < chain->levels.Size; ++i)
+                    stats.level_bytes[i < Stats::max_levels ? i : Stats::max_levels - 1] += texture_bytes(chain->levels[i]);
+                for (const Framebuffer& framebuffer : chain->scratch)
+                    stats.scratch_bytes += texture_bytes(framebuffer);
+                stats.output_bytes += texture_bytes(chain->output);
+            }
+        }
+    }
+    stats.idle_bytes = g_pool.idle_bytes();
+    return stats;
+}
+
+void blur::show_stats_window(bool* open) {
+    if (!ImGui::Begin("Blur", open)) {
+        ImGui::End();
+        return;
+    }
+
+    const Stats stats = get_stats();
+    ImGui::Text("%s timing, frame %d: %.3f ms", stats.gpu_timing ? "GPU" : "CPU", stats.timed_frame, stats.total_ms);
+    ImGui::PlotLines("##total", stats.total_history_ms, Stats::history_size, 0, nullptr, 0.0f, FLT_MAX, ImVec2(-1.0f, 60.0f));
+
+    int levels = stats.levels;
+    for (int i = levels; i < Stats::max_levels; ++i) {
+        if (stats.level_bytes[i] > 0)
+            levels = i + 1;
+    }
+
+    float level_ms[Stats::max_levels];
+    for (int i = 0; i < levels; ++i)
+        level_ms[i] = stats.downsample_ms[i] + stats.upsample_ms[i];
+    if (levels > 0)
+        ImGui::PlotHistogram("##levels", level_ms, levels, 0, "ms per level", 0.0f, FLT_MAX, ImVec2(-1.0f, 60.0f));
+
+    if (levels > 0 && ImGui::BeginTable("levels", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("Level");
+        ImGui::TableSetupColumn("Down ms");
+        ImGui::TableSetupColumn("Up ms");
+        ImGui::TableSetupColumn("KiB");
+        ImGui::TableHeadersRow();
+        for (int i = 0; i < levels; ++i) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%d", i);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", stats.downsample_ms[i]);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", stats.upsample_ms[i]);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.0f", stats.level_bytes[i] / 1024.0);
+        }
+        ImGui::EndTable();
+    }
+
+    ImGui::Text("Chains: %d, passes: %d, viewports: %d", stats.chains, stats.passes, stats.viewports);
+    ImGui::Text("Framebuffers created: %d (%d since setup)", stats.framebuffers_created, stats.framebuffers_created_total);
+    ImGui::Text("Views created: %d, constant updates: %d", stats.views_created, stats.constant_updates);
+    ImGui::Text("Output: %.1f MiB, scratch: %.1f MiB, idle: %.1f MiB", stats.output_bytes / (1024.0 * 1024.0), stats.scratch_bytes / (1024.0 * 1024.0), stats.idle_bytes / (1024.0 * 1024.0));
+    ImGui::End();
+}
@@ -6,12 +6,201 @@ struct ID3D11Device;
 struct ID3D11DeviceContext;
 
 namespace blur {
-	bool setup(ID3D11Device* device, ID3D11DeviceContext* device_context);
+	// RGBA8 image used by the CPU backend. ImTextureIDs handed out by the CPU backend point to one of these.
+	class CpuImage {
+	public:
+		unsigned char* pixels = nullptr;
+		int width = 0, height = 0;
+		int stride = 0; // bytes per row
+	};
+
+	enum CpuKernel {
+		CpuKernel_Auto,   // fastest kernel this machine supports
+		CpuKernel_Scalar, // float reference
+		CpuKernel_SSE2,
+		CpuKernel_AVX2,
+		CpuKernel_NEON,
+	};
+
+	enum ProcessFlags_ {
+		ProcessFlags_None = 0,
+		ProcessFlags_BackgroundClean = 1 << 0, // nothing behind the blur changed since the last process(), reuse its result
+		ProcessFlags_ContentHash = 1 << 1,     // reuse the last result when a fingerprint of the captured frame matches
+		ProcessFlags_Incremental = 1 << 2,     // keep every level and only recompute the tiles the damage touched, see add_damage()
+	};
+	typedef int ProcessFlags;
+
+	// Identifies the result of one process() call for IMGUI_BLUR_FRAMES_IN_FLIGHT frames, 0 when nothing was queued.
+	typedef ImU64 Snapshot;
+
+	// What the last setup() spent on shaders. Saved time is what loading from blobs avoided compiling.
+	class SetupReport {
+	public:
+		int embedded = 0; // shaders created from IMGUI_BLUR_PRECOMPILED_SHADERS bytecode
+		int cached = 0;   // loaded from the shader cache directory
+		int compiled = 0;
+		float setup_ms = 0.0f;
+		float compile_ms = 0.0f;
+		float saved_ms = 0.0f;
+	};
+
+	// What the blur costs, see get_stats(). Pass times come from timer queries read back a few frames late so they never
+	// stall the device; backends without queries time each pass on the CPU, which for a GPU only measures submission.
+	class Stats {
+	public:
+		static const int max_levels = 16; // deeper pyramids are added to the last level
+		static const int history_size = 120;
+
+		// Frame 'timed_frame', summed over every chain. Level 0 is the first downsample of the captured frame.
+		float downsample_ms[max_levels] = {}; // pass writing level i
+		float upsample_ms[max_levels] = {};   // pass reading level i, the one reading level 0 writes the output
+		float total_ms = 0.0f;                // also counts chains ChainPath_Compute ran in one batch, which have no per-level times
+		float total_history_ms[history_size] = {}; // oldest first
+		int timed_frame = -1;
+		int levels = 0; // levels with a time
+		bool gpu_timing = false;
+
+		// Last finished frame.
+		int chains = 0; // chains that ran their passes
+		int viewports = 0; // viewports holding pyramids right now
+		int passes = 0;
+		int framebuffers_created = 0; // pyramid textures the pool had to allocate
+		int views_created = 0;        // shader resource / render target views created
+		int constant_updates = 0;     // constant buffers created or mapped, uniform uploads
+
+		int framebuffers_created_total = 0; // since setup()
+
+		// Right now, summed over every chain. Levels past 0 are shared by every chain and only taken from the pool
+		// while one runs, in between they count as idle; ProcessFlags_Incremental chains keep theirs.
+		size_t level_bytes[max_levels] = {};
+		size_t output_bytes = 0;
+		size_t scratch_bytes = 0; // kept between runs by ProcessFlags_Incremental chains
+		size_t idle_bytes = 0; // unused textures kept by the pool, see set_framebuffer_budget()
+	};
+
+	// How the adaptive process() blurs, see select_algorithm().
+	enum Algorithm {
+		Algorithm_Auto,     // the cheapest of the ones below for the radius and display size
+		Algorithm_Kawase,   // downsample / upsample pyramid, any radius; the only one the budget can scale down
+		Algorithm_Gaussian, // exact separable gaussian at full resolution, radii up to 8
+		Algorithm_Box,      // three box blurs per axis at full resolution, same cost for any radius; CPU backend only
+	};
+
+	// Target of the adaptive process() overload.
+	class AdaptiveParameters {
+	public:
+		float budget_ms = 1.0f; // what every blur of a frame may take together, as get_stats() measures it, 0 for no limit
+		float radius = 16.0f;   // display pixels, about the standard deviation of a gaussian with the same spread
+		float noise = 0.01f;
+		ProcessFlags flags = 0;
+		Algorithm algorithm = Algorithm_Auto; // unsupported choices fall back to Algorithm_Kawase
+	};
+
+	// Texture format of the pyramid levels, see set_pyramid_format(). Backends fall back to RGBA8 for formats they cannot
+	// render to; the CPU backend only has RGBA8.
+	enum PyramidFormat {
+		PyramidFormat_Auto,       // follows the captured frame: RGBA8, RGB10A2 behind 10 bit targets, R11G11B10F behind float ones
+		PyramidFormat_RGBA8,      // sRGB encoded behind sRGB targets, so the blur runs on linear colors without banding
+		PyramidFormat_RGB10A2,
+		PyramidFormat_R11G11B10F, // HDR at 4 bytes per pixel, no alpha and no negative (scRGB wide gamut) values
+		PyramidFormat_RGBA16F,    // keeps everything a float target holds, at twice the bandwidth
+		PyramidFormat_RGB565,     // half the bandwidth of RGBA8, meant for deep levels where the blur hides the banding
+	};
+
+	// How the D3D11 backend runs the pass chain.
+	enum ChainPath {
+		ChainPath_PixelShader, // one draw per pass
+		ChainPath_Compute,     // every downsample in a single dispatch, then one dispatch per upsample; needs feature level 11_0
+	};
+
+	// Directory for compiled shader bytecode, keyed by source hash and compiler version. Call before setup(), nullptr disables it.
+	void set_shader_cache_path(const char* directory);
+
+	bool setup(ID3D11Device* device, ID3D11DeviceContext* device_context, ChainPath path = ChainPath_PixelShader);
+	// OpenGL 3.3 core / ES 3.0 backend for imgui_impl_opengl3, call with the GL context current. 'glsl_version' is the
+	// #version line handed to ImGui_ImplOpenGL3_Init(), nullptr for "#version 330 core".
+	bool setup_opengl3(const char* glsl_version = nullptr);
+	bool setup_cpu();
+	// Frees every context's state too.
 	void destroy();
+	// Frees what the blur keeps for an ImGui context (nullptr for the current one), call it before ImGui::DestroyContext().
+	void destroy_context(ImGuiContext* context = nullptr);
+	const SetupReport& get_setup_report();
+	// Of the current ImGui context, only the idle textures are shared with other contexts. Waits for chains the draw
+	// callbacks are still running.
+	Stats get_stats();
+	// Debug window plotting get_stats(), call it between ImGui::NewFrame() and ImGui::Render().
+	void show_stats_window(bool* open = nullptr);
+
+	// CPU backend only: the buffer the software renderer is drawing into, captured by every process() callback.
+	void set_cpu_target(const CpuImage& target);
+	// CPU backend only: picks the row kernel, returns false if it is not available on this machine.
+	bool set_cpu_kernel(CpuKernel kernel);
+	CpuKernel get_cpu_kernel();
+	// CPU backend only: threads sharing each pyramid level, including the rendering thread. 0 uses every core.
+	void set_cpu_threads(int thread_count);
+
+	// Copies ImGui's viewports for this frame's process() calls. Call it on the main thread once the frame's windows are
+	// begun and before other threads record, when process() is called off the main thread.
+	void new_frame();
 
-	void process(ImDrawList* draw_list, int iterations = 4, float offset = 2.0f, float noise = 0.01f, float scale = 1.0f);
+	// Every call in a frame keeps its own pyramid, picked up again next frame by the call with the closest parameters.
+	// Results are only reused when the parameters match the last computed blur and it covers every region sampled this frame.
+	// State is kept per ImGui context, and pyramids per viewport: a draw list blurs the viewport its clip rectangle lies
+	// in (the smallest one holding all of it), at that viewport's size.
+	// Safe to call from any thread recording a draw list. The parameters go to a per-frame arena, but each call takes a
+	// lock for the chain lookup, and the first call for a context or viewport and every new pyramid allocate. The draw
+	// callbacks run the chains without that lock; a call only waits for the last frame's run of its chain when the
+	// output has to be reallocated, after the viewport was resized or on the first get_texture().
+	// Unless new_frame() copied them, the first call of each frame copies ImGui's viewports, which the main thread moves
+	// in NewFrame() and Begin(), so make that one on the main thread. Debug builds assert a single thread copies them.
+	Snapshot process(ImDrawList* draw_list, int iterations = 4, float offset = 2.0f, float noise = 0.01f, float scale = 1.0f, ProcessFlags flags = 0);
+	// Picks the cheapest scale, iterations and offset approximating 'radius', stepping the scale down while the measured
+	// blur time is over budget and back up once the better setting is predicted to fit. Every adaptive call shares one
+	// controller; it only moves again once timings of the frame it changed in came back, so it does not oscillate.
+	// Algorithm_Auto only picks the gaussian or box blur while the controller is at full scale.
+	Snapshot process(ImDrawList* draw_list, const AdaptiveParameters& parameters);
+	// Spread of a blur in display pixels, the model the adaptive process() inverts. Fitted for offsets 1 to 3.
+	float get_blur_radius(int iterations, float offset, float scale);
+	// What Algorithm_Auto runs for 'radius' on a 'width' x 'height' display with the active backend: whichever supported
+	// algorithm its cost model predicts to be the fastest, except that radii below the smallest Kawase blur always get
+	// the gaussian and the box blur is only considered from radius 3, below which it is visibly off.
+	Algorithm select_algorithm(float radius, int width, int height);
+	// Overloads without a snapshot use the last process() call on the calling thread.
 	void render(ImDrawList* draw_list, const ImVec2 min, const ImVec2 max, ImU32 col, float rounding = 0.0f, ImDrawFlags draw_flags = 0);
+	void render(ImDrawList* draw_list, Snapshot snapshot, const ImVec2 min, const ImVec2 max, ImU32 col, float rounding = 0.0f, ImDrawFlags draw_flags = 0);
+	// Blurs by 'radius' display pixels (see get_blur_radius()) instead of the full strength of the process() call, by
+	// mixing the two closest pyramid levels; radii past the full strength draw it unchanged. One process() call then
+	// serves every strength in a frame, and animating the radius never rebuilds the pyramid. While used, the pyramid
+	// keeps its downsampled levels (about twice the memory below level 0). Backends that cannot fuse the final upsample
+	// (the CPU backend) fade the full blur in instead.
+	void render(ImDrawList* draw_list, const ImVec2 min, const ImVec2 max, float radius, ImU32 col, float rounding = 0.0f, ImDrawFlags draw_flags = 0);
+	void render(ImDrawList* draw_list, Snapshot snapshot, const ImVec2 min, const ImVec2 max, float radius, ImU32 col, float rounding = 0.0f, ImDrawFlags draw_flags = 0);
+	// Marks a display space rectangle of a process() result as used. render() does this for you; call it when
+	// drawing get_texture() yourself, only the union of these rectangles (plus the blur reach) is ever computed.
+	void add_region(const ImVec2 min, const ImVec2 max);
+	void add_region(Snapshot snapshot, const ImVec2 min, const ImVec2 max);
+	// ProcessFlags_Incremental: a display space rectangle whose pixels behind the blur changed since the previous frame.
+	// Frames without any report are recomputed in full, an empty rectangle reports that nothing changed.
+	void add_damage(const ImVec2 min, const ImVec2 max);
+	void add_damage(Snapshot snapshot, const ImVec2 min, const ImVec2 max);
+	// Reports damage for every process() call in 'draw_data' by diffing its commands against the last call's: commands
+	// whose vertices, texture, clip rectangle or callback changed damage their bounds, old and new, for the blurs drawn
+	// after them. Call it once per frame between ImGui::Render() and rendering the draw data. Textures whose pixels change
+	// on their own (video, render targets) still need add_damage(). It hashes every index and vertex of the draw data.
+	void add_damage(const ImDrawData* draw_data);
+	// Optional: parameters are reclaimed with their frame, this only trims unused pyramids and textures early.
 	void garbage_collect();
+	// Recomputes a reusable blur at most 'hz' times per second, frames in between keep the last result. 0 disables the cap.
+	void set_max_refresh_rate(float hz);
+	// Bytes of unused pyramid textures kept around for iteration changes and resizes. Trimmed by garbage_collect().
+	void set_framebuffer_budget(size_t bytes);
+	// Levels from 'deep_level' on use 'deep_format', PyramidFormat_Auto there keeps 'format'. Applies from the next process().
+	void set_pyramid_format(PyramidFormat format, PyramidFormat deep_format = PyramidFormat_Auto, int deep_level = 2);
 
+	// The texture can be larger than the display, map display positions with get_texture_uv() when drawing it yourself.
 	ImTextureID get_texture();
+	ImTextureID get_texture(Snapshot snapshot);
+	ImVec2 get_texture_uv(const ImVec2 pos);
+	ImVec2 get_texture_uv(Snapshot snapshot, const ImVec2 pos);
 }
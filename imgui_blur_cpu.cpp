@@ -0,0 +1,980 @@
+#include "imgui_blur.h"
+#include "imgui_blur_internal.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Reference implementation of g_downsample_src/g_upsample_src/g_gaussian_src (imgui_blur_dx11.cpp) on RGBA8 buffers.
+// Sampling follows D3D11: pixel centers at +0.5, bilinear taps with 8 bits of subtexel precision and
+// mirror addressing, every level quantized back to 8 bits like an R8G8B8A8_UNORM render target.
+//
+// Each destination row is handed to a row kernel. The scalar kernel is the float reference, the SIMD kernels
+// use 16-bit fixed point lanes (one RGBA pixel per 128 bits) and stay within 1 LSB of it. The gaussian passes run
+// through the same row kernels with their taps spread along one axis; the box passes have sliding windows of their own.
+// Define IMGUI_BLUR_CPU_VERIFY to check every SIMD row against the scalar kernel.
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMGUI_BLUR_SSE2
+#include <emmintrin.h>
+#if defined(_MSC_VER) || defined(__GNUC__) || defined(__clang__)
+#define IMGUI_BLUR_AVX2
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define IMGUI_BLUR_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(IMGUI_BLUR_AVX2) && (defined(__GNUC__) || defined(__clang__))
+#define IMGUI_BLUR_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define IMGUI_BLUR_TARGET_AVX2
+#endif
+
+class KernelTap {
+public:
+    int x, y; // multiples of half_pixel * offset, or entries of the tap axes for the gaussian passes
+    int weight;
+};
+
+static const KernelTap g_downsample_taps[] = {
+    {  0,  0, 4 },
+    { -1, -1, 1 },
+    {  1,  1, 1 },
+    {  1, -1, 1 },
+    { -1,  1, 1 },
+};
+
+static const KernelTap g_upsample_taps[] = {
+    { -2,  0, 1 },
+    { -1,  1, 2 },
+    {  0,  2, 1 },
+    {  1,  1, 2 },
+    {  2,  0, 1 },
+    {  1, -1, 2 },
+    {  0, -2, 1 },
+    { -1, -1, 2 },
+};
+
+// At offset 0 every tap reads the same place and one does, as in the copy that ends a separable chain.
+static const KernelTap g_center_taps[] = {
+    {  0,  0, 1 },
+};
+
+static const int g_max_tap_reach = 2;
+static const int g_max_taps = blur::max_gaussian_taps * 2 - 1;
+
+// One bilinear tap along one axis: the two texels it reads and the weight of the second in 1/256ths.
+class TapAxis {
+public:
+    int i0, i1;
+    int f;
+    int weights; // (f << 16) | (256 - f), both weights as a 16-bit pair
+};
+
+// One kernel tap resolved for a single destination row.
+class RowTap {
+public:
+    const unsigned char* r0;
+    const unsigned char* r1;
+    const TapAxis* columns;
+    int fy;
+    int weight;
+};
+
+class RowJob {
+public:
+    unsigned char* dst;
+    int x0, x1;
+    int y;
+    const RowTap* taps;
+    int tap_count;
+    int total_weight;
+    float noise_scale;
+};
+
+typedef void (*RowKernel)(const RowJob& job);
+
+static blur::CpuImage g_target{};
+static ImVector<TapAxis> g_columns{};
+static ImVector<TapAxis> g_rows{};
+
+static int mirror(int i, int size) {
+    const int period = size * 2;
+    i %= period;
+    if (i < 0) i += period;
+    return i < size ? i : period - 1 - i;
+}
+
+// 't' is the sampled position in texels of the source, 0 at the center of its first texel.
+static void set_tap_axis(TapAxis& out, float t, int src_size) {
+    int t0 = (int)floorf(t);
+    int f = (int)((t - t0) * 256.0f + 0.5f);
+    if (f == 256) { ++t0; f = 0; }
+    out.i0 = mirror(t0, src_size);
+    out.i1 = mirror(t0 + 1, src_size);
+    out.f = f;
+    out.weights = (f << 16) | (256 - f);
+}
+
+static void build_axis(ImVector<TapAxis>& axis, int dst_size, int src_size, float offset) {
+    axis.resize((g_max_tap_reach * 2 + 1) * dst_size);
+    for (int m = -g_max_tap_reach; m <= g_max_tap_reach; ++m) {
+        TapAxis* out = &axis[(m + g_max_tap_reach) * dst_size];
+        for (int x = 0; x < dst_size; ++x) {
+            const float u = (x + 0.5f) / dst_size + m * (0.5f / dst_size) * offset;
+            set_tap_axis(out[x], u * src_size - 0.5f, src_size);
+        }
+    }
+}
+
+// Axis of a pass at the size of its input, one entry per tap 'offsets' texels away.
+static void build_tap_axis(ImVector<TapAxis>& axis, int size, const float* offsets, int count) {
+    axis.resize(count * size);
+    for (int m = 0; m < count; ++m) {
+        TapAxis* out = &axis[m * size];
+        for (int x = 0; x < size; ++x)
+            set_tap_axis(out[x], x + offsets[m], size);
+    }
+}
+
+static float hash_noise(int x, int y) {
+    const float px = x + 0.5f, py = y + 0.5f;
+    const float a = sinf(px * 12.9898f + py * 78.233f) * 43758.5453f;
+    const float b = sinf(px * 0.1f * 7.898f + py * 0.1f * 4.233f) * 23421.631f;
+    return ((a - floorf(a)) + (b - floorf(b))) * 0.5f - 0.5f;
+}
+
+static void row_kernel_scalar(const RowJob& job) {
+    const float inv_total = 1.0f / job.total_weight;
+    for (int x = job.x0; x < job.x1; ++x) {
+        float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for (int t = 0; t < job.tap_count; ++t) {
+            const RowTap& tap = job.taps[t];
+            const TapAxis& col = tap.columns[x];
+            const float fx = col.f / 256.0f, fy = tap.fy / 256.0f;
+            for (int c = 0; c < 4; ++c) {
+                const float top = tap.r0[col.i0 * 4 + c] + (tap.r0[col.i1 * 4 + c] - tap.r0[col.i0 * 4 + c]) * fx;
+                const float bottom = tap.r1[col.i0 * 4 + c] + (tap.r1[col.i1 * 4 + c] - tap.r1[col.i0 * 4 + c]) * fx;
+                sum[c] += (top + (bottom - top) * fy) * tap.weight;
+            }
+        }
+
+        const float grain = job.noise_scale > 0.0f ? hash_noise(x, job.y) * job.noise_scale : 0.0f;
+        for (int c = 0; c < 4; ++c) {
+            float v = sum[c] * inv_total + (c < 3 ? grain : 0.0f);
+            v = v < 0.0f ? 0.0f : v > 255.0f ? 255.0f : v;
+            job.dst[x * 4 + c] = (unsigned char)(v + 0.5f);
+        }
+    }
+}
+
+#ifdef IMGUI_BLUR_SSE2
+static inline __m128i load_pixel_pair(const unsigned char* row, int i0, int i1) {
+    int a, b;
+    memcpy(&a, row + i0 * 4, 4);
+    memcpy(&b, row + i1 * 4, 4);
+    return _mm_unpacklo_epi8(_mm_unpacklo_epi8(_mm_cvtsi32_si128(a), _mm_cvtsi32_si128(b)), _mm_setzero_si128());
+}
+
+// Weighted bilinear tap for one pixel, 4 x int32 scaled by 256 * 256 / 2 * weight.
+static inline __m128i bilinear_tap_sse2(const RowTap& tap, const TapAxis& col) {
+    const __m128i wx = _mm_set1_epi32(col.weights);
+    const __m128i wy = _mm_set1_epi32(((tap.fy * tap.weight) << 16) | ((256 - tap.fy) * tap.weight));
+    // Horizontal lerp in 32-bit lanes (<= 255 * 256), halved so both rows fit back into one 16-bit pair.
+    const __m128i h0 = _mm_srli_epi32(_mm_madd_epi16(load_pixel_pair(tap.r0, col.i0, col.i1), wx), 1);
+    const __m128i h1 = _mm_srli_epi32(_mm_madd_epi16(load_pixel_pair(tap.r1, col.i0, col.i1), wx), 1);
+    return _mm_madd_epi16(_mm_or_si128(h0, _mm_slli_epi32(h1, 16)), wy);
+}
+
+static inline int resolve_pixel_sse2(__m128i sum, __m128 scale, float grain) {
+    __m128 v = _mm_mul_ps(_mm_cvtepi32_ps(sum), scale);
+    v = _mm_add_ps(v, _mm_set_ps(0.0f, grain, grain, grain));
+    const __m128i i = _mm_cvtps_epi32(v);
+    return _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packs_epi32(i, i), _mm_setzero_si128()));
+}
+
+static void row_kernel_sse2(const RowJob& job) {
+    const __m128 scale = _mm_set1_ps(1.0f / (32768.0f * job.total_weight));
+    for (int x = job.x0; x < job.x1; ++x) {
+        __m128i sum = _mm_setzero_si128();
+        for (int t = 0; t < job.tap_count; ++t)
+            sum = _mm_add_epi32(sum, bilinear_tap_sse2(job.taps[t], job.taps[t].columns[x]));
+
+        const float grain = job.noise_scale > 0.0f ? hash_noise(x, job.y) * job.noise_scale : 0.0f;
+        const int pixel = resolve_pixel_sse2(sum, scale, grain);
+        memcpy(job.dst + x * 4, &pixel, 4);
+    }
+}
+#endif
+
+#ifdef IMGUI_BLUR_AVX2
+IMGUI_BLUR_TARGET_AVX2
+static inline __m256i load_pixel_pairs_avx2(const unsigned char* row, const TapAxis& a, const TapAxis& b) {
+    int p[4];
+    memcpy(&p[0], row + a.i0 * 4, 4);
+    memcpy(&p[1], row + a.i1 * 4, 4);
+    memcpy(&p[2], row + b.i0 * 4, 4);
+    memcpy(&p[3], row + b.i1 * 4, 4);
+    const __m128i lo = _mm_unpacklo_epi8(_mm_cvtsi32_si128(p[0]), _mm_cvtsi32_si128(p[1]));
+    const __m128i hi = _mm_unpacklo_epi8(_mm_cvtsi32_si128(p[2]), _mm_cvtsi32_si128(p[3]));
+    return _mm256_cvtepu8_epi16(_mm_unpacklo_epi64(lo, hi));
+}
+
+// Same math as row_kernel_sse2, two pixels per 256-bit register.
+IMGUI_BLUR_TARGET_AVX2
+static void row_kernel_avx2(const RowJob& job) {
+    const __m256 scale = _mm256_set1_ps(1.0f / (32768.0f * job.total_weight));
+    int x = job.x0;
+    for (; x + 2 <= job.x1; x += 2) {
+        __m256i sum = _mm256_setzero_si256();
+        for (int t = 0; t < job.tap_count; ++t) {
+            const RowTap& tap = job.taps[t];
+            const TapAxis& a = tap.columns[x];
+            const TapAxis& b = tap.columns[x + 1];
+            const __m256i wx = _mm256_setr_epi32(a.weights, a.weights, a.weights, a.weights, b.weights, b.weights, b.weights, b.weights);
+            const __m256i wy = _mm256_set1_epi32(((tap.fy * tap.weight) << 16) | ((256 - tap.fy) * tap.weight));
+            const __m256i h0 = _mm256_srli_epi32(_mm256_madd_epi16(load_pixel_pairs_avx2(tap.r0, a, b), wx), 1);
+            const __m256i h1 = _mm256_srli_epi32(_mm256_madd_epi16(load_pixel_pairs_avx2(tap.r1, a, b), wx), 1);
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_or_si256(h0, _mm256_slli_epi32(h1, 16)), wy));
+        }
+
+        __m256 v = _mm256_mul_ps(_mm256_cvtepi32_ps(sum), scale);
+        if (job.noise_scale > 0.0f) {
+            const float g0 = hash_noise(x, job.y) * job.noise_scale;
+            const float g1 = hash_noise(x + 1, job.y) * job.noise_scale;
+            v = _mm256_add_ps(v, _mm256_setr_ps(g0, g0, g0, 0.0f, g1, g1, g1, 0.0f));
+        }
+
+        const __m256i i = _mm256_cvtps_epi32(v);
+        const __m128i packed = _mm_packs_epi32(_mm256_castsi256_si128(i), _mm256_extracti128_si256(i, 1));
+        _mm_storel_epi64((__m128i*)(job.dst + x * 4), _mm_packus_epi16(packed, _mm_setzero_si128()));
+    }
+
+    if (x < job.x1) {
+        RowJob tail = job;
+        tail.x0 = x;
+        row_kernel_sse2(tail);
+    }
+}
+#endif
+
+#ifdef IMGUI_BLUR_NEON
+static void row_kernel_neon(const RowJob& job) {
+    const float32x4_t scale = vdupq_n_f32(1.0f / (65536.0f * job.total_weight));
+    for (int x = job.x0; x < job.x1; ++x) {
+        uint32x4_t sum = vdupq_n_u32(0);
+        for (int t = 0; t < job.tap_count; ++t) {
+            const RowTap& tap = job.taps[t];
+            const TapAxis& col = tap.columns[x];
+            uint32_t p[4];
+            memcpy(&p[0], tap.r0 + col.i0 * 4, 4);
+            memcpy(&p[1], tap.r0 + col.i1 * 4, 4);
+            memcpy(&p[2], tap.r1 + col.i0 * 4, 4);
+            memcpy(&p[3], tap.r1 + col.i1 * 4, 4);
+            const uint16x8_t top = vmovl_u8(vcreate_u8((uint64_t)p[0] | ((uint64_t)p[1] << 32)));
+            const uint16x8_t bottom = vmovl_u8(vcreate_u8((uint64_t)p[2] | ((uint64_t)p[3] << 32)));
+            // Horizontal lerp (<= 255 * 256) then vertical in 32-bit lanes, no intermediate rounding.
+            const uint32x4_t h0 = vmlal_n_u16(vmull_n_u16(vget_low_u16(top), (uint16_t)(256 - col.f)), vget_high_u16(top), (uint16_t)col.f);
+            const uint32x4_t h1 = vmlal_n_u16(vmull_n_u16(vget_low_u16(bottom), (uint16_t)(256 - col.f)), vget_high_u16(bottom), (uint16_t)col.f);
+            sum = vmlaq_n_u32(sum, h0, (uint32_t)((256 - tap.fy) * tap.weight));
+            sum = vmlaq_n_u32(sum, h1, (uint32_t)(tap.fy * tap.weight));
+        }
+
+        float32x4_t v = vmulq_f32(vcvtq_f32_u32(sum), scale);
+        if (job.noise_scale > 0.0f) {
+            const float grain = hash_noise(x, job.y) * job.noise_scale;
+            const float grain_rgb[4] = { grain, grain, grain, 0.0f };
+            v = vaddq_f32(v, vld1q_f32(grain_rgb));
+        }
+
+        v = vminq_f32(vmaxq_f32(v, vdupq_n_f32(0.0f)), vdupq_n_f32(255.0f));
+        const uint16x4_t narrow = vmovn_u32(vcvtq_u32_f32(vaddq_f32(v, vdupq_n_f32(0.5f))));
+        const uint32_t pixel = vget_lane_u32(vreinterpret_u32_u8(vmovn_u16(vcombine_u16(narrow, narrow))), 0);
+        memcpy(job.dst + x * 4, &pixel, 4);
+    }
+}
+#endif
+
+static bool cpu_supports(blur::CpuKernel kernel) {
+    switch (kernel) {
+    case blur::CpuKernel_Scalar:
+        return true;
+#ifdef IMGUI_BLUR_SSE2
+    case blur::CpuKernel_SSE2:
+        return true;
+#endif
+#ifdef IMGUI_BLUR_AVX2
+    case blur::CpuKernel_AVX2: {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return false;
+        __cpuid(info, 1);
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        if (!osxsave || (_xgetbv(0) & 0x6) != 0x6)
+            return false;
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports("avx2") != 0;
+#endif
+    }
+#endif
+#ifdef IMGUI_BLUR_NEON
+    case blur::CpuKernel_NEON:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+static RowKernel get_row_kernel(blur::CpuKernel kernel) {
+    switch (kernel) {
+#ifdef IMGUI_BLUR_SSE2
+    case blur::CpuKernel_SSE2: return row_kernel_sse2;
+#endif
+#ifdef IMGUI_BLUR_AVX2
+    case blur::CpuKernel_AVX2: return row_kernel_avx2;
+#endif
+#ifdef IMGUI_BLUR_NEON
+    case blur::CpuKernel_NEON: return row_kernel_neon;
+#endif
+    default: return row_kernel_scalar;
+    }
+}
+
+static blur::CpuKernel g_cpu_kernel = blur::CpuKernel_Scalar;
+static RowKernel g_row_kernel = row_kernel_scalar;
+
+#ifdef IMGUI_BLUR_CPU_VERIFY
+// Verification builds only, so the scratch row is allocated per call: rows are as wide as their level and run on every
+// thread of the pool.
+static void verify_row(const RowJob& job) {
+    ImVector<unsigned char> reference;
+    reference.resize(job.x1 * 4);
+
+    RowJob scalar = job;
+    scalar.dst = reference.Data;
+    row_kernel_scalar(scalar);
+
+    for (int i = job.x0 * 4; i < job.x1 * 4; ++i) {
+        const int diff = (int)job.dst[i] - (int)reference[i];
+        IM_ASSERT(diff >= -1 && diff <= 1 && "simd blur kernel drifted from the scalar reference");
+    }
+}
+#endif
+
+// Work-stealing pool used to spread a level's rows over every core. Each level is one run(): bands are dealt out
+// in contiguous chunks per queue, owners pop from the back, idle threads steal from the front of other queues,
+// and run() returns once every band is done, which is the only barrier between levels.
+class BandTask {
+public:
+    int y0, y1;
+};
+
+typedef void (*BandFunction)(const void* user, int y0, int y1);
+
+class WorkQueue {
+public:
+    bool pop(BandTask& task) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (head == tasks.Size)
+            return false;
+        task = tasks.back();
+        tasks.pop_back();
+        return true;
+    }
+
+    bool steal(BandTask& task) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (head == tasks.Size)
+            return false;
+        task = tasks[head++];
+        return true;
+    }
+
+    std::mutex mutex;
+    ImVector<BandTask> tasks;
+    int head = 0;
+};
+
+class ThreadPool {
+public:
+    ~ThreadPool() {
+        stop();
+    }
+
+    // 'thread_count' includes the calling thread.
+    void start(int thread_count) {
+        stop();
+        for (int i = 0; i < thread_count; ++i)
+            queues.push_back(IM_NEW(WorkQueue));
+        for (int i = 1; i < thread_count; ++i)
+            threads.push_back(IM_NEW(std::thread)(&ThreadPool::worker_main, this, i));
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+
+        for (std::thread* thread : threads) {
+            thread->join();
+            IM_DELETE(thread);
+        }
+        for (WorkQueue* queue : queues)
+            IM_DELETE(queue);
+        threads.clear();
+        queues.clear();
+        stopping = false;
+    }
+
+    int size() const {
+        return queues.Size;
+    }
+
+    void run(int rows, int band_rows, BandFunction function, const void* user) {
+        const int band_count = (rows + band_rows - 1) / band_rows;
+        band_function = function;
+        band_user = user;
+        pending.store(band_count);
+
+        for (int q = 0; q < queues.Size; ++q) {
+            WorkQueue* queue = queues[q];
+            std::lock_guard<std::mutex> lock(queue->mutex);
+            queue->tasks.clear();
+            queue->head = 0;
+            for (int band = band_count * q / queues.Size; band < band_count * (q + 1) / queues.Size; ++band) {
+                const int y0 = band * band_rows;
+                queue->tasks.push_back({ y0, y0 + band_rows < rows ? y0 + band_rows : rows });
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex);
+            ++generation;
+        }
+        wake.notify_all();
+
+        while (execute_one(0)) {}
+
+        std::unique_lock<std::mutex> lock(wake_mutex);
+        done.wait(lock, [this] { return pending.load() == 0; });
+    }
+
+private:
+    bool execute_one(int index) {
+        BandTask task;
+        bool found = queues[index]->pop(task);
+        for (int i = 1; !found && i < queues.Size; ++i)
+            found = queues[(index + i) % queues.Size]->steal(task);
+        if (!found)
+            return false;
+
+        band_function(band_user, task.y0, task.y1);
+        if (pending.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lock(wake_mutex);
+            done.notify_all();
+        }
+        return true;
+    }
+
+    void worker_main(int index) {
+        int seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(wake_mutex);
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping)
+                    return;
+                seen = generation;
+            }
+
+            while (execute_one(index)) {}
+        }
+    }
+
+    ImVector<WorkQueue*> queues;
+    ImVector<std::thread*> threads;
+    std::mutex wake_mutex;
+    std::condition_variable wake, done;
+    int generation = 0;
+    bool stopping = false;
+    std::atomic<int> pending{ 0 };
+    BandFunction band_function = nullptr;
+    const void* band_user = nullptr;
+};
+
+// Levels smaller than this run on the calling thread, so the tail of the pyramid costs no synchronization at all.
+static const int g_min_parallel_pixels = 128 * 128;
+
+static ThreadPool g_pool{};
+static int g_thread_count = 0;
+
+static int resolve_thread_count() {
+    const int thread_count = g_thread_count > 0 ? g_thread_count : (int)std::thread::hardware_concurrency();
+    return thread_count > 0 ? thread_count : 1;
+}
+
+class PassContext {
+public:
+    const blur::CpuImage* dst;
+    const blur::CpuImage* src;
+    const KernelTap* taps; // x and y index g_columns and g_rows from 'axis_base'
+    int axis_base;
+    int tap_count;
+    int total_weight;
+    float noise_scale;
+    int x0, x1; // columns of the region being written
+    int first_row;
+};
+
+static void kawase_rows(const void* user, int y0, int y1) {
+    const PassContext& pass = *(const PassContext*)user;
+    const blur::CpuImage& dst = *pass.dst;
+    const blur::CpuImage& src = *pass.src;
+
+    RowTap row_taps[g_max_taps];
+    RowJob job{};
+    job.x0 = pass.x0;
+    job.x1 = pass.x1;
+    job.taps = row_taps;
+    job.tap_count = pass.tap_count;
+    job.total_weight = pass.total_weight;
+    job.noise_scale = pass.noise_scale;
+
+    for (int y = pass.first_row + y0; y < pass.first_row + y1; ++y) {
+        for (int t = 0; t < pass.tap_count; ++t) {
+            const TapAxis& row = g_rows[(pass.taps[t].y + pass.axis_base) * dst.height + y];
+            row_taps[t].r0 = src.pixels + row.i0 * src.stride;
+            row_taps[t].r1 = src.pixels + row.i1 * src.stride;
+            row_taps[t].columns = &g_columns[(pass.taps[t].x + pass.axis_base) * dst.width];
+            row_taps[t].fy = row.f;
+            row_taps[t].weight = pass.taps[t].weight;
+        }
+
+        job.dst = dst.pixels + y * dst.stride;
+        job.y = y;
+        g_row_kernel(job);
+#ifdef IMGUI_BLUR_CPU_VERIFY
+        verify_row(job);
+#endif
+    }
+}
+
+// 'halo' is how many source rows the taps reach above and below a destination row.
+static void run_pass(PassContext& pass, float halo, const blur::RegionSet& regions) {
+    const blur::CpuImage& dst = *pass.dst;
+    const blur::CpuImage& src = *pass.src;
+    for (int i = 0; i < regions.count; ++i) {
+        const blur::Rect& region = regions.rects[i];
+        pass.x0 = region.x0;
+        pass.x1 = region.x1;
+        pass.first_row = region.y0;
+
+        const int rows = region.y1 - region.y0;
+        if (g_pool.size() <= 1 || (region.x1 - region.x0) * rows < g_min_parallel_pixels) {
+            kawase_rows(&pass, 0, rows);
+            continue;
+        }
+
+        // Bands read a halo of source rows around their own footprint. Keep bands at least twice that tall so the
+        // overlap between neighbours stays a small fraction of the reads.
+        const float rows_per_row = (float)src.height / dst.height;
+        const int halo_rows = (int)ceilf(halo) + 1;
+        int band_rows = (rows + g_pool.size() * 4 - 1) / (g_pool.size() * 4);
+        if (band_rows * rows_per_row < halo_rows * 2)
+            band_rows = (int)ceilf(halo_rows * 2 / rows_per_row);
+
+        g_pool.run(rows, band_rows, kawase_rows, &pass);
+    }
+}
+
+static void kawase_pass(const blur::CpuImage& dst, const blur::CpuImage& src, blur::Kernel kernel, float offset, float noise, const blur::RegionSet& regions) {
+    PassContext pass{};
+    pass.dst = &dst;
+    pass.src = &src;
+    pass.taps = offset == 0.0f ? g_center_taps : kernel == blur::Kernel_Downsample ? g_downsample_taps : g_upsample_taps;
+    pass.axis_base = g_max_tap_reach;
+    pass.tap_count = offset == 0.0f ? IM_ARRAYSIZE(g_center_taps) : kernel == blur::Kernel_Downsample ? IM_ARRAYSIZE(g_downsample_taps) : IM_ARRAYSIZE(g_upsample_taps);
+    for (int t = 0; t < pass.tap_count; ++t)
+        pass.total_weight += pass.taps[t].weight;
+    pass.noise_scale = noise > 0.0f ? noise * 0.3f * 255.0f : 0.0f;
+
+    build_axis(g_columns, dst.width, src.width, offset);
+    build_axis(g_rows, dst.height, src.height, offset);
+    run_pass(pass, g_max_tap_reach * offset * 0.5f * src.height / dst.height, regions);
+}
+
+// Both sides of every tap of the kernel closest to 'sigma' along one axis, the other axis reads its own texel.
+// Taps rounded to a zero fixed point weight are left out.
+static void gaussian_pass(const blur::CpuImage& dst, const blur::CpuImage& src, bool vertical, float sigma, float noise, const blur::RegionSet& regions) {
+    const blur::GaussianKernel& kernel = blur::gaussian_kernel(sigma);
+    KernelTap taps[g_max_taps];
+    float offsets[g_max_taps];
+    int count = 0;
+    for (int i = 0; i < kernel.tap_count; ++i) {
+        if (kernel.fixed_weights[i] == 0)
+            continue;
+        for (int side = i == 0 ? 1 : -1; side <= 1; side += 2) {
+            offsets[count] = kernel.offsets[i] * side;
+            taps[count] = { vertical ? 0 : count, vertical ? count : 0, kernel.fixed_weights[i] };
+            ++count;
+        }
+    }
+
+    PassContext pass{};
+    pass.dst = &dst;
+    pass.src = &src;
+    pass.taps = taps;
+    pass.axis_base = 0;
+    pass.tap_count = count;
+    pass.total_weight = blur::gaussian_fixed_total;
+    pass.noise_scale = noise > 0.0f ? noise * 0.3f * 255.0f : 0.0f;
+
+    const float center = 0.0f;
+    build_tap_axis(g_columns, dst.width, vertical ? &center : offsets, vertical ? 1 : count);
+    build_tap_axis(g_rows, dst.height, vertical ? offsets : &center, vertical ? count : 1);
+    run_pass(pass, vertical ? (float)kernel.reach : 0.0f, regions);
+}
+
+// Box passes blur lines gathered from the source, g_box_group of them side by side so every step of the running sums
+// is a fixed number of interleaved values the compiler can vectorize: groups of rows of the region for x, groups of
+// columns for y. A line holds the texels 'reach' past either end of the region (mirrored at the image edges) as 8.8
+// fixed point, and each of the three boxes is a running sum over it that costs the same at any width. Every band of
+// groups owns one slice of g_box_lines.
+static const int g_box_group = 16;
+static const int g_box_channels = g_box_group * 4;
+
+class BoxContext {
+public:
+    const blur::CpuImage* dst;
+    const blur::CpuImage* src;
+    blur::BoxKernel kernel;
+    bool vertical;
+    float noise_scale;
+    blur::Rect region;
+    int band_groups;
+    int band_size; // values per band in g_box_lines, the lines and their scratch copy
+};
+
+static ImVector<unsigned short> g_box_lines{};
+
+// Runs the three boxes over 'length' positions, ping-ponging between 'lines' and 'scratch'. Each box loses its half
+// width at either end; the result is returned at [reach, length - reach).
+static const unsigned short* box_blur_lines(unsigned short* lines, unsigned short* scratch, int length, const blur::BoxKernel& kernel) {
+    int sums[g_box_channels];
+    int lo = 0, hi = length;
+    for (int b = 0; b < 3; ++b) {
+        const int width = kernel.widths[b];
+        const int radius = width / 2;
+        if (radius == 0)
+            continue;
+
+        const float inverse = 1.0f / width;
+        for (int c = 0; c < g_box_channels; ++c)
+            sums[c] = 0;
+        for (int p = lo; p < lo + width; ++p) {
+            const unsigned short* in = lines + p * g_box_channels;
+            for (int c = 0; c < g_box_channels; ++c)
+                sums[c] += in[c];
+        }
+
+        for (int p = lo + radius; p < hi - radius; ++p) {
+            unsigned short* out = scratch + p * g_box_channels;
+            for (int c = 0; c < g_box_channels; ++c)
+                out[c] = (unsigned short)(sums[c] * inverse + 0.5f);
+            if (p + radius + 1 < hi) {
+                const unsigned short* enter = lines + (p + radius + 1) * g_box_channels;
+                const unsigned short* leave = lines + (p - radius) * g_box_channels;
+                for (int c = 0; c < g_box_channels; ++c)
+                    sums[c] += enter[c] - leave[c];
+            }
+        }
+
+        lo += radius;
+        hi -= radius;
+        unsigned short* swap = lines;
+        lines = scratch;
+        scratch = swap;
+    }
+    return lines;
+}
+
+// Writes one pixel from 8.8 fixed point values.
+static inline void resolve_box(unsigned char* out, const unsigned short* values, float grain) {
+    if (grain == 0.0f) {
+        for (int c = 0; c < 4; ++c)
+            out[c] = (unsigned char)((values[c] + 128) >> 8);
+        return;
+    }
+    for (int c = 0; c < 4; ++c) {
+        const float v = values[c] * (1.0f / 256.0f) + (c < 3 ? grain : 0.0f);
+        out[c] = (unsigned char)(v < 0.0f ? 0.0f : v > 255.0f ? 255.0f : v + 0.5f);
+    }
+}
+
+static void box_groups(const void* user, int g0, int g1) {
+    const BoxContext& box = *(const BoxContext*)user;
+    const blur::CpuImage& dst = *box.dst;
+    const blur::CpuImage& src = *box.src;
+    const blur::Rect& region = box.region;
+    const int reach = box.kernel.reach;
+    const int length = (box.vertical ? region.y1 - region.y0 : region.x1 - region.x0) + reach * 2;
+    unsigned short* lines = &g_box_lines[g0 / box.band_groups * box.band_size];
+    unsigned short* scratch = lines + length * g_box_channels;
+
+    for (int group = g0; group < g1; ++group) {
+        // Lines past the end of the region stay zero.
+        const int first = (box.vertical ? region.x0 : region.y0) + group * g_box_group;
+        const int end = box.vertical ? region.x1 : region.y1;
+        const int count = first + g_box_group < end ? g_box_group : end - first;
+        for (int p = 0; p < length; ++p) {
+            unsigned short* values = lines + p * g_box_channels;
+            if (box.vertical) {
+                const unsigned char* texels = src.pixels + mirror(region.y0 - reach + p, src.height) * src.stride + first * 4;
+                for (int c = 0; c < count * 4; ++c)
+                    values[c] = (unsigned short)(texels[c] << 8);
+            } else {
+                const unsigned char* texels = src.pixels + first * src.stride + mirror(region.x0 - reach + p, src.width) * 4;
+                for (int l = 0; l < count; ++l, texels += src.stride)
+                    for (int c = 0; c < 4; ++c)
+                        values[l * 4 + c] = (unsigned short)(texels[c] << 8);
+            }
+            for (int c = count * 4; c < g_box_channels; ++c)
+                values[c] = 0;
+        }
+
+        const unsigned short* blurred = box_blur_lines(lines, scratch, length, box.kernel) + reach * g_box_channels;
+        for (int p = 0; p < length - reach * 2; ++p) {
+            for (int l = 0; l < count; ++l) {
+                const int x = box.vertical ? first + l : region.x0 + p;
+                const int y = box.vertical ? region.y0 + p : first + l;
+                const float grain = box.noise_scale > 0.0f ? hash_noise(x, y) * box.noise_scale : 0.0f;
+                resolve_box(dst.pixels + y * dst.stride + x * 4, blurred + p * g_box_channels + l * 4, grain);
+            }
+        }
+    }
+}
+
+// Three box blurs approximating a gaussian of 'sigma' texels along one axis, see blur::make_box_kernel().
+static void box_pass(const blur::CpuImage& dst, const blur::CpuImage& src, bool vertical, float sigma, float noise, const blur::RegionSet& regions) {
+    BoxContext box{};
+    box.dst = &dst;
+    box.src = &src;
+    box.kernel = blur::make_box_kernel(sigma);
+    box.vertical = vertical;
+    box.noise_scale = noise > 0.0f ? noise * 0.3f * 255.0f : 0.0f;
+
+    for (int i = 0; i < regions.count; ++i) {
+        const blur::Rect& region = regions.rects[i];
+        const int width = region.x1 - region.x0, height = region.y1 - region.y0;
+        if (width <= 0 || height <= 0)
+            continue;
+
+        box.region = region;
+        const int groups = ((vertical ? width : height) + g_box_group - 1) / g_box_group;
+        box.band_size = ((vertical ? height : width) + box.kernel.reach * 2) * g_box_channels * 2;
+
+        // One band per thread: the groups cost the same, and fewer bands keep g_box_lines small.
+        const bool parallel = g_pool.size() > 1 && width * height >= g_min_parallel_pixels;
+        box.band_groups = parallel ? (groups + g_pool.size() - 1) / g_pool.size() : groups;
+        const int bands = (groups + box.band_groups - 1) / box.band_groups;
+        if (g_box_lines.Size < bands * box.band_size)
+            g_box_lines.resize(bands * box.band_size);
+
+        if (parallel)
+            g_pool.run(groups, box.band_groups, box_groups, &box);
+        else
+            box_groups(&box, 0, groups);
+    }
+}
+
+// 64-bit multiply-xorshift over whole words, about as fast as reading the region once.
+static ImU64 hash_regions(const blur::CpuImage& image, const blur::RegionSet& regions) {
+    const ImU64 prime = 0x9E3779B97F4A7C15ull;
+    ImU64 hash = 0xCBF29CE484222325ull;
+    for (int i = 0; i < regions.count; ++i) {
+        const blur::Rect& rect = regions.rects[i];
+        hash = (hash ^ (ImU64)(rect.x0 | rect.y0 << 16) << 32 ^ (ImU64)(rect.x1 | rect.y1 << 16)) * prime;
+        for (int y = rect.y0; y < rect.y1; ++y) {
+            const unsigned char* row = image.pixels + y * image.stride + rect.x0 * 4;
+            const size_t size = (size_t)(rect.x1 - rect.x0) * 4;
+            size_t offset = 0;
+            for (; offset + 8 <= size; offset += 8) {
+                ImU64 word;
+                memcpy(&word, row + offset, 8);
+                hash = (hash ^ word) * prime;
+                hash ^= hash >> 29;
+            }
+            for (; offset < size; ++offset)
+                hash = (hash ^ row[offset]) * prime;
+        }
+    }
+    return hash;
+}
+
+// Hash of the source regions a chain read last time.
+class CpuContentState {
+public:
+    ImU64 hash = 0;
+    bool valid = false;
+};
+
+// Pooled images can be larger than the framebuffer, the passes only see the top left area in use.
+static blur::CpuImage area_in_use(const blur::Framebuffer& framebuffer) {
+    blur::CpuImage image = *(const blur::CpuImage*)framebuffer.handle;
+    image.width = framebuffer.width;
+    image.height = framebuffer.height;
+    return image;
+}
+
+class CpuBackend : public blur::Backend {
+public:
+    CpuBackend() {
+        g_pool.start(resolve_thread_count());
+    }
+
+    ~CpuBackend() override {
+        g_pool.stop();
+    }
+
+    bool create_framebuffer(blur::Framebuffer& framebuffer, int width, int height, blur::Format format) override {
+        IM_ASSERT(format == blur::Format_RGBA8 && "the CPU backend only has RGBA8 levels, see Backend::supports_format()");
+        (void)format;
+        blur::CpuImage* image = IM_NEW(blur::CpuImage);
+        image->width = width;
+        image->height = height;
+        image->stride = width * 4;
+        image->pixels = (unsigned char*)IM_ALLOC((size_t)image->stride * height);
+        memset(image->pixels, 0, (size_t)image->stride * height);
+
+        framebuffer.handle = image;
+        framebuffer.width = width;
+        framebuffer.height = height;
+        return true;
+    }
+
+    void destroy_framebuffer(blur::Framebuffer& framebuffer) override {
+        blur::CpuImage* image = (blur::CpuImage*)framebuffer.handle;
+        if (image != nullptr) {
+            IM_FREE(image->pixels);
+            IM_DELETE(image);
+        }
+        framebuffer = blur::Framebuffer{};
+    }
+
+    ImTextureID get_texture_id(const blur::Framebuffer& framebuffer) override {
+        return (ImTextureID)(intptr_t)framebuffer.handle;
+    }
+
+    bool begin_chain(blur::Framebuffer& source) override {
+        if (g_target.pixels == nullptr) {
+            // LOG_WARN("blur has no cpu target");
+            return false;
+        }
+
+        source.handle = &g_target;
+        source.width = source.texture_width = g_target.width;
+        source.height = source.texture_height = g_target.height;
+        return true;
+    }
+
+    void render_pass(const blur::Framebuffer& target, const blur::Framebuffer& input, blur::Kernel kernel, float offset, float noise, const blur::RegionSet& regions) override {
+        switch (kernel) {
+        case blur::Kernel_GaussianX:
+        case blur::Kernel_GaussianY:
+            gaussian_pass(area_in_use(target), area_in_use(input), kernel == blur::Kernel_GaussianY, offset, noise, regions);
+            break;
+        case blur::Kernel_BoxX:
+        case blur::Kernel_BoxY:
+            box_pass(area_in_use(target), area_in_use(input), kernel == blur::Kernel_BoxY, offset, noise, regions);
+            break;
+        default:
+            kawase_pass(area_in_use(target), area_in_use(input), kernel, offset, noise, regions);
+            break;
+        }
+    }
+
+    void end_chain() override {}
+
+    // Measured against the AVX2 row kernels at 720p: a box pass costs about as much per pixel as six bilinear taps at
+    // any radius. The fixed cost of a pass is mostly building its tap axes, which the default already covers.
+    blur::KernelCosts kernel_costs() override {
+        blur::KernelCosts costs;
+        costs.box_axis = 6.0f;
+        return costs;
+    }
+
+    blur::ContentCheck begin_content_check(void*& state, const blur::Framebuffer& source, const blur::RegionSet& regions, bool allow_skip) override {
+        if (state == nullptr)
+            state = IM_NEW(CpuContentState);
+
+        CpuContentState& previous = *(CpuContentState*)state;
+        const ImU64 hash = hash_regions(*(const blur::CpuImage*)source.handle, regions);
+        const bool unchanged = previous.valid && hash == previous.hash;
+        previous.hash = hash;
+        previous.valid = true;
+        return allow_skip && unchanged ? blur::ContentCheck_Unchanged : blur::ContentCheck_Changed;
+    }
+
+    void destroy_content_state(void* state) override {
+        IM_DELETE((CpuContentState*)state);
+    }
+};
+
+bool blur::setup_cpu() {
+    destroy();
+    begin_setup_report();
+    set_cpu_kernel(CpuKernel_Auto);
+    const bool result = set_backend(IM_NEW(CpuBackend));
+    end_setup_report();
+    return result;
+}
+
+bool blur::set_cpu_kernel(CpuKernel kernel) {
+    if (kernel == CpuKernel_Auto) {
+        const CpuKernel preferred[] = { CpuKernel_AVX2, CpuKernel_NEON, CpuKernel_SSE2, CpuKernel_Scalar };
+        for (CpuKernel candidate : preferred) {
+            if (cpu_supports(candidate))
+                return set_cpu_kernel(candidate);
+        }
+    }
+
+    if (!cpu_supports(kernel))
+        return false;
+
+    g_cpu_kernel = kernel;
+    g_row_kernel = get_row_kernel(kernel);
+    return true;
+}
+
+blur::CpuKernel blur::get_cpu_kernel() {
+    return g_cpu_kernel;
+}
+
+void blur::set_cpu_threads(int thread_count) {
+    g_thread_count = thread_count;
+    if (g_pool.size() > 0)
+        g_pool.start(resolve_thread_count());
+}
+
+void blur::set_cpu_target(const CpuImage& target) {
+    g_target = target;
+}
@@ -0,0 +1,1238 @@
+#include "imgui_blur.h"
+#include "imgui_blur_internal.h"
+#include "imgui_blur_dx11_shaders.h"
+#include "imgui_impl_dx11.h"
+
+#pragma comment(lib, "d3dcompiler.lib")
+
+#include <d3d11.h>
+#pragma comment(lib, "d3d11.lib")
+
+// Generated by tools/shadergen.cpp, setup() then only compiles shaders whose source changed since.
+#ifdef IMGUI_BLUR_PRECOMPILED_SHADERS
+#include "imgui_blur_dx11_shaders.inl"
+static const int g_precompiled_shader_count = IM_ARRAYSIZE(g_precompiled_shaders);
+#else
+static const blur::PrecompiledShader* g_precompiled_shaders = nullptr;
+static const int g_precompiled_shader_count = 0;
+#endif
+
+class Dx11Framebuffer {
+public:
+    void destroy() {
+        if (tex != nullptr) { tex->Release(); tex = nullptr; }
+        if (rtv != nullptr) { rtv->Release(); rtv = nullptr; }
+        if (srv != nullptr) { srv->Release(); srv = nullptr; }
+        if (uav != nullptr) { uav->Release(); uav = nullptr; }
+    }
+
+    ID3D11Texture2D* tex = nullptr;
+    ID3D11RenderTargetView* rtv = nullptr;
+    ID3D11ShaderResourceView* srv = nullptr;
+    ID3D11UnorderedAccessView* uav = nullptr; // blur::ChainPath_Compute only, R32_UINT view of the RGBA8 texels
+};
+
+// Copy of the source regions a chain read last time, see Dx11Backend::begin_content_check().
+class Dx11ContentState {
+public:
+    Dx11Framebuffer capture{};
+    int width = 0, height = 0;
+    DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+};
+
+class BlurConstants {
+public:
+    ImVec2 half_pixel;
+    float offset;
+    float noise;
+    ImVec2 input_scale;
+    ImVec2 input_half_texel;
+    float opacity;
+    float blend;
+    ImVec2 spacing;
+    ImVec2 blend_scale;
+    ImVec2 blend_half_texel;
+    ImVec2 blend_spacing;
+    float padding[2]; // constant buffers are sized in 16 byte steps
+};
+
+// Mirrors GaussianKernel in g_gaussian_src, one immutable buffer per member of blur::gaussian_family.
+class GaussianConstants {
+public:
+    float taps[blur::max_gaussian_taps][4]; // texels from the center, weight
+    int tap_count;
+    int padding[3];
+};
+
+// Mirrors ChainConstants in imgui_blur_dx11_shaders.h.
+static const int g_max_chain_levels = 7;
+static const int g_max_chain_passes = 16;
+static const int g_chain_tile_size = 8;
+
+class ChainConstants {
+public:
+    UINT level_count;
+    float offset;
+    float noise;
+    UINT pass_count;
+    UINT level_info[g_max_chain_levels][4];
+    UINT pass_info[g_max_chain_passes][4];
+    float pass_input[g_max_chain_passes][4];
+    int pass_regions[g_max_chain_passes * blur::RegionSet::capacity][4];
+};
+
+static ID3D11Device* g_device = nullptr;
+static blur::ChainPath g_chain_path = blur::ChainPath_PixelShader;
+static ID3D11PixelShader* g_downsample = nullptr;
+static ID3D11PixelShader* g_upsample = nullptr;
+static ID3D11PixelShader* g_render_upsample = nullptr;
+static ID3D11PixelShader* g_compare = nullptr;
+static ID3D11PixelShader* g_gaussian = nullptr;
+static ID3D11Buffer* g_gaussian_kernels[blur::gaussian_kernel_count] = {};
+static ID3D11Predicate* g_change_predicate = nullptr;
+// Masks every write to the compare target, see Dx11Backend::create_compare_target().
+static ID3D11BlendState* g_no_write_blend = nullptr;
+static ID3D11VertexShader* g_vertex = nullptr;
+static ID3D11InputLayout* g_input_layout = nullptr;
+static ID3D11Buffer* g_vertex_buffer = nullptr;
+static ID3D11SamplerState* g_linear_sampler = nullptr;
+static ID3D11SamplerState* g_mirror_sampler = nullptr;
+static ID3D11RasterizerState* g_rasterizer_state = nullptr;
+static ID3D11DepthStencilState* g_depth_stencil_state = nullptr;
+
+// Immutable constant buffers keyed by their contents. A pass sees the same constants every frame until a size, the
+// offset or the noise changes, so its buffer is created once and then only bound. D3D11.0 cannot bind a range of a
+// larger buffer, which is why every distinct BlurConstants gets a buffer of its own.
+class Dx11ConstantEntry {
+public:
+    BlurConstants constants;
+    ID3D11Buffer* buffer;
+    ImU32 last_used;
+};
+
+static const int g_constant_cache_size = 128;
+static ImVector<Dx11ConstantEntry> g_constant_cache;
+static ImU32 g_constant_clock = 0;
+
+static ID3D11ComputeShader* g_downsample_chain = nullptr;
+static ID3D11ComputeShader* g_upsample_cs = nullptr;
+static ID3D11Buffer* g_chain_constants = nullptr;
+static ID3D11Buffer* g_pass_constants[g_max_chain_passes] = {};
+static ID3D11Buffer* g_tile_counters = nullptr;
+static ID3D11UnorderedAccessView* g_tile_counters_uav = nullptr;
+static UINT g_tile_counter_count = 0;
+
+// Timer queries of one chain, see Dx11Backend::begin_timing().
+class Dx11TimingSet {
+public:
+    void destroy() {
+        if (disjoint != nullptr) { disjoint->Release(); disjoint = nullptr; }
+        if (start != nullptr) { start->Release(); start = nullptr; }
+        for (ID3D11Query*& query : timestamps) {
+            if (query != nullptr) { query->Release(); query = nullptr; }
+        }
+    }
+
+    ID3D11Query* disjoint = nullptr;
+    ID3D11Query* start = nullptr;
+    ID3D11Query* timestamps[blur::max_timestamps] = {};
+    int count = 0;
+    ImU32 id = 0;
+    bool pending = false; // ended and not read back yet
+};
+
+// Used in order: sets are opened at g_timing_next and read back at g_timing_read.
+static Dx11TimingSet g_timing_sets[IMGUI_BLUR_TIMER_QUERY_SETS];
+static ImU32 g_timing_next = 0;
+static ImU32 g_timing_read = 0;
+
+#ifdef IMGUI_BLUR_COMPUTE_VERIFY
+static ID3D11ComputeShader* g_difference = nullptr;
+static ID3D11Buffer* g_difference_buffer = nullptr;
+static ID3D11UnorderedAccessView* g_difference_uav = nullptr;
+static ID3D11Buffer* g_difference_readback = nullptr;
+#endif
+
+static DXGI_FORMAT dxgi_format(blur::Format format) {
+    switch (format) {
+    case blur::Format_RGBA8_SRGB: return DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+    case blur::Format_RGB10A2: return DXGI_FORMAT_R10G10B10A2_UNORM;
+    case blur::Format_R11G11B10F: return DXGI_FORMAT_R11G11B10_FLOAT;
+    case blur::Format_RGBA16F: return DXGI_FORMAT_R16G16B16A16_FLOAT;
+    case blur::Format_RGB565: return DXGI_FORMAT_B5G6R5_UNORM;
+    default: return DXGI_FORMAT_R8G8B8A8_UNORM;
+    }
+}
+
+// Typed view of a back buffer: the render target view says how it is written (sRGB views of UNORM flip model
+// buffers, typeless buffers), the texture format is only a fallback when there is no view format.
+static DXGI_FORMAT view_format(DXGI_FORMAT rtv_format, DXGI_FORMAT tex_format) {
+    switch (rtv_format != DXGI_FORMAT_UNKNOWN ? rtv_format : tex_format) {
+    case DXGI_FORMAT_R8G8B8A8_TYPELESS: return DXGI_FORMAT_R8G8B8A8_UNORM;
+    case DXGI_FORMAT_B8G8R8A8_TYPELESS: return DXGI_FORMAT_B8G8R8A8_UNORM;
+    case DXGI_FORMAT_B8G8R8X8_TYPELESS: return DXGI_FORMAT_B8G8R8X8_UNORM;
+    case DXGI_FORMAT_R10G10B10A2_TYPELESS: return DXGI_FORMAT_R10G10B10A2_UNORM;
+    case DXGI_FORMAT_R16G16B16A16_TYPELESS: return DXGI_FORMAT_R16G16B16A16_FLOAT;
+    case DXGI_FORMAT_R32G32B32A32_TYPELESS: return DXGI_FORMAT_R32G32B32A32_FLOAT;
+    default: return rtv_format != DXGI_FORMAT_UNKNOWN ? rtv_format : tex_format;
+    }
+}
+
+// What the passes see when sampling a back buffer viewed as 'format'.
+static blur::Format source_format(DXGI_FORMAT format) {
+    switch (format) {
+    case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+    case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+    case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+        return blur::Format_RGBA8_SRGB;
+    case DXGI_FORMAT_R10G10B10A2_UNORM:
+        return blur::Format_RGB10A2;
+    case DXGI_FORMAT_R11G11B10_FLOAT:
+        return blur::Format_R11G11B10F;
+    case DXGI_FORMAT_R16G16B16A16_FLOAT:
+    case DXGI_FORMAT_R16G16B16A16_UNORM:
+    case DXGI_FORMAT_R32G32B32A32_FLOAT:
+    case DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM:
+        return blur::Format_RGBA16F;
+    default:
+        return blur::Format_RGBA8;
+    }
+}
+
+// With 'unordered_access' the texture is typeless so the compute path can also write it through an R32_UINT view,
+// which only RGBA8 levels get.
+static bool create_framebuffer(ID3D11Device* device, Dx11Framebuffer& framebuffer, int width, int height, blur::Format format, bool unordered_access) {
+    D3D11_TEXTURE2D_DESC tex_desc = {};
+    tex_desc.Width = width;
+    tex_desc.Height = height;
+    tex_desc.MipLevels = 1;
+    tex_desc.ArraySize = 1;
+    tex_desc.Format = unordered_access ? DXGI_FORMAT_R8G8B8A8_TYPELESS : dxgi_format(format);
+    tex_desc.SampleDesc.Count = 1;
+    tex_desc.Usage = D3D11_USAGE_DEFAULT;
+    tex_desc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+    if (unordered_access)
+        tex_desc.BindFlags |= D3D11_BIND_UNORDERED_ACCESS;
+
+    if (FAILED(device->CreateTexture2D(&tex_desc, nullptr, &framebuffer.tex)))
+        return false;
+
+    D3D11_RENDER_TARGET_VIEW_DESC rtv_desc = {};
+    rtv_desc.Format = dxgi_format(format);
+    rtv_desc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
+    if (FAILED(device->CreateRenderTargetView(framebuffer.tex, &rtv_desc, &framebuffer.rtv)))
+        return false;
+
+    D3D11_SHADER_RESOURCE_VIEW_DESC srv_desc = {};
+    srv_desc.Format = dxgi_format(format);
+    srv_desc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+    srv_desc.Texture2D.MipLevels = 1;
+    if (FAILED(device->CreateShaderResourceView(framebuffer.tex, &srv_desc, &framebuffer.srv)))
+        return false;
+
+    if (!unordered_access)
+        return true;
+
+    D3D11_UNORDERED_ACCESS_VIEW_DESC uav_desc = {};
+    uav_desc.Format = DXGI_FORMAT_R32_UINT;
+    uav_desc.ViewDimension = D3D11_UAV_DIMENSION_TEXTURE2D;
+    return SUCCEEDED(device->CreateUnorderedAccessView(framebuffer.tex, &uav_desc, &framebuffer.uav));
+}
+
+// Raw buffer of 'count' uints with a UAV, cleared before use.
+static bool create_raw_buffer(ID3D11Device* device, UINT count, ID3D11Buffer** out_buffer, ID3D11UnorderedAccessView** out_uav) {
+    D3D11_BUFFER_DESC buffer_desc = {};
+    buffer_desc.Usage = D3D11_USAGE_DEFAULT;
+    buffer_desc.ByteWidth = count * sizeof(UINT);
+    buffer_desc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
+    buffer_desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
+    if (FAILED(device->CreateBuffer(&buffer_desc, nullptr, out_buffer)))
+        return false;
+
+    D3D11_UNORDERED_ACCESS_VIEW_DESC uav_desc = {};
+    uav_desc.Format = DXGI_FORMAT_R32_TYPELESS;
+    uav_desc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+    uav_desc.Buffer.NumElements = count;
+    uav_desc.Buffer.Flags = D3D11_BUFFER_UAV_FLAG_RAW;
+    return SUCCEEDED(device->CreateUnorderedAccessView(*out_buffer, &uav_desc, out_uav));
+}
+
+static bool create_vertex_shader(ID3D11Device* device, blur::ShaderLibrary& library, const blur::ShaderSource& shader, ID3D11VertexShader** out_shader) {
+    ImVector<unsigned char> bytecode;
+    if (!library.load(shader, bytecode))
+        return false;
+
+    if (FAILED(device->CreateVertexShader(bytecode.Data, bytecode.Size, nullptr, out_shader))) {
+        // LOG_ERROR("Failed to create shader {}", shader.name);
+        return false;
+    }
+
+    D3D11_INPUT_ELEMENT_DESC layout[] = {
+        { "POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 8, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+    };
+
+    if (FAILED(device->CreateInputLayout(layout, 2, bytecode.Data, bytecode.Size, &g_input_layout))) {
+        // LOG_ERROR("Failed to create input layout");
+        return false;
+    }
+
+    // LOG_INFO("created shader {} successfully", shader.name);
+    return true;
+}
+
+static bool create_pixel_shader(ID3D11Device* device, blur::ShaderLibrary& library, const blur::ShaderSource& shader, ID3D11PixelShader** out_shader) {
+    ImVector<unsigned char> bytecode;
+    if (!library.load(shader, bytecode))
+        return false;
+
+    if (FAILED(device->CreatePixelShader(bytecode.Data, bytecode.Size, nullptr, out_shader))) {
+        // LOG_ERROR("Failed to create shader {}", shader.name);
+        return false;
+    }
+
+    // LOG_INFO("created shader {} successfully", shader.name);
+    return true;
+}
+
+static bool create_gaussian_kernels(ID3D11Device* device) {
+    for (int i = 0; i < blur::gaussian_kernel_count; ++i) {
+        const blur::GaussianKernel& kernel = blur::gaussian_family.kernels[i];
+        GaussianConstants constants = {};
+        for (int t = 0; t < kernel.tap_count; ++t) {
+            constants.taps[t][0] = kernel.offsets[t];
+            constants.taps[t][1] = kernel.weights[t];
+        }
+        constants.tap_count = kernel.tap_count;
+
+        D3D11_BUFFER_DESC desc = {};
+        desc.Usage = D3D11_USAGE_IMMUTABLE;
+        desc.ByteWidth = sizeof(GaussianConstants);
+        desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+        D3D11_SUBRESOURCE_DATA data = {};
+        data.pSysMem = &constants;
+        if (FAILED(device->CreateBuffer(&desc, &data, &g_gaussian_kernels[i]))) {
+            // LOG_ERROR("failed to create the gaussian kernel buffers");
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool create_compute_shader(ID3D11Device* device, blur::ShaderLibrary& library, const blur::ShaderSource& shader, ID3D11ComputeShader** out_shader) {
+    ImVector<unsigned char> bytecode;
+    if (!library.load(shader, bytecode))
+        return false;
+
+    if (FAILED(device->CreateComputeShader(bytecode.Data, bytecode.Size, nullptr, out_shader))) {
+        // LOG_ERROR("Failed to create shader {}", shader.name);
+        return false;
+    }
+
+    // LOG_INFO("created shader {} successfully", shader.name);
+    return true;
+}
+
+static void destroy_compute_objects() {
+    if (g_downsample_chain) { g_downsample_chain->Release(); g_downsample_chain = nullptr; }
+    if (g_upsample_cs) { g_upsample_cs->Release(); g_upsample_cs = nullptr; }
+    if (g_chain_constants) { g_chain_constants->Release(); g_chain_constants = nullptr; }
+    for (ID3D11Buffer*& buffer : g_pass_constants) {
+        if (buffer) { buffer->Release(); buffer = nullptr; }
+    }
+    if (g_tile_counters_uav) { g_tile_counters_uav->Release(); g_tile_counters_uav = nullptr; }
+    if (g_tile_counters) { g_tile_counters->Release(); g_tile_counters = nullptr; }
+    g_tile_counter_count = 0;
+#ifdef IMGUI_BLUR_COMPUTE_VERIFY
+    if (g_difference) { g_difference->Release(); g_difference = nullptr; }
+    if (g_difference_uav) { g_difference_uav->Release(); g_difference_uav = nullptr; }
+    if (g_difference_buffer) { g_difference_buffer->Release(); g_difference_buffer = nullptr; }
+    if (g_difference_readback) { g_difference_readback->Release(); g_difference_readback = nullptr; }
+#endif
+}
+
+// Shaders and buffers of blur::ChainPath_Compute. Failing here leaves the pixel shader path in charge.
+static bool create_compute_objects(ID3D11Device* device, blur::ShaderLibrary& library) {
+    if (device->GetFeatureLevel() < D3D_FEATURE_LEVEL_11_0)
+        return false;
+
+    if (!create_compute_shader(device, library, g_dx11_shaders[Dx11Shader_DownsampleChain], &g_downsample_chain))
+        return false;
+
+    if (!create_compute_shader(device, library, g_dx11_shaders[Dx11Shader_UpsampleCS], &g_upsample_cs))
+        return false;
+
+    D3D11_BUFFER_DESC cb_desc = {};
+    cb_desc.Usage = D3D11_USAGE_DYNAMIC;
+    cb_desc.ByteWidth = sizeof(ChainConstants);
+    cb_desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+    cb_desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    if (FAILED(device->CreateBuffer(&cb_desc, nullptr, &g_chain_constants)))
+        return false;
+
+    // Which pass a dispatch runs never changes, so each index gets its own immutable buffer.
+    for (int i = 0; i < g_max_chain_passes; ++i) {
+        const UINT pass_index[4] = { (UINT)i, 0, 0, 0 };
+        D3D11_BUFFER_DESC pass_desc = {};
+        pass_desc.Usage = D3D11_USAGE_IMMUTABLE;
+        pass_desc.ByteWidth = sizeof(pass_index);
+        pass_desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+
+        D3D11_SUBRESOURCE_DATA pass_data = {};
+        pass_data.pSysMem = pass_index;
+        if (FAILED(device->CreateBuffer(&pass_desc, &pass_data, &g_pass_constants[i])))
+            return false;
+    }
+
+#ifdef IMGUI_BLUR_COMPUTE_VERIFY
+    if (!create_compute_shader(device, library, g_dx11_shaders[Dx11Shader_Difference], &g_difference))
+        return false;
+
+    if (!create_raw_buffer(device, 1, &g_difference_buffer, &g_difference_uav))
+        return false;
+
+    D3D11_BUFFER_DESC readback_desc = {};
+    readback_desc.Usage = D3D11_USAGE_STAGING;
+    readback_desc.ByteWidth = sizeof(UINT);
+    readback_desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+    if (FAILED(device->CreateBuffer(&readback_desc, nullptr, &g_difference_readback)))
+        return false;
+#endif
+    return true;
+}
+
+static void destroy_timing_objects() {
+    for (Dx11TimingSet& set : g_timing_sets) {
+        set.destroy();
+        set.pending = false;
+    }
+    g_timing_next = g_timing_read = 0;
+}
+
+// Optional, without timer queries blur::get_stats() falls back to timing the submission on the CPU.
+static bool create_timing_objects(ID3D11Device* device) {
+    D3D11_QUERY_DESC disjoint_desc = {};
+    disjoint_desc.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
+    D3D11_QUERY_DESC timestamp_desc = {};
+    timestamp_desc.Query = D3D11_QUERY_TIMESTAMP;
+
+    for (Dx11TimingSet& set : g_timing_sets) {
+        if (FAILED(device->CreateQuery(&disjoint_desc, &set.disjoint)) || FAILED(device->CreateQuery(&timestamp_desc, &set.start)))
+            return false;
+        for (ID3D11Query*& query : set.timestamps) {
+            if (FAILED(device->CreateQuery(&timestamp_desc, &query)))
+                return false;
+        }
+    }
+    return true;
+}
+
+static void destroy_constant_cache() {
+    for (Dx11ConstantEntry& entry : g_constant_cache)
+        entry.buffer->Release();
+    g_constant_cache.clear();
+    g_constant_clock = 0;
+}
+
+// The constants must be zero initialized as a whole, padding included, they are compared bytewise.
+static ID3D11Buffer* get_constant_buffer(const BlurConstants& constants) {
+    ++g_constant_clock;
+    Dx11ConstantEntry* oldest = nullptr;
+    for (Dx11ConstantEntry& entry : g_constant_cache) {
+        if (memcmp(&entry.constants, &constants, sizeof(constants)) == 0) {
+            entry.last_used = g_constant_clock;
+            return entry.buffer;
+        }
+        if (oldest == nullptr || entry.last_used < oldest->last_used)
+            oldest = &entry;
+    }
+
+    D3D11_BUFFER_DESC desc = {};
+    desc.Usage = D3D11_USAGE_IMMUTABLE;
+    desc.ByteWidth = sizeof(BlurConstants);
+    desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+    D3D11_SUBRESOURCE_DATA data = {};
+    data.pSysMem = &constants;
+    ID3D11Buffer* buffer = nullptr;
+    if (FAILED(g_device->CreateBuffer(&desc, &data, &buffer)))
+        return nullptr;
+    blur::count(blur::Counter_ConstantUpdates);
+
+    // The context keeps an evicted buffer alive for as long as it is still bound or referenced by queued work.
+    if (g_constant_cache.Size < g_constant_cache_size) {
+        g_constant_cache.push_back(Dx11ConstantEntry());
+        oldest = &g_constant_cache.back();
+    } else {
+        oldest->buffer->Release();
+    }
+    oldest->constants = constants;
+    oldest->buffer = buffer;
+    oldest->last_used = g_constant_clock;
+    return buffer;
+}
+
+static void destroy_device_objects() {
+    destroy_compute_objects();
+    destroy_timing_objects();
+    destroy_constant_cache();
+    if (g_downsample) { g_downsample->Release(); g_downsample = nullptr; }
+    if (g_upsample) { g_upsample->Release(); g_upsample = nullptr; }
+    if (g_render_upsample) { g_render_upsample->Release(); g_render_upsample = nullptr; }
+    if (g_compare) { g_compare->Release(); g_compare = nullptr; }
+    if (g_gaussian) { g_gaussian->Release(); g_gaussian = nullptr; }
+    for (ID3D11Buffer*& buffer : g_gaussian_kernels) {
+        if (buffer) { buffer->Release(); buffer = nullptr; }
+    }
+    if (g_change_predicate) { g_change_predicate->Release(); g_change_predicate = nullptr; }
+    if (g_no_write_blend) { g_no_write_blend->Release(); g_no_write_blend = nullptr; }
+    if (g_vertex) { g_vertex->Release(); g_vertex = nullptr; }
+    if (g_input_layout) { g_input_layout->Release(); g_input_layout = nullptr; }
+    if (g_vertex_buffer) { g_vertex_buffer->Release(); g_vertex_buffer = nullptr; }
+    if (g_linear_sampler) { g_linear_sampler->Release(); g_linear_sampler = nullptr; }
+    if (g_mirror_sampler) { g_mirror_sampler->Release(); g_mirror_sampler = nullptr; }
+    if (g_rasterizer_state) { g_rasterizer_state->Release(); g_rasterizer_state = nullptr; }
+    if (g_depth_stencil_state) { g_depth_stencil_state->Release(); g_depth_stencil_state = nullptr; }
+    g_device = nullptr;
+}
+
+static void render_fullscreen_quad(ID3D11DeviceContext* device_context) {
+    device_context->Draw(4, 0);
+}
+
+class Dx11Backend : public blur::Backend {
+public:
+    bool create_framebuffer(blur::Framebuffer& framebuffer, int width, int height, blur::Format format) override {
+        Dx11Framebuffer* dx11_framebuffer = IM_NEW(Dx11Framebuffer);
+        framebuffer.handle = dx11_framebuffer;
+        framebuffer.width = width;
+        framebuffer.height = height;
+        const bool unordered_access = g_chain_path == blur::ChainPath_Compute && format == blur::Format_RGBA8;
+        if (!::create_framebuffer(g_device, *dx11_framebuffer, width, height, format, unordered_access))
+            return false;
+        blur::count(blur::Counter_ViewsCreated, unordered_access ? 3 : 2);
+        return true;
+    }
+
+    bool supports_format(blur::Format format) override {
+        const UINT required = D3D11_FORMAT_SUPPORT_TEXTURE2D | D3D11_FORMAT_SUPPORT_RENDER_TARGET | D3D11_FORMAT_SUPPORT_SHADER_SAMPLE;
+        UINT support = 0;
+        return SUCCEEDED(g_device->CheckFormatSupport(dxgi_format(format), &support)) && (support & required) == required;
+    }
+
+    void destroy_framebuffer(blur::Framebuffer& framebuffer) override {
+        Dx11Framebuffer* dx11_framebuffer = (Dx11Framebuffer*)framebuffer.handle;
+        if (dx11_framebuffer != nullptr) {
+            dx11_framebuffer->destroy();
+            IM_DELETE(dx11_framebuffer);
+        }
+        framebuffer = blur::Framebuffer{};
+    }
+
+    ImTextureID get_texture_id(const blur::Framebuffer& framebuffer) override {
+        return (ImTextureID)((Dx11Framebuffer*)framebuffer.handle)->srv;
+    }
+
+    bool begin_chain(blur::Framebuffer& source) override {
+        ImGuiPlatformIO& platform_io = ImGui::GetPlatformIO();
+        ImGui_ImplDX11_RenderState* render_state = (ImGui_ImplDX11_RenderState*)platform_io.Renderer_RenderState;
+        if (render_state == nullptr) {
+            // LOG_ERROR("blur has no render state");
+            return false;
+        }
+
+        ID3D11Device* device = render_state->Device;
+        device_context = render_state->DeviceContext;
+
+        ID3D11RenderTargetView* screen_rtv = nullptr;
+        device_context->OMGetRenderTargets(1, &screen_rtv, nullptr);
+
+        ID3D11Texture2D* screen_tex = nullptr;
+        screen_rtv->GetResource(reinterpret_cast<ID3D11Resource**>(&screen_tex));
+
+        D3D11_TEXTURE2D_DESC tex_desc;
+        screen_tex->GetDesc(&tex_desc);
+        D3D11_RENDER_TARGET_VIEW_DESC rtv_desc;
+        screen_rtv->GetDesc(&rtv_desc);
+
+        // Sampled the way it is written, any conversion to the level format happens in the first downsample.
+        D3D11_SHADER_RESOURCE_VIEW_DESC srv_desc = {};
+        srv_desc.Format = view_format(rtv_desc.Format, tex_desc.Format);
+        srv_desc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+        srv_desc.Texture2D.MipLevels = 1;
+        srv_desc.Texture2D.MostDetailedMip = 0;
+
+        device->CreateShaderResourceView(screen_tex, &srv_desc, &screen.srv);
+        blur::count(blur::Counter_ViewsCreated);
+
+        screen.tex = screen_tex;
+        screen_format = srv_desc.Format;
+        if (screen_rtv) screen_rtv->Release();
+
+        source.handle = &screen;
+        source.width = source.texture_width = tex_desc.Width;
+        source.height = source.texture_height = tex_desc.Height;
+        source.format = source_format(screen_format);
+
+        // Only the targets are put back in end_chain(), the rest is left to the ImDrawCallback_ResetRenderState that
+        // process() queues right after the chain.
+        device_context->OMGetRenderTargets(1, &old_rtv, &old_dsv);
+
+        // State every pass of the chain shares is bound once here, render_pass() only changes what differs.
+        UINT stride = sizeof(float) * 4;
+        UINT offset = 0;
+        device_context->IASetVertexBuffers(0, 1, &g_vertex_buffer, &stride, &offset);
+        device_context->IASetInputLayout(g_input_layout);
+        device_context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+        device_context->VSSetShader(g_vertex, nullptr, 0);
+        device_context->RSSetState(g_rasterizer_state);
+        device_context->OMSetDepthStencilState(g_depth_stencil_state, 0);
+        device_context->OMSetBlendState(nullptr, nullptr, 0xffffffff);
+        device_context->PSSetSamplers(0, 1, &g_mirror_sampler);
+        bound.forget();
+        return true;
+    }
+
+    void render_pass(const blur::Framebuffer& target, const blur::Framebuffer& input, blur::Kernel kernel, float offset, float noise, const blur::RegionSet& regions) override {
+        const Dx11Framebuffer* framebuffer = (const Dx11Framebuffer*)target.handle;
+        ID3D11ShaderResourceView* input_srv = ((const Dx11Framebuffer*)input.handle)->srv;
+        const bool gaussian = kernel == blur::Kernel_GaussianX || kernel == blur::Kernel_GaussianY;
+        // The box kernels are never scheduled, kernel_costs() leaves them out.
+        if (kernel == blur::Kernel_BoxX || kernel == blur::Kernel_BoxY)
+            return;
+        ID3D11PixelShader* shader = gaussian ? g_gaussian : kernel == blur::Kernel_Downsample ? g_downsample : g_upsample;
+
+        BlurConstants constants = {};
+        constants.half_pixel = ImVec2(0.5f / target.width, 0.5f / target.height);
+        constants.offset = offset;
+        constants.noise = noise;
+        constants.input_scale = ImVec2((float)input.width / input.texture_width, (float)input.height / input.texture_height);
+        constants.input_half_texel = ImVec2(0.5f / input.width, 0.5f / input.height);
+        if (gaussian)
+            constants.spacing = kernel == blur::Kernel_GaussianX ? ImVec2(1.0f / input.width, 0.0f) : ImVec2(0.0f, 1.0f / input.height);
+        ID3D11Buffer* constant_buffer = get_constant_buffer(constants);
+        if (constant_buffer == nullptr)
+            return;
+
+        // Every texel inside the regions is written, nothing outside them is read, so the target is never cleared.
+        // A level read by the previous pass may be this pass's target and has to leave t0 first.
+        ID3D11Buffer* kernel_buffer = gaussian ? g_gaussian_kernels[blur::gaussian_kernel_index(offset)] : nullptr;
+        const blur::PassBinds binds = bound.bind_pass(framebuffer->srv, input_srv, shader, constant_buffer, kernel_buffer, target.width, target.height);
+        if (binds.unbind_input) {
+            ID3D11ShaderResourceView* null_srv = nullptr;
+            device_context->PSSetShaderResources(0, 1, &null_srv);
+        }
+        device_context->OMSetRenderTargets(1, &framebuffer->rtv, nullptr);
+
+        if (binds.viewport) {
+            D3D11_VIEWPORT viewport = {};
+            viewport.Width = (float)target.width;
+            viewport.Height = (float)target.height;
+            viewport.MinDepth = 0.0f;
+            viewport.MaxDepth = 1.0f;
+            device_context->RSSetViewports(1, &viewport);
+        }
+        if (binds.shader)
+            device_context->PSSetShader(shader, nullptr, 0);
+        if (binds.constants)
+            device_context->PSSetConstantBuffers(0, 1, &constant_buffer);
+        if (binds.kernel)
+            device_context->PSSetConstantBuffers(1, 1, &kernel_buffer);
+        if (binds.input)
+            device_context->PSSetShaderResources(0, 1, &input_srv);
+
+        // One scissored quad per region, pixels outside them are never sampled.
+        for (int i = 0; i < regions.count; ++i) {
+            const blur::Rect& region = regions.rects[i];
+            const D3D11_RECT scissor = { region.x0, region.y0, region.x1, region.y1 };
+            device_context->RSSetScissorRects(1, &scissor);
+            render_fullscreen_quad(device_context);
+        }
+    }
+
+    // blur::ChainPath_Compute: every downsample in one dispatch (see g_downsample_chain_src), then one dispatch per
+    // upsample over the bounds of its regions. Chains the shaders cannot hold go through render_pass() instead.
+    bool render_passes(const blur::Pass* passes, int count, float offset, float noise) override {
+        if (g_chain_path != blur::ChainPath_Compute || g_downsample_chain == nullptr)
+            return false;
+
+        // Only the kawase kernels have compute versions.
+        for (int i = 0; i < count; ++i) {
+            if (passes[i].kernel != blur::Kernel_Downsample && passes[i].kernel != blur::Kernel_Upsample)
+                return false;
+        }
+
+        int level_count = 0;
+        while (level_count < count && passes[level_count].kernel == blur::Kernel_Downsample)
+            ++level_count;
+        if (level_count > g_max_chain_levels || count > g_max_chain_passes || offset > 10.0f)
+            return false;
+        // The kernels pack RGBA8 by hand.
+        for (int i = 0; i < count; ++i) {
+            if (passes[i].target->format != blur::Format_RGBA8)
+                return false;
+        }
+
+        ChainConstants constants = {};
+        constants.level_count = level_count;
+        constants.offset = offset;
+        constants.noise = noise;
+        constants.pass_count = count;
+
+        UINT tile_counters = 0;
+        for (int i = 0; i < level_count; ++i) {
+            const blur::Framebuffer& level = *passes[i].target;
+            const UINT tiles_x = (level.width + g_chain_tile_size - 1) / g_chain_tile_size;
+            const UINT tiles_y = (level.height + g_chain_tile_size - 1) / g_chain_tile_size;
+            UINT* info = constants.level_info[i];
+            info[0] = level.width;
+            info[1] = level.height;
+            info[2] = tiles_x;
+            info[3] = tile_counters;
+            tile_counters += tiles_x * tiles_y;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            const blur::Pass& pass = passes[i];
+            const blur::Rect bounds = region_bounds(pass.regions);
+            UINT* info = constants.pass_info[i];
+            info[0] = pass.target->width;
+            info[1] = pass.target->height;
+            info[2] = pass.regions.count;
+            info[3] = (UINT)bounds.x0 | ((UINT)bounds.y0 << 16);
+
+            float* input = constants.pass_input[i];
+            input[0] = (float)pass.input->width / pass.input->texture_width;
+            input[1] = (float)pass.input->height / pass.input->texture_height;
+            input[2] = 0.5f / pass.input->width;
+            input[3] = 0.5f / pass.input->height;
+
+            for (int r = 0; r < pass.regions.count; ++r) {
+                const blur::Rect& region = pass.regions.rects[r];
+                int* rect = constants.pass_regions[i * blur::RegionSet::capacity + r];
+                rect[0] = region.x0;
+                rect[1] = region.y0;
+                rect[2] = region.x1;
+                rect[3] = region.y1;
+            }
+        }
+
+        if (tile_counters > g_tile_counter_count) {
+            if (g_tile_counters_uav) { g_tile_counters_uav->Release(); g_tile_counters_uav = nullptr; }
+            if (g_tile_counters) { g_tile_counters->Release(); g_tile_counters = nullptr; }
+            g_tile_counter_count = 0;
+            if (!create_raw_buffer(g_device, tile_counters, &g_tile_counters, &g_tile_counters_uav))
+                return false;
+            g_tile_counter_count = tile_counters;
+        }
+
+        D3D11_MAPPED_SUBRESOURCE mapped;
+        if (FAILED(device_context->Map(g_chain_constants, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+            return false;
+        memcpy(mapped.pData, &constants, sizeof(constants));
+        device_context->Unmap(g_chain_constants, 0);
+        blur::count(blur::Counter_ConstantUpdates);
+
+        // No level may stay bound as a render target or pixel shader input while it is written as a UAV.
+        ID3D11ShaderResourceView* null_input = nullptr;
+        device_context->PSSetShaderResources(0, 1, &null_input);
+        device_context->OMSetRenderTargets(0, nullptr, nullptr);
+        bound.input = nullptr;
+        device_context->CSSetConstantBuffers(0, 1, &g_chain_constants);
+        device_context->CSSetSamplers(0, 1, &g_mirror_sampler);
+
+        ID3D11UnorderedAccessView* null_uav[g_max_chain_levels + 1] = {};
+        ID3D11ShaderResourceView* null_srv[2] = { nullptr, nullptr };
+        if (passes[0].regions.count > 0) {
+            const UINT zero[4] = { 0, 0, 0, 0 };
+            device_context->ClearUnorderedAccessViewUint(g_tile_counters_uav, zero);
+
+            ID3D11UnorderedAccessView* uavs[g_max_chain_levels + 1] = {};
+            for (int i = 0; i < level_count; ++i)
+                uavs[i] = ((const Dx11Framebuffer*)passes[i].target->handle)->uav;
+            uavs[g_max_chain_levels] = g_tile_counters_uav;
+
+            ID3D11ShaderResourceView* source_srv = ((const Dx11Framebuffer*)passes[0].input->handle)->srv;
+            device_context->CSSetShader(g_downsample_chain, nullptr, 0);
+            device_context->CSSetShaderResources(0, 1, &source_srv);
+            device_context->CSSetUnorderedAccessViews(0, g_max_chain_levels + 1, uavs, nullptr);
+            device_context->Dispatch(constants.level_info[0][2], (passes[0].target->height + g_chain_tile_size - 1) / g_chain_tile_size, 1);
+            device_context->CSSetUnorderedAccessViews(0, g_max_chain_levels + 1, null_uav, nullptr);
+            device_context->CSSetShaderResources(0, 1, null_srv);
+        }
+
+        device_context->CSSetShader(g_upsample_cs, nullptr, 0);
+        for (int i = level_count; i < count; ++i) {
+            const blur::Pass& pass = passes[i];
+            if (pass.regions.count == 0)
+                continue;
+
+            const blur::Rect bounds = region_bounds(pass.regions);
+            ID3D11ShaderResourceView* input_srv = ((const Dx11Framebuffer*)pass.input->handle)->srv;
+            ID3D11UnorderedAccessView* target_uav = ((const Dx11Framebuffer*)pass.target->handle)->uav;
+            device_context->CSSetConstantBuffers(1, 1, &g_pass_constants[i]);
+            device_context->CSSetShaderResources(1, 1, &input_srv);
+            device_context->CSSetUnorderedAccessViews(0, 1, &target_uav, nullptr);
+            device_context->Dispatch((bounds.x1 - bounds.x0 + g_chain_tile_size - 1) / g_chain_tile_size, (bounds.y1 - bounds.y0 + g_chain_tile_size - 1) / g_chain_tile_size, 1);
+            device_context->CSSetUnorderedAccessViews(0, 1, null_uav, nullptr);
+            device_context->CSSetShaderResources(1, 1, null_srv);
+        }
+        device_context->CSSetShader(nullptr, nullptr, 0);
+
+#ifdef IMGUI_BLUR_COMPUTE_VERIFY
+        // Keep the compute result and let the pixel shader path overwrite the output, end_chain() compares both.
+        if (!predicated && g_difference != nullptr && copy_verify_result(*passes[count - 1].target)) {
+            verify_pass = count - 1;
+            verify_output = (const Dx11Framebuffer*)passes[count - 1].target->handle;
+            return false;
+        }
+#endif
+        return true;
+    }
+
+    void end_chain() override {
+#ifdef IMGUI_BLUR_COMPUTE_VERIFY
+        if (verify_output != nullptr)
+            verify_compute_result();
+#endif
+        // The last input may be a transient level the next chain renders to.
+        ID3D11ShaderResourceView* null_srv = nullptr;
+        device_context->PSSetShaderResources(0, 1, &null_srv);
+        device_context->OMSetRenderTargets(1, &old_rtv, old_dsv);
+
+        if (old_rtv) { old_rtv->Release(); old_rtv = nullptr; }
+        if (old_dsv) { old_dsv->Release(); old_dsv = nullptr; }
+        bound.forget();
+        screen.destroy();
+        device_context = nullptr;
+    }
+
+    // The captured regions are compared against a copy of the chain's last capture under an occlusion predicate,
+    // the passes that follow are predicated on it so an unchanged frame never leaves the GPU.
+    blur::ContentCheck begin_content_check(void*& state, const blur::Framebuffer& source, const blur::RegionSet& regions, bool allow_skip) override {
+        if (state == nullptr)
+            state = IM_NEW(Dx11ContentState);
+
+        content_state = (Dx11ContentState*)state;
+        content_regions = regions;
+        predicated = false;
+
+        Dx11ContentState& previous = *content_state;
+        if (previous.capture.tex == nullptr || previous.width != source.width || previous.height != source.height || previous.format != screen_format) {
+            previous.capture.destroy();
+            if (!create_capture(previous, source.width, source.height))
+                return blur::ContentCheck_Changed;
+            allow_skip = false;
+        }
+
+        if (!allow_skip || g_compare == nullptr || g_change_predicate == nullptr || g_no_write_blend == nullptr
+            || !create_compare_target(source.width, source.height))
+            return blur::ContentCheck_Changed;
+
+        D3D11_VIEWPORT viewport = {};
+        viewport.Width = (float)source.width;
+        viewport.Height = (float)source.height;
+        viewport.MinDepth = 0.0f;
+        viewport.MaxDepth = 1.0f;
+        device_context->RSSetViewports(1, &viewport);
+        device_context->OMSetRenderTargets(1, &compare_target.rtv, nullptr);
+        device_context->OMSetBlendState(g_no_write_blend, nullptr, 0xffffffff);
+
+        ID3D11ShaderResourceView* srvs[2] = { screen.srv, previous.capture.srv };
+        device_context->PSSetShader(g_compare, nullptr, 0);
+        device_context->PSSetShaderResources(0, 2, srvs);
+
+        device_context->Begin(g_change_predicate);
+        for (int i = 0; i < regions.count; ++i) {
+            const blur::Rect& region = regions.rects[i];
+            const D3D11_RECT scissor = { region.x0, region.y0, region.x1, region.y1 };
+            device_context->RSSetScissorRects(1, &scissor);
+            render_fullscreen_quad(device_context);
+        }
+        device_context->End(g_change_predicate);
+
+        ID3D11ShaderResourceView* null_srv[2] = { nullptr, nullptr };
+        device_context->PSSetShaderResources(0, 2, null_srv);
+        device_context->OMSetBlendState(nullptr, nullptr, 0xffffffff);
+        bound.forget();
+
+        // Skip everything up to end_content_check() when no texel passed.
+        device_context->SetPredication(g_change_predicate, FALSE);
+        predicated = true;
+        return blur::ContentCheck_Changed;
+    }
+
+    void end_content_check() override {
+        // Still predicated: an unchanged capture is already in the chain's copy.
+        if (content_state != nullptr && content_state->capture.tex != nullptr) {
+            for (int i = 0; i < content_regions.count; ++i) {
+                const blur::Rect& region = content_regions.rects[i];
+                const D3D11_BOX box = { (UINT)region.x0, (UINT)region.y0, 0, (UINT)region.x1, (UINT)region.y1, 1 };
+                device_context->CopySubresourceRegion(content_state->capture.tex, 0, region.x0, region.y0, 0, screen.tex, 0, &box);
+            }
+        }
+
+        if (predicated)
+            device_context->SetPredication(nullptr, FALSE);
+        predicated = false;
+        content_state = nullptr;
+    }
+
+    void destroy_content_state(void* state) override {
+        Dx11ContentState* dx11_state = (Dx11ContentState*)state;
+        dx11_state->capture.destroy();
+        IM_DELETE(dx11_state);
+    }
+
+    bool can_render_upsample() override {
+        return g_render_upsample != nullptr;
+    }
+
+    // ImGui's vertex shader, blend state and scissor stay bound, only the pixel shader and its inputs change.
+    void begin_render_upsample(const blur::RenderSource& source, const blur::Framebuffer& output, float offset, float noise) override {
+        ImGui_ImplDX11_RenderState* render_state = (ImGui_ImplDX11_RenderState*)ImGui::GetPlatformIO().Renderer_RenderState;
+        if (render_state == nullptr)
+            return;
+        ID3D11DeviceContext* context = render_state->DeviceContext;
+
+        const blur::Framebuffer* level = source.levels[0];
+        const blur::Framebuffer* blend = source.levels[1] != nullptr ? source.levels[1] : level;
+        BlurConstants constants = {};
+        constants.half_pixel = ImVec2(0.5f / output.width, 0.5f / output.height);
+        constants.offset = offset;
+        constants.noise = noise;
+        constants.input_scale = level != nullptr ? ImVec2((float)level->width / level->texture_width, (float)level->height / level->texture_height) : ImVec2(1.0f, 1.0f);
+        constants.input_half_texel = level != nullptr ? ImVec2(0.5f / level->width, 0.5f / level->height) : ImVec2(0.5f, 0.5f);
+        constants.opacity = level != nullptr ? source.opacity : 0.0f;
+        constants.blend = source.levels[1] != nullptr ? source.blend : 0.0f;
+        constants.spacing = source.spacing[0];
+        constants.blend_scale = blend != nullptr ? ImVec2((float)blend->width / blend->texture_width, (float)blend->height / blend->texture_height) : ImVec2(1.0f, 1.0f);
+        constants.blend_half_texel = blend != nullptr ? ImVec2(0.5f / blend->width, 0.5f / blend->height) : ImVec2(0.5f, 0.5f);
+        constants.blend_spacing = source.spacing[1];
+        ID3D11Buffer* constant_buffer = get_constant_buffer(constants);
+        if (constant_buffer == nullptr)
+            return;
+
+        ID3D11ShaderResourceView* srvs[2] = {
+            level != nullptr ? ((const Dx11Framebuffer*)level->handle)->srv : nullptr,
+            blend != nullptr ? ((const Dx11Framebuffer*)blend->handle)->srv : nullptr,
+        };
+        context->PSSetShader(g_render_upsample, nullptr, 0);
+        context->PSSetConstantBuffers(0, 1, &constant_buffer);
+        context->PSSetShaderResources(1, 2, srvs);
+        context->PSSetSamplers(0, 1, &g_mirror_sampler);
+    }
+
+    void end_render_upsample() override {
+        ImGui_ImplDX11_RenderState* render_state = (ImGui_ImplDX11_RenderState*)ImGui::GetPlatformIO().Renderer_RenderState;
+        if (render_state == nullptr)
+            return;
+
+        ID3D11ShaderResourceView* null_srv[2] = { nullptr, nullptr };
+        render_state->DeviceContext->PSSetShaderResources(1, 2, null_srv);
+    }
+
+    bool has_timer_queries() override {
+        return g_timing_sets[0].disjoint != nullptr;
+    }
+
+    bool begin_timing(ImU32 id) override {
+        Dx11TimingSet& set = g_timing_sets[g_timing_next % IMGUI_BLUR_TIMER_QUERY_SETS];
+        if (set.pending)
+            return false;
+
+        set.id = id;
+        set.count = 0;
+        device_context->Begin(set.disjoint);
+        device_context->End(set.start);
+        timing_set = &set;
+        return true;
+    }
+
+    void timestamp() override {
+        if (timing_set != nullptr && timing_set->count < blur::max_timestamps)
+            device_context->End(timing_set->timestamps[timing_set->count++]);
+    }
+
+    void end_timing() override {
+        if (timing_set == nullptr)
+            return;
+
+        device_context->End(timing_set->disjoint);
+        timing_set->pending = true;
+        timing_set = nullptr;
+        ++g_timing_next;
+    }
+
+    // DONOTFLUSH: asking must not push work to the GPU early, the set is simply tried again on a later chain.
+    bool read_timing(ImU32& id, float* ms, int& count) override {
+        Dx11TimingSet& set = g_timing_sets[g_timing_read % IMGUI_BLUR_TIMER_QUERY_SETS];
+        if (!set.pending)
+            return false;
+
+        D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+        UINT64 start = 0;
+        if (device_context->GetData(set.disjoint, &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK
+            || device_context->GetData(set.start, &start, sizeof(start), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+            return false;
+
+        count = 0;
+        if (!disjoint.Disjoint) {
+            for (int i = 0; i < set.count; ++i) {
+                UINT64 timestamp = 0;
+                if (device_context->GetData(set.timestamps[i], &timestamp, sizeof(timestamp), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+                    return false;
+                ms[i] = (float)((double)(timestamp - start) * 1000.0 / (double)disjoint.Frequency);
+            }
+            count = set.count;
+        }
+
+        id = set.id;
+        set.pending = false;
+        ++g_timing_read;
+        return true;
+    }
+
+    ~Dx11Backend() override {
+        compare_target.destroy();
+#ifdef IMGUI_BLUR_COMPUTE_VERIFY
+        verify.destroy();
+#endif
+        destroy_device_objects();
+    }
+
+private:
+    static blur::Rect region_bounds(const blur::RegionSet& regions) {
+        blur::Rect bounds = regions.count > 0 ? regions.rects[0] : blur::Rect{};
+        for (int i = 1; i < regions.count; ++i) {
+            const blur::Rect& rect = regions.rects[i];
+            if (rect.x0 < bounds.x0) bounds.x0 = rect.x0;
+            if (rect.y0 < bounds.y0) bounds.y0 = rect.y0;
+            if (rect.x1 > bounds.x1) bounds.x1 = rect.x1;
+            if (rect.y1 > bounds.y1) bounds.y1 = rect.y1;
+        }
+        return bounds;
+    }
+
+#ifdef IMGUI_BLUR_COMPUTE_VERIFY
+    bool copy_verify_result(const blur::Framebuffer& output) {
+        if (verify.tex == nullptr || verify_width != output.texture_width || verify_height != output.texture_height) {
+            verify.destroy();
+            verify_width = verify_height = 0;
+            if (!::create_framebuffer(g_device, verify, output.texture_width, output.texture_height, blur::Format_RGBA8, true))
+                return false;
+            verify_width = output.texture_width;
+            verify_height = output.texture_height;
+        }
+        device_context->CopyResource(verify.tex, ((const Dx11Framebuffer*)output.handle)->tex);
+        return true;
+    }
+
+    // Reads the largest channel difference back right away, this stalls and is only meant for debugging.
+    void verify_compute_result() {
+        const UINT zero[4] = { 0, 0, 0, 0 };
+        device_context->ClearUnorderedAccessViewUint(g_difference_uav, zero);
+
+        // The chain constants are still bound to b0.
+        ID3D11ShaderResourceView* srvs[2] = { verify_output->srv, verify.srv };
+        device_context->OMSetRenderTargets(0, nullptr, nullptr);
+        device_context->CSSetShader(g_difference, nullptr, 0);
+        device_context->CSSetConstantBuffers(1, 1, &g_pass_constants[verify_pass]);
+        device_context->CSSetShaderResources(1, 2, srvs);
+        device_context->CSSetUnorderedAccessViews(g_max_chain_levels, 1, &g_difference_uav, nullptr);
+        device_context->Dispatch((verify_width + g_chain_tile_size - 1) / g_chain_tile_size, (verify_height + g_chain_tile_size - 1) / g_chain_tile_size, 1);
+
+        ID3D11UnorderedAccessView* null_uav = nullptr;
+        ID3D11ShaderResourceView* null_srv[2] = { nullptr, nullptr };
+        device_context->CSSetUnorderedAccessViews(g_max_chain_levels, 1, &null_uav, nullptr);
+        device_context->CSSetShaderResources(1, 2, null_srv);
+        device_context->CSSetShader(nullptr, nullptr, 0);
+
+        device_context->CopyResource(g_difference_readback, g_difference_buffer);
+        D3D11_MAPPED_SUBRESOURCE mapped;
+        if (SUCCEEDED(device_context->Map(g_difference_readback, 0, D3D11_MAP_READ, 0, &mapped))) {
+            const UINT difference = *(const UINT*)mapped.pData;
+            device_context->Unmap(g_difference_readback, 0);
+            IM_ASSERT(difference <= 2 && "compute chain differs from the pixel shader chain");
+        }
+        verify_output = nullptr;
+    }
+
+    Dx11Framebuffer verify{};
+    int verify_width = 0, verify_height = 0;
+    const Dx11Framebuffer* verify_output = nullptr;
+    int verify_pass = 0;
+#endif
+
+    bool create_capture(Dx11ContentState& state, int width, int height) {
+        D3D11_TEXTURE2D_DESC tex_desc = {};
+        tex_desc.Width = width;
+        tex_desc.Height = height;
+        tex_desc.MipLevels = 1;
+        tex_desc.ArraySize = 1;
+        tex_desc.Format = screen_format;
+        tex_desc.SampleDesc.Count = 1;
+        tex_desc.Usage = D3D11_USAGE_DEFAULT;
+        tex_desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+        if (FAILED(g_device->CreateTexture2D(&tex_desc, nullptr, &state.capture.tex)))
+            return false;
+
+        if (FAILED(g_device->CreateShaderResourceView(state.capture.tex, nullptr, &state.capture.srv))) {
+            state.capture.destroy();
+            return false;
+        }
+        blur::count(blur::Counter_ViewsCreated);
+
+        state.width = width;
+        state.height = height;
+        state.format = screen_format;
+        return true;
+    }
+
+    // Bound while the compare runs: drivers may skip a pixel shader that has no target to write to, which would leave
+    // the discards uncounted, and pixels outside the target are never shaded. So it covers the whole capture, grown
+    // when a larger one comes along; the blend state masks every write and its texels stay undefined.
+    bool create_compare_target(int width, int height) {
+        if (compare_target.rtv != nullptr && compare_width >= width && compare_height >= height)
+            return true;
+
+        compare_target.destroy();
+        compare_width = compare_height = 0;
+        D3D11_TEXTURE2D_DESC tex_desc = {};
+        tex_desc.Width = width;
+        tex_desc.Height = height;
+        tex_desc.MipLevels = 1;
+        tex_desc.ArraySize = 1;
+        tex_desc.Format = DXGI_FORMAT_R8_UNORM;
+        tex_desc.SampleDesc.Count = 1;
+        tex_desc.Usage = D3D11_USAGE_DEFAULT;
+        tex_desc.BindFlags = D3D11_BIND_RENDER_TARGET;
+        if (FAILED(g_device->CreateTexture2D(&tex_desc, nullptr, &compare_target.tex))
+            || FAILED(g_device->CreateRenderTargetView(compare_target.tex, nullptr, &compare_target.rtv))) {
+            compare_target.destroy();
+            return false;
+        }
+        blur::count(blur::Counter_ViewsCreated);
+
+        compare_width = width;
+        compare_height = height;
+        return true;
+    }
+
+    ID3D11DeviceContext* device_context = nullptr;
+    Dx11Framebuffer screen{};
+    DXGI_FORMAT screen_format = DXGI_FORMAT_UNKNOWN;
+
+    Dx11ContentState* content_state = nullptr;
+    blur::RegionSet content_regions{};
+    Dx11Framebuffer compare_target{};
+    int compare_width = 0, compare_height = 0;
+    Dx11TimingSet* timing_set = nullptr;
+    bool predicated = false;
+
+    ID3D11RenderTargetView* old_rtv = nullptr;
+    ID3D11DepthStencilView* old_dsv = nullptr;
+
+    // What the passes of the current chain left bound, see render_pass().
+    blur::BoundState bound; // kernel is b1 of g_gaussian
+};
+
+bool blur::setup(ID3D11Device* device, ID3D11DeviceContext* device_context, ChainPath path) {
+    destroy();
+    begin_setup_report();
+
+    D3DShaderCompiler compiler;
+    ShaderLibrary library(&compiler, g_precompiled_shaders, g_precompiled_shader_count);
+
+    if (!create_vertex_shader(device, library, g_dx11_shaders[Dx11Shader_Vertex], &g_vertex))
+        return false;
+
+    if (!create_pixel_shader(device, library, g_dx11_shaders[Dx11Shader_Downsample], &g_downsample))
+        return false;
+
+    if (!create_pixel_shader(device, library, g_dx11_shaders[Dx11Shader_Upsample], &g_upsample))
+        return false;
+
+    if (!create_pixel_shader(device, library, g_dx11_shaders[Dx11Shader_RenderUpsample], &g_render_upsample))
+        return false;
+
+    if (!create_pixel_shader(device, library, g_dx11_shaders[Dx11Shader_Compare], &g_compare))
+        return false;
+
+    if (!create_pixel_shader(device, library, g_dx11_shaders[Dx11Shader_Gaussian], &g_gaussian) || !create_gaussian_kernels(device))
+        return false;
+
+    // The pixel shader path above stays available for chains the compute shaders cannot hold.
+    g_chain_path = ChainPath_PixelShader;
+    if (path == ChainPath_Compute) {
+        if (create_compute_objects(device, library))
+            g_chain_path = ChainPath_Compute;
+        else
+            destroy_compute_objects();
+    }
+
+    // LOG_INFO("all blur shaders initialized successfully");
+
+    struct Vertex {
+        float pos[2];
+        float uv[2];
+    };
+
+    Vertex vertices[] = {
+        { { -1.0f,  1.0f }, { 0.0f, 0.0f } },
+        { {  1.0f,  1.0f }, { 1.0f, 0.0f } },
+        { { -1.0f, -1.0f }, { 0.0f, 1.0f } },
+        { {  1.0f, -1.0f }, { 1.0f, 1.0f } },
+    };
+
+    D3D11_BUFFER_DESC vb_desc = {};
+    vb_desc.Usage = D3D11_USAGE_DEFAULT;
+    vb_desc.ByteWidth = sizeof(vertices);
+    vb_desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+
+    D3D11_SUBRESOURCE_DATA vb_data = {};
+    vb_data.pSysMem = vertices;
+    if (FAILED(device->CreateBuffer(&vb_desc, &vb_data, &g_vertex_buffer)))
+        return false;
+
+    D3D11_SAMPLER_DESC sampler_desc = {};
+    sampler_desc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+    sampler_desc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+    sampler_desc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+    sampler_desc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+    sampler_desc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+    sampler_desc.MaxLOD = D3D11_FLOAT32_MAX;
+    if (FAILED(device->CreateSamplerState(&sampler_desc, &g_linear_sampler)))
+        return false;
+
+    sampler_desc.AddressU = D3D11_TEXTURE_ADDRESS_MIRROR;
+    sampler_desc.AddressV = D3D11_TEXTURE_ADDRESS_MIRROR;
+    sampler_desc.AddressW = D3D11_TEXTURE_ADDRESS_MIRROR;
+    if (FAILED(device->CreateSamplerState(&sampler_desc, &g_mirror_sampler)))
+        return false;
+
+    D3D11_RASTERIZER_DESC raster_desc = {};
+    raster_desc.FillMode = D3D11_FILL_SOLID;
+    raster_desc.CullMode = D3D11_CULL_NONE;
+    raster_desc.ScissorEnable = TRUE;
+    raster_desc.DepthClipEnable = FALSE;
+    if (FAILED(device->CreateRasterizerState(&raster_desc, &g_rasterizer_state)))
+        return false;
+
+    D3D11_QUERY_DESC predicate_desc = {};
+    predicate_desc.Query = D3D11_QUERY_OCCLUSION_PREDICATE;
+    if (FAILED(device->CreatePredicate(&predicate_desc, &g_change_predicate)))
+        return false;
+
+    D3D11_BLEND_DESC blend_desc = {};
+    blend_desc.RenderTarget[0].BlendEnable = FALSE;
+    blend_desc.RenderTarget[0].RenderTargetWriteMask = 0;
+    if (FAILED(device->CreateBlendState(&blend_desc, &g_no_write_blend)))
+        return false;
+
+    if (!create_timing_objects(device))
+        destroy_timing_objects();
+
+    g_device = device;
+    end_setup_report();
+    return set_backend(IM_NEW(Dx11Backend));
+}
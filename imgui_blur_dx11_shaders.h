@@ -0,0 +1,537 @@
+#pragma once
+
+#include "imgui_blur_internal.h"
+
+#include <d3dcompiler.h>
+#include <string.h>
+
+// HLSL of the D3D11 backend, shared with tools/shadergen.cpp which embeds their bytecode.
+
+static const char* g_vertex_src = R"(
+struct VS_INPUT {
+    float2 pos : POSITION;
+    float2 uv : TEXCOORD0;
+};
+
+struct PS_INPUT {
+    float4 pos : SV_POSITION;
+    float2 uv : TEXCOORD0;
+};
+
+PS_INPUT main(VS_INPUT input) {
+    PS_INPUT output;
+    output.pos = float4(input.pos, 0.0f, 1.0f);
+    output.uv = input.uv;
+    return output;
+}
+)";
+
+static const char* g_downsample_src = R"(
+cbuffer BlurConstants : register(b0) {
+    float2 half_pixel;
+    float offset;
+    float noise;
+    float2 input_scale;      // area in use / texture size
+    float2 input_half_texel; // in uv of the area in use
+};
+
+Texture2D input_texture : register(t0);
+SamplerState input_sampler : register(s0);
+
+// Pooled inputs only fill the top left of their texture: mirror at the edges of the area in use
+// and keep the bilinear footprint inside it, which matches a mirror sampler on an exact fit texture.
+float4 sample_input(float2 uv) {
+    uv = 1.0 - abs(1.0 - abs(uv));
+    uv = clamp(uv, input_half_texel, 1.0 - input_half_texel);
+    return input_texture.Sample(input_sampler, uv * input_scale);
+}
+
+float4 main(float4 pos : SV_POSITION, float2 uv : TEXCOORD) : SV_Target {
+    float4 sum = sample_input(uv) * 4.0;
+    sum += sample_input(uv - half_pixel * offset);
+    sum += sample_input(uv + half_pixel * offset);
+    sum += sample_input(uv + float2(half_pixel.x, -half_pixel.y) * offset);
+    sum += sample_input(uv - float2(half_pixel.x, -half_pixel.y) * offset);
+    float4 result = sum / 8.0;
+    if (noise > 0.0) {
+        result.rgb += ((frac(sin(dot(pos.xy, float2(12.9898, 78.233))) * 43758.5453)
+                      + frac(sin(dot(pos.xy * 0.1, float2(7.898, 4.233))) * 23421.631)) * 0.5 - 0.5)
+                      * noise * 0.3;
+    }
+    return result;
+}
+)";
+
+// main() is the upsample pass of the chain. render_upsample() is the final upsample drawn by blur::render() straight from
+// a level: ImGui's vertex shader feeds it, so uvs come from the pixel position and the vertex color tints the result.
+// For render() radii it mixes in a second level by 'blend'.
+static const char* g_upsample_src = R"(
+cbuffer BlurConstants : register(b0) {
+    float2 half_pixel;
+    float offset;
+    float noise;
+    float2 input_scale;      // area in use / texture size
+    float2 input_half_texel; // in uv of the area in use
+    // render_upsample() only
+    float opacity;
+    float blend;
+    float2 spacing;          // tap distance on level_texture, in uv
+    float2 blend_scale;
+    float2 blend_half_texel;
+    float2 blend_spacing;
+};
+
+Texture2D input_texture : register(t0);
+Texture2D level_texture : register(t1);
+Texture2D blend_texture : register(t2);
+SamplerState input_sampler : register(s0);
+
+// Pooled inputs only fill the top left of their texture: mirror at the edges of the area in use
+// and keep the bilinear footprint inside it, which matches a mirror sampler on an exact fit texture.
+float4 sample_input(Texture2D input, float2 uv, float2 scale, float2 half_texel) {
+    uv = 1.0 - abs(1.0 - abs(uv));
+    uv = clamp(uv, half_texel, 1.0 - half_texel);
+    return input.Sample(input_sampler, uv * scale);
+}
+
+float4 upsample(Texture2D input, float2 uv, float2 spread, float2 scale, float2 half_texel) {
+    float4 sum = sample_input(input, uv + float2(-spread.x * 2.0, 0.0) * offset, scale, half_texel);
+    sum += sample_input(input, uv + float2(-spread.x, spread.y) * offset, scale, half_texel) * 2.0;
+    sum += sample_input(input, uv + float2(0.0, spread.y * 2.0) * offset, scale, half_texel);
+    sum += sample_input(input, uv + float2(spread.x, spread.y) * offset, scale, half_texel) * 2.0;
+    sum += sample_input(input, uv + float2(spread.x * 2.0, 0.0) * offset, scale, half_texel);
+    sum += sample_input(input, uv + float2(spread.x, -spread.y) * offset, scale, half_texel) * 2.0;
+    sum += sample_input(input, uv + float2(0.0, -spread.y * 2.0) * offset, scale, half_texel);
+    sum += sample_input(input, uv + float2(-spread.x, -spread.y) * offset, scale, half_texel) * 2.0;
+    return sum / 12.0;
+}
+
+float4 add_noise(float4 result, float2 pos) {
+    if (noise > 0.0) {
+        result.rgb += ((frac(sin(dot(pos, float2(12.9898, 78.233))) * 43758.5453)
+                      + frac(sin(dot(pos * 0.1, float2(7.898, 4.233))) * 23421.631)) * 0.5 - 0.5)
+                      * noise * 0.3;
+    }
+    return result;
+}
+
+float4 main(float4 pos : SV_POSITION, float2 uv : TEXCOORD) : SV_Target {
+    return add_noise(upsample(input_texture, uv, half_pixel, input_scale, input_half_texel), pos.xy);
+}
+
+float4 render_upsample(float4 pos : SV_POSITION, float4 col : COLOR0, float2 uv : TEXCOORD0) : SV_Target {
+    float2 screen_uv = pos.xy * half_pixel * 2.0;
+    float4 result = upsample(level_texture, screen_uv, spacing, input_scale, input_half_texel);
+    if (blend > 0.0)
+        result = lerp(result, upsample(blend_texture, screen_uv, blend_spacing, blend_scale, blend_half_texel), blend);
+    result = add_noise(result, pos.xy) * col;
+    return float4(result.rgb, result.a * opacity);
+}
+)";
+
+// One axis of a separable gaussian at the size of its input, see imgui_blur_kernels.h. The kernel is one of the
+// immutable GaussianKernel buffers Dx11Backend creates at setup from blur::gaussian_family, keep it in sync with
+// GaussianConstants on the C++ side.
+static const char* g_gaussian_src = R"(
+#define MAX_TAPS 13
+
+cbuffer BlurConstants : register(b0) {
+    float2 half_pixel;
+    float offset;
+    float noise;
+    float2 input_scale;      // area in use / texture size
+    float2 input_half_texel; // in uv of the area in use
+    float opacity;
+    float blend;
+    float2 spacing;          // one input texel along the blurred axis, in uv
+};
+
+cbuffer GaussianKernel : register(b1) {
+    float4 taps[MAX_TAPS]; // texels from the center, weight
+    int tap_count;
+};
+
+Texture2D input_texture : register(t0);
+SamplerState input_sampler : register(s0);
+
+// Pooled inputs only fill the top left of their texture: mirror at the edges of the area in use
+// and keep the bilinear footprint inside it, which matches a mirror sampler on an exact fit texture.
+float4 sample_input(float2 uv) {
+    uv = 1.0 - abs(1.0 - abs(uv));
+    uv = clamp(uv, input_half_texel, 1.0 - input_half_texel);
+    return input_texture.Sample(input_sampler, uv * input_scale);
+}
+
+float4 main(float4 pos : SV_POSITION, float2 uv : TEXCOORD) : SV_Target {
+    float4 result = sample_input(uv) * taps[0].y;
+    // A constant bound lets the compiler unroll the loop.
+    for (int i = 1; i < MAX_TAPS; ++i) {
+        if (i >= tap_count)
+            break;
+        result += sample_input(uv - spacing * taps[i].x) * taps[i].y;
+        result += sample_input(uv + spacing * taps[i].x) * taps[i].y;
+    }
+    if (noise > 0.0) {
+        result.rgb += ((frac(sin(dot(pos.xy, float2(12.9898, 78.233))) * 43758.5453)
+                      + frac(sin(dot(pos.xy * 0.1, float2(7.898, 4.233))) * 23421.631)) * 0.5 - 0.5)
+                      * noise * 0.3;
+    }
+    return result;
+}
+)";
+
+// Occlusion predicate source for ProcessFlags_ContentHash: only texels that differ from the copy of the previous capture survive.
+static const char* g_compare_src = R"(
+Texture2D current_texture : register(t0);
+Texture2D previous_texture : register(t1);
+
+void main(float4 pos : SV_POSITION) {
+    int3 texel = int3(pos.xy, 0);
+    if (all(current_texture.Load(texel) == previous_texture.Load(texel)))
+        discard;
+}
+)";
+
+// Compute path, see blur::ChainPath_Compute. One source with an entry point per dispatch, so every kernel shares the
+// constants and views below. Levels are RGBA8 textures written through R32_UINT views, colors are packed by hand.
+// ChainConstants is filled once per chain by Dx11Backend::render_passes(); keep it in sync with the C++ side.
+static const char* g_chain_src = R"(
+#define TILE_SIZE 8
+#define MAX_LEVELS 7
+#define MAX_PASSES 16
+#define MAX_REGIONS 8
+
+cbuffer ChainConstants : register(b0) {
+    uint level_count; // downsample passes, level k is written by pass k
+    float offset;
+    float noise;
+    uint pass_count;
+    uint4 level_info[MAX_LEVELS];   // width, height, tiles per row, first counter
+    uint4 pass_info[MAX_PASSES];    // target width, height, region count, dispatch origin (x | y << 16)
+    float4 pass_input[MAX_PASSES];  // input area in use / texture size, half texel of the input
+    int4 pass_regions[MAX_PASSES * MAX_REGIONS];
+};
+
+cbuffer PassConstants : register(b1) {
+    uint pass_index; // upsample and difference dispatches
+};
+
+SamplerState input_sampler : register(s0);
+
+uint pack_color(float4 color) {
+    const uint4 c = uint4(round(saturate(color) * 255.0));
+    return c.r | (c.g << 8) | (c.b << 16) | (c.a << 24);
+}
+
+float4 unpack_color(uint packed) {
+    return float4(packed & 0xFF, (packed >> 8) & 0xFF, (packed >> 16) & 0xFF, packed >> 24) / 255.0;
+}
+
+float3 grain(float2 pos) {
+    return ((frac(sin(dot(pos, float2(12.9898, 78.233))) * 43758.5453)
+           + frac(sin(dot(pos * 0.1, float2(7.898, 4.233))) * 23421.631)) * 0.5 - 0.5)
+           * noise * 0.3;
+}
+
+bool in_regions(uint index, int2 p) {
+    for (uint i = 0; i < pass_info[index].z; ++i) {
+        const int4 region = pass_regions[index * MAX_REGIONS + i];
+        if (all(p >= region.xy) && all(p < region.zw))
+            return true;
+    }
+    return false;
+}
+
+// Same addressing as sample_input() in the pixel shaders.
+float4 sample_texture(Texture2D tex, uint index, float2 uv) {
+    uv = 1.0 - abs(1.0 - abs(uv));
+    uv = clamp(uv, pass_input[index].zw, 1.0 - pass_input[index].zw);
+    return tex.SampleLevel(input_sampler, uv * pass_input[index].xy, 0);
+}
+
+#define NO_WORK 0xFFFFFFFF
+#define STACK_SIZE 64
+
+Texture2D source_texture : register(t0);
+Texture2D input_texture : register(t1);  // upsample input, the pixel shader result when verifying
+Texture2D result_texture : register(t2); // compute result when verifying
+globallycoherent RWTexture2D<uint> level0 : register(u0); // also the upsample target
+globallycoherent RWTexture2D<uint> level1 : register(u1);
+globallycoherent RWTexture2D<uint> level2 : register(u2);
+globallycoherent RWTexture2D<uint> level3 : register(u3);
+globallycoherent RWTexture2D<uint> level4 : register(u4);
+globallycoherent RWTexture2D<uint> level5 : register(u5);
+globallycoherent RWTexture2D<uint> level6 : register(u6);
+globallycoherent RWByteAddressBuffer counters : register(u7); // tile counters, the difference when verifying
+
+groupshared uint g_stack[STACK_SIZE];
+groupshared uint g_stack_size;
+groupshared uint g_next;
+
+uint load_level(uint level, int2 p) {
+    uint packed = 0;
+    [branch] switch (level) {
+    case 0: packed = level0[p]; break;
+    case 1: packed = level1[p]; break;
+    case 2: packed = level2[p]; break;
+    case 3: packed = level3[p]; break;
+    case 4: packed = level4[p]; break;
+    case 5: packed = level5[p]; break;
+    default: packed = level6[p]; break;
+    }
+    return packed;
+}
+
+void store_level(uint level, int2 p, uint packed) {
+    [branch] switch (level) {
+    case 0: level0[p] = packed; break;
+    case 1: level1[p] = packed; break;
+    case 2: level2[p] = packed; break;
+    case 3: level3[p] = packed; break;
+    case 4: level4[p] = packed; break;
+    case 5: level5[p] = packed; break;
+    default: level6[p] = packed; break;
+    }
+}
+
+int2 level_size(uint level) {
+    return (int2)level_info[level].xy;
+}
+
+int2 level_tiles(uint level) {
+    return (level_size(level) + TILE_SIZE - 1) / TILE_SIZE;
+}
+
+// Bilinear tap on a level written earlier in this dispatch, addressed like sample_texture() and filtered
+// with the 8-bit subtexel precision of the sampler.
+float4 sample_level(uint level, float2 uv) {
+    const int2 size = level_size(level);
+    uv = 1.0 - abs(1.0 - abs(uv));
+    uv = clamp(uv, 0.5 / size, 1.0 - 0.5 / size);
+    const float2 t = uv * size - 0.5;
+    const int2 i0 = clamp((int2)floor(t), 0, size - 1);
+    const int2 i1 = min(i0 + 1, size - 1);
+    const float2 f = floor(saturate(t - i0) * 256.0 + 0.5) / 256.0;
+    const float4 top = lerp(unpack_color(load_level(level, int2(i0.x, i0.y))), unpack_color(load_level(level, int2(i1.x, i0.y))), f.x);
+    const float4 bottom = lerp(unpack_color(load_level(level, int2(i0.x, i1.y))), unpack_color(load_level(level, int2(i1.x, i1.y))), f.x);
+    return lerp(top, bottom, f.y);
+}
+
+float4 downsample(uint level, int2 p) {
+    const float2 size = (float2)level_size(level);
+    const float2 uv = (p + 0.5) / size;
+    const float2 half_pixel = 0.5 / size * offset;
+    const float2 diagonal = float2(half_pixel.x, -half_pixel.y);
+
+    float4 sum;
+    [branch] if (level == 0) {
+        sum = sample_texture(source_texture, 0, uv) * 4.0;
+        sum += sample_texture(source_texture, 0, uv - half_pixel);
+        sum += sample_texture(source_texture, 0, uv + half_pixel);
+        sum += sample_texture(source_texture, 0, uv + diagonal);
+        sum += sample_texture(source_texture, 0, uv - diagonal);
+    } else {
+        sum = sample_level(level - 1, uv) * 4.0;
+        sum += sample_level(level - 1, uv - half_pixel);
+        sum += sample_level(level - 1, uv + half_pixel);
+        sum += sample_level(level - 1, uv + diagonal);
+        sum += sample_level(level - 1, uv - diagonal);
+    }
+
+    float4 result = sum / 8.0;
+    if (noise > 0.0)
+        result.rgb += grain(p + 0.5);
+    return result;
+}
+
+bool tile_active(uint level, int2 tile) {
+    const int4 rect = int4(tile * TILE_SIZE, tile * TILE_SIZE + TILE_SIZE);
+    for (uint i = 0; i < pass_info[level].z; ++i) {
+        const int4 region = pass_regions[level * MAX_REGIONS + i];
+        if (all(rect.xy < region.zw) && all(region.xy < rect.zw))
+            return true;
+    }
+    return false;
+}
+
+// Tiles of level - 1 that a tile of 'level' reads, taps folded back at the edges included, with a texel of slack.
+int4 dependency_range(uint level, int2 tile) {
+    const float2 size = (float2)level_size(level);
+    const int2 input_size = level_size(level - 1);
+    const float2 reach = 0.5 / size * offset;
+    float2 first = (tile * TILE_SIZE + 0.5) / size - reach;
+    float2 last = (min(tile * TILE_SIZE + TILE_SIZE, (int2)size) - 0.5) / size + reach;
+    last = first < 0.0 ? max(last, -first) : last;
+    first = last > 1.0 ? min(first, 2.0 - last) : first;
+
+    const int2 lo = clamp((int2)floor(first * input_size - 0.5) - 1, 0, input_size - 1);
+    const int2 hi = clamp((int2)floor(last * input_size - 0.5) + 2, 0, input_size - 1);
+    return int4(lo / TILE_SIZE, hi / TILE_SIZE);
+}
+
+uint dependency_count(uint level, int2 tile) {
+    const int4 range = dependency_range(level, tile);
+    uint count = 0;
+    for (int y = range.y; y <= range.w; ++y) {
+        for (int x = range.x; x <= range.z; ++x) {
+            if (tile_active(level - 1, int2(x, y)))
+                ++count;
+        }
+    }
+    return count;
+}
+
+uint pack_work(uint level, int2 tile) {
+    return (level << 28) | ((uint)tile.y << 14) | (uint)tile.x;
+}
+
+// Called by one thread once 'tile' of 'level' is visible to every group.
+void signal_dependents(uint level, int2 tile) {
+    const uint next = level + 1;
+    const int2 tiles = level_tiles(next);
+    const float2 ratio = (float2)level_size(next) / (float2)level_size(level);
+    const int2 center = (int2)((tile * TILE_SIZE + TILE_SIZE / 2) * ratio) / TILE_SIZE;
+    const int span = 2 + (int)ceil(offset / TILE_SIZE);
+
+    for (int y = max(center.y - span, 0); y <= min(center.y + span, tiles.y - 1); ++y) {
+        for (int x = max(center.x - span, 0); x <= min(center.x + span, tiles.x - 1); ++x) {
+            const int2 dependent = int2(x, y);
+            if (!tile_active(next, dependent))
+                continue;
+
+            const int4 range = dependency_range(next, dependent);
+            if (any(tile < range.xy) || any(tile > range.zw))
+                continue;
+
+            uint arrived;
+            counters.InterlockedAdd((level_info[next].w + y * tiles.x + x) * 4, 1, arrived);
+            if (arrived + 1 == dependency_count(next, dependent) && g_stack_size < STACK_SIZE)
+                g_stack[g_stack_size++] = pack_work(next, dependent);
+        }
+    }
+}
+
+// One dispatch for every downsample pass. Each group starts on a tile of level 0; finishing a tile bumps a counter on
+// every tile of the next level that reads it, and the group that completes a counter goes on to compute that tile.
+// Levels are read back through globally coherent views, so a tile only starts once all of its inputs are written.
+[numthreads(TILE_SIZE, TILE_SIZE, 1)]
+void downsample_chain(uint3 group : SV_GroupID, uint3 thread : SV_GroupThreadID) {
+    const bool leader = thread.x == 0 && thread.y == 0;
+    if (leader)
+        g_stack_size = 0;
+
+    uint work = tile_active(0, (int2)group.xy) ? pack_work(0, (int2)group.xy) : NO_WORK;
+    [loop] while (work != NO_WORK) {
+        const uint level = work >> 28;
+        const int2 tile = int2(work & 0x3FFF, (work >> 14) & 0x3FFF);
+        const int2 p = tile * TILE_SIZE + (int2)thread.xy;
+        if (all(p < level_size(level)) && in_regions(level, p))
+            store_level(level, p, pack_color(downsample(level, p)));
+
+        // The tile has to be visible to every group before any of them can learn that it is done.
+        DeviceMemoryBarrierWithGroupSync();
+        if (leader) {
+            if (level + 1 < level_count)
+                signal_dependents(level, tile);
+            g_next = g_stack_size > 0 ? g_stack[--g_stack_size] : NO_WORK;
+        }
+        GroupMemoryBarrierWithGroupSync();
+        work = g_next;
+        // Every thread has to read g_next before the leader can overwrite it.
+        GroupMemoryBarrierWithGroupSync();
+    }
+}
+
+// One dispatch per upsample pass over the bounds of its regions, no render target switches or clears.
+[numthreads(TILE_SIZE, TILE_SIZE, 1)]
+void upsample(uint3 id : SV_DispatchThreadID) {
+    const uint4 info = pass_info[pass_index];
+    const int2 p = (int2)id.xy + int2(info.w & 0xFFFF, info.w >> 16);
+    if (any(p >= (int2)info.xy) || !in_regions(pass_index, p))
+        return;
+
+    const float2 uv = (p + 0.5) / (float2)info.xy;
+    const float2 half_pixel = 0.5 / (float2)info.xy;
+    float4 sum = sample_texture(input_texture, pass_index, uv + float2(-half_pixel.x * 2.0, 0.0) * offset);
+    sum += sample_texture(input_texture, pass_index, uv + float2(-half_pixel.x, half_pixel.y) * offset) * 2.0;
+    sum += sample_texture(input_texture, pass_index, uv + float2(0.0, half_pixel.y * 2.0) * offset);
+    sum += sample_texture(input_texture, pass_index, uv + float2(half_pixel.x, half_pixel.y) * offset) * 2.0;
+    sum += sample_texture(input_texture, pass_index, uv + float2(half_pixel.x * 2.0, 0.0) * offset);
+    sum += sample_texture(input_texture, pass_index, uv + float2(half_pixel.x, -half_pixel.y) * offset) * 2.0;
+    sum += sample_texture(input_texture, pass_index, uv + float2(0.0, -half_pixel.y * 2.0) * offset);
+    sum += sample_texture(input_texture, pass_index, uv + float2(-half_pixel.x, -half_pixel.y) * offset) * 2.0;
+    float4 result = sum / 12.0;
+    if (noise > 0.0)
+        result.rgb += grain(p + 0.5);
+    level0[p] = pack_color(result);
+}
+
+// IMGUI_BLUR_COMPUTE_VERIFY: largest channel difference between the pixel shader and compute results of a pass.
+[numthreads(TILE_SIZE, TILE_SIZE, 1)]
+void difference(uint3 id : SV_DispatchThreadID) {
+    const uint4 info = pass_info[pass_index];
+    const int2 p = (int2)id.xy + int2(info.w & 0xFFFF, info.w >> 16);
+    if (any(p >= (int2)info.xy) || !in_regions(pass_index, p))
+        return;
+
+    const uint4 reference = uint4(round(input_texture.Load(int3(p, 0)) * 255.0));
+    const uint4 result = uint4(round(result_texture.Load(int3(p, 0)) * 255.0));
+    const uint4 delta = max(reference, result) - min(reference, result);
+    counters.InterlockedMax(0, max(max(delta.r, delta.g), max(delta.b, delta.a)));
+}
+)";
+
+enum Dx11Shader {
+    Dx11Shader_Vertex,
+    Dx11Shader_Downsample,
+    Dx11Shader_Upsample,
+    Dx11Shader_RenderUpsample,
+    Dx11Shader_Compare,
+    Dx11Shader_Gaussian,
+    Dx11Shader_DownsampleChain,
+    Dx11Shader_UpsampleCS,
+    Dx11Shader_Difference,
+    Dx11Shader_Count,
+};
+
+static const blur::ShaderSource g_dx11_shaders[Dx11Shader_Count] = {
+    { "vertex", g_vertex_src, "main", "vs_5_0" },
+    { "kawase downsample", g_downsample_src, "main", "ps_5_0" },
+    { "kawase upsample", g_upsample_src, "main", "ps_5_0" },
+    { "kawase render upsample", g_upsample_src, "render_upsample", "ps_5_0" },
+    { "content compare", g_compare_src, "main", "ps_5_0" },
+    { "gaussian", g_gaussian_src, "main", "ps_5_0" },
+    { "downsample chain", g_chain_src, "downsample_chain", "cs_5_0" },
+    { "kawase upsample cs", g_chain_src, "upsample", "cs_5_0" },
+    { "chain difference", g_chain_src, "difference", "cs_5_0" },
+};
+
+class D3DShaderCompiler : public blur::ShaderCompiler {
+public:
+    ImU64 version() override {
+        return D3D_COMPILER_VERSION;
+    }
+
+    bool compile(const blur::ShaderSource& shader, ImVector<unsigned char>& bytecode) override {
+        ID3DBlob* shader_blob = nullptr;
+        ID3DBlob* error_blob = nullptr;
+        if (FAILED(D3DCompile(shader.source, strlen(shader.source), nullptr, nullptr, nullptr, shader.entry, shader.target, 0, 0, &shader_blob, &error_blob))) {
+            if (error_blob == nullptr) {
+                // LOG_ERROR("shader {} failed to compile unexpectedly", shader.name);
+                return false;
+            }
+
+            // LOG_ERROR("shader {} compilation failed:\n{}", shader.name, (char*)error_blob->GetBufferPointer());
+            error_blob->Release();
+            return false;
+        }
+
+        if (error_blob != nullptr) error_blob->Release();
+        // LOG_TRACE("successfully compiled shader {}", shader.name);
+
+        bytecode.resize((int)shader_blob->GetBufferSize());
+        memcpy(bytecode.Data, shader_blob->GetBufferPointer(), shader_blob->GetBufferSize());
+        shader_blob->Release();
+        return true;
+    }
+};
@@ -0,0 +1,441 @@
+#pragma once
+
+#include "imgui_blur.h"
+#include "imgui_blur_kernels.h"
+
+#include <atomic>
+#include <mutex>
+
+#ifndef IMGUI_BLUR_TIMER_QUERY_SETS
+#define IMGUI_BLUR_TIMER_QUERY_SETS 8 // chains whose timer queries can be in flight at once, see Backend::begin_timing()
+#endif
+
+// Shared between the blur core (imgui_blur.cpp) and its backends (imgui_blur_dx11.cpp, imgui_blur_opengl3.cpp,
+// imgui_blur_cpu.cpp).
+// Nothing in here is part of the public API.
+
+namespace blur {
+	// The separable kernels run along one axis at the size of their input, with the pass offset as the standard
+	// deviation in texels, see imgui_blur_kernels.h. The box kernels are only run by backends with
+	// KernelCosts::box_axis set.
+	enum Kernel {
+		Kernel_Downsample,
+		Kernel_Upsample,
+		Kernel_GaussianX,
+		Kernel_GaussianY,
+		Kernel_BoxX,
+		Kernel_BoxY,
+	};
+
+	// Pixel rectangle [x0, x1) x [y0, y1) inside one framebuffer.
+	class Rect {
+	public:
+		int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+	};
+
+	// The few rectangles a pass has to produce. Overlapping rectangles are merged and once the set is full
+	// the pair that grows the least is merged, so the set never loses coverage.
+	class RegionSet {
+	public:
+		static const int capacity = 8;
+
+		void add(Rect rect);
+		bool covers(const RegionSet& other) const;
+		bool operator==(const RegionSet& other) const;
+
+		Rect rects[capacity];
+		int count = 0;
+	};
+
+	enum ContentCheck {
+		ContentCheck_Changed,
+		ContentCheck_Unchanged,
+	};
+
+	// Formats of captured frames and pyramid levels. Sampling an sRGB texture returns linear colors and rendering into
+	// one encodes them again, the passes themselves never see the encoding.
+	enum Format {
+		Format_RGBA8,
+		Format_RGBA8_SRGB,
+		Format_RGB10A2,
+		Format_R11G11B10F,
+		Format_RGBA16F,
+		Format_RGB565,
+		Format_COUNT,
+	};
+
+	int format_bytes(Format format);
+
+	// Per-frame counters reported by blur::get_stats().
+	enum Counter {
+		Counter_Chains,
+		Counter_Passes,
+		Counter_FramebuffersCreated, // bumped by FramebufferPool
+		Counter_ViewsCreated,        // bumped by backends
+		Counter_ConstantUpdates,     // bumped by backends
+		Counter_COUNT
+	};
+
+	// Thread safe, counts towards the frame ImGui is on.
+	void count(Counter counter, int amount = 1);
+
+	// Timestamps one chain can write, enough for every pass of a Stats::max_levels deep pyramid.
+	static const int max_timestamps = 2 * Stats::max_levels;
+
+	// Framebuffers are pooled, so the area in use is often smaller than the texture behind it.
+	// It always starts at the top left texel; passes set their viewport to it and clamp their taps inside it.
+	class Framebuffer {
+	public:
+		void* handle = nullptr; // backend owned
+		int width = 0, height = 0; // area in use
+		int texture_width = 0, texture_height = 0;
+		Format format = Format_RGBA8;
+	};
+
+	// One step of a chain as handed to Backend::render_passes().
+	class Pass {
+	public:
+		const Framebuffer* target;
+		const Framebuffer* input;
+		Kernel kernel;
+		float offset;      // handed to Backend::render_pass()
+		RegionSet regions; // empty when nothing downstream samples the target
+	};
+
+	// What BoundState::bind_pass() found a pass has to bind besides its target, which is always bound.
+	class PassBinds {
+	public:
+		bool unbind_input = false; // the target is still bound as the last pass's input and has to leave that slot first
+		bool viewport = false;
+		bool shader = false;
+		bool constants = false;
+		bool kernel = false;
+		bool input = false;
+	};
+
+	// What a pixel shader backend has bound between the passes of a chain, so render_pass() only issues the binds that
+	// change. Handles are the backend's own views, shaders and buffers, compared by identity. 'kernel' is the constant
+	// buffer of a separable kernel, passes without one pass nullptr and leave it bound.
+	class BoundState {
+	public:
+		PassBinds bind_pass(const void* target, const void* input, const void* shader, const void* constants, const void* kernel, int width, int height);
+		// Anything else touched the pipeline, the next pass binds everything.
+		void forget() { *this = BoundState{}; }
+
+		const void* input = nullptr;
+		const void* shader = nullptr;
+		const void* constants = nullptr;
+		const void* kernel = nullptr;
+		int width = 0, height = 0;
+	};
+
+	// The passes of one chain with their regions, compiled by run_chain() and replayed for as long as nothing they
+	// depend on changes. Passes point at the chain's own slots, which stay put while transient levels come and go.
+	class PassGraph {
+	public:
+		Algorithm algorithm = Algorithm_Kawase;
+		int iterations = -1;
+		int source_width = 0, source_height = 0;
+		int output_width = 0, output_height = 0;
+		float scale = 0.0f, offset = 0.0f;
+		bool write_output = false;
+		bool keep_levels = false;
+		bool incremental = false;
+		RegionSet output_regions;
+
+		ImVector<Pass> passes;
+		ImVector<int> marks;      // what the timestamp after each pass measures, see ChainTiming::marks
+		RegionSet source_regions; // everything the passes read from the captured frame
+	};
+
+	// Everything one process() call renders into. The core keeps one per distinct call in a frame.
+	class Chain {
+	public:
+		// Only level 0 outlives a run, the deeper levels are transient: they come from the pool for the passes and go
+		// back right after, so every chain of a frame runs on the same textures. While render() asks for a radius they
+		// are kept instead and hold the downsampled frame, the upsample passes write 'scratch' in their place.
+		// Separable chains only have level 0, blurred along x into 'scratch' and back along y. ProcessFlags_Incremental
+		// chains keep every level and scratch level, and downsample level 0 into the last scratch level so the final
+		// upsample does not overwrite what the next frame downsamples from.
+		ImVector<Framebuffer> levels;
+		ImVector<Framebuffer> scratch; // levels 1..iterations - 1 of the upsample passes or the separable half, transient
+		// Display sized. Only backed by a texture while get_texture() asks for it or the backend cannot fuse the final
+		// upsample into blur::render(), see Backend::begin_render_upsample(); otherwise only its size is used.
+		Framebuffer output;
+		void* content_state = nullptr; // backend owned, see Backend::begin_content_check()
+		PassGraph graph;
+		ImVector<Pass> damaged_passes; // graph.passes limited to the damaged tiles, rebuilt by every incremental run
+	};
+
+	// What blur::render() draws from, see Backend::begin_render_upsample(). Each level is upsampled with its taps
+	// 'spacing' apart (half a pixel of the level it would be upsampled into, in uv); 'blend' mixes the second one in.
+	class RenderSource {
+	public:
+		const Framebuffer* levels[2] = {};
+		ImVec2 spacing[2];
+		float blend = 0.0f;
+		float opacity = 1.0f; // scales the alpha only
+	};
+
+	// How complete BlurParameters::damage is, see blur::add_damage().
+	enum DamageState {
+		DamageState_Unknown,  // nothing was reported, anything may have changed
+		DamageState_Reported, // every change is in the list, which may be empty
+		DamageState_Lost,     // a rectangle did not fit into the frame arena
+	};
+
+	class RegionNode {
+	public:
+		ImVec4 rect; // viewport pixels, display space minus BlurParameters::origin
+		RegionNode* next = nullptr;
+	};
+
+	// Lives in the frame arena of the process() call that recorded it and is never destroyed, keep it trivial.
+	class BlurParameters {
+	public:
+		Algorithm algorithm = Algorithm_Kawase; // never Algorithm_Auto
+		int iterations = 4; // 0 for the separable algorithms
+		float offset = 3.0f; // the standard deviation in level 0 texels for the separable algorithms
+		float noise = 0.0f;
+		float scale = 1.0f;
+		ProcessFlags flags = 0;
+		PyramidFormat format = PyramidFormat_Auto;
+		PyramidFormat deep_format = PyramidFormat_Auto;
+		int deep_level = 2;
+		ImVec2 origin = { 0.0f, 0.0f }; // display position of the viewport's top left pixel, regions and damage are relative to it
+		std::atomic<RegionNode*> regions{ nullptr }; // sampled this frame, pushed by any thread, see blur::add_region()
+		std::atomic<RegionNode*> damage{ nullptr };  // changed since the last frame, see blur::add_damage()
+		std::atomic<int> damage_state{ DamageState_Unknown };
+		std::atomic<bool> output_requested{ false }; // the final upsample has to be written to Chain::output
+		std::atomic<bool> levels_requested{ false }; // render() was given a radius, the downsampled levels are kept
+
+		Chain* chain = nullptr; // claimed by process() for this frame
+	};
+
+	// What blur::select_algorithm() weighs the algorithms by, in units of one bilinear tap at one pixel.
+	class KernelCosts {
+	public:
+		float tap = 1.0f;
+		float box_axis = 0.0f;    // Kernel_BoxX or Kernel_BoxY at one pixel whatever the radius, 0 when not supported
+		float pass = 65536.0f;    // fixed cost of every pass, whatever its size
+	};
+
+	// A backend owns every device object and executes the passes the core schedules.
+	// The core decides the pyramid layout and pass order, see run_chain().
+	class Backend {
+	public:
+		virtual ~Backend() {}
+
+		// Only called by FramebufferPool, which is also what counts the bytes behind them.
+		virtual bool create_framebuffer(Framebuffer& framebuffer, int width, int height, Format format) = 0;
+		// Formats create_framebuffer() can render to and sample, the core picks level formats among them.
+		virtual bool supports_format(Format format) { return format == Format_RGBA8; }
+		virtual void destroy_framebuffer(Framebuffer& framebuffer) = 0;
+		virtual ImTextureID get_texture_id(const Framebuffer& framebuffer) = 0;
+
+		// Called from the draw callback. Fills 'source' with whatever the renderer is currently drawing into, including
+		// the format it is viewed as, and saves any state the passes clobber. Returning false skips the chain.
+		virtual bool begin_chain(Framebuffer& source) = 0;
+		// Only the pixels inside 'regions' have to be written, everything else in 'target' is never sampled.
+		// 'offset' spaces the Kawase taps, for the separable kernels it is the standard deviation.
+		virtual void render_pass(const Framebuffer& target, const Framebuffer& input, Kernel kernel, float offset, float noise, const RegionSet& regions) = 0;
+		virtual void end_chain() = 0;
+		// Optional: runs a whole chain at once, 'passes' are the downsamples (level i is written by pass i) followed by
+		// the upsamples, or the passes of a separable chain. Returning false makes the core fall back to render_pass()
+		// for every pass.
+		virtual bool render_passes(const Pass* passes, int count, float offset, float noise) { return false; }
+		virtual KernelCosts kernel_costs() { return KernelCosts{}; }
+
+		// ProcessFlags_ContentHash: fingerprints 'regions' of the source and remembers them in 'state' for the next call
+		// on the same chain. 'state' starts out null and is handed to destroy_content_state() with the chain.
+		// ContentCheck_Unchanged lets the core skip the passes; it may only be returned when 'allow_skip' is set.
+		// Backends that can only compare on the device return ContentCheck_Changed and skip the passes themselves
+		// until end_content_check() (e.g. with predication).
+		virtual ContentCheck begin_content_check(void*& state, const Framebuffer& source, const RegionSet& regions, bool allow_skip) { return ContentCheck_Changed; }
+		virtual void end_content_check() {}
+		virtual void destroy_content_state(void* state) {}
+
+		// Optional: the final upsample runs inside blur::render() instead of into a full resolution output, so only
+		// pixels under its shapes pay for it. Called from draw callbacks around the shapes blur::render() adds:
+		// begin binds a pixel shader that upsamples the source levels at each pixel of 'output' and multiplies the
+		// vertex color in (a null first level hides the shapes), end unbinds the levels. The renderer's
+		// ImDrawCallback_ResetRenderState follows and restores everything else.
+		virtual bool can_render_upsample() { return false; }
+		virtual void begin_render_upsample(const RenderSource& source, const Framebuffer& output, float offset, float noise) {}
+		virtual void end_render_upsample() {}
+
+		// Optional timer queries for blur::get_stats(), without them the core times the passes on the CPU.
+		// begin_timing() opens a query set for one chain after begin_chain() and returns false when every set is still
+		// in flight, it must never wait. timestamp() marks the end of the work submitted so far. read_timing() hands back
+		// the oldest closed set whose results arrived: its id and the milliseconds from begin_timing() to each
+		// timestamp(), with 'count' 0 when the results are unusable (e.g. a disjoint clock).
+		virtual bool has_timer_queries() { return false; }
+		virtual bool begin_timing(ImU32 id) { return false; }
+		virtual void timestamp() {}
+		virtual void end_timing() {}
+		virtual bool read_timing(ImU32& id, float* ms, int& count) { return false; }
+	};
+
+	// What each timestamp of a chain measured, filled by run_chain().
+	class ChainTiming {
+	public:
+		ImU32 id = 0;              // handed to Backend::begin_timing()
+		bool cpu = false;          // time on the CPU clock instead of timer queries
+		bool started = false;      // set by run_chain() once the passes are being timed
+		int marks[max_timestamps]; // level + 1 for a downsample, -(level + 1) for an upsample, 0 for a batch of passes
+		float ms[max_timestamps];  // only when 'cpu'
+		int count = 0;
+		double start_ms = 0.0;
+	};
+
+	// Recycles framebuffers across pyramid layouts. Textures are allocated in size buckets and reused for any smaller size
+	// that still fills half of them, so live resizes and iteration changes only allocate when they cross a bucket.
+	// Idle textures are destroyed least recently used first once they exceed the budget, see trim().
+	// Every call takes the pool's own lock, the draw callbacks run chains outside the core's lock.
+	class FramebufferPool {
+	public:
+		Framebuffer acquire(Backend* backend, int width, int height, Format format);
+		void release(Framebuffer& framebuffer);
+		// Points 'framebuffer' at 'width' x 'height', keeping its texture when it still fits. Returns false on allocation failure.
+		bool resize(Backend* backend, Framebuffer& framebuffer, int width, int height, Format format);
+		void trim(Backend* backend, size_t budget);
+		void clear(Backend* backend);
+		size_t idle_bytes() const;
+
+	private:
+		class Entry {
+		public:
+			Framebuffer framebuffer;
+			ImU64 released = 0;
+		};
+
+		Framebuffer acquire_locked(Backend* backend, int width, int height, Format format);
+		void release_locked(Framebuffer& framebuffer);
+
+		mutable std::mutex mutex;
+		ImVector<Entry> idle;
+		ImU64 clock = 0;
+	};
+
+	class ShaderSource {
+	public:
+		const char* name;
+		const char* source;
+		const char* entry;
+		const char* target;
+	};
+
+	// Bytecode embedded by tools/shadergen.cpp, see IMGUI_BLUR_PRECOMPILED_SHADERS.
+	class PrecompiledShader {
+	public:
+		const char* name;
+		ImU64 key; // shader_key() it was compiled for, a stale blob is ignored
+		const unsigned char* bytecode;
+		size_t size;
+		float compile_ms; // what compiling it took on the generating machine
+	};
+
+	// Turns HLSL (or any other shading language) into bytecode. D3DCompile on Windows; tests can plug in a stub.
+	class ShaderCompiler {
+	public:
+		virtual ~ShaderCompiler() {}
+
+		// Part of every cache key, bump it whenever the compiler or its flags change the output.
+		virtual ImU64 version() = 0;
+		virtual bool compile(const ShaderSource& shader, ImVector<unsigned char>& bytecode) = 0;
+	};
+
+	// Hash of the source, entry point, target and compiler version.
+	ImU64 shader_key(const ShaderSource& shader, ImU64 compiler_version);
+
+	// Finds bytecode for a shader: embedded blobs first, then the on-disk cache (blur::set_shader_cache_path()),
+	// compiling and writing back to the cache only when both miss. Every load is counted in blur::get_setup_report().
+	class ShaderLibrary {
+	public:
+		ShaderLibrary(ShaderCompiler* compiler, const PrecompiledShader* precompiled, int precompiled_count);
+
+		bool load(const ShaderSource& shader, ImVector<unsigned char>& bytecode);
+
+	private:
+		ShaderCompiler* compiler;
+		const PrecompiledShader* precompiled;
+		int precompiled_count;
+	};
+
+	// Bracket a setup() call, resets blur::get_setup_report() and records how long setup took.
+	void begin_setup_report();
+	void end_setup_report();
+
+	// Where the adaptive controller gets the blur time of a frame. The default reads blur::get_stats().
+	class FrameTimer {
+	public:
+		virtual ~FrameTimer() {}
+
+		// The latest frame with a measured blur time, false when there is none yet.
+		virtual bool measure(int& frame, float& ms) = 0;
+	};
+
+	// Replaces the adaptive controller's timer, e.g. with a fake one in tests. nullptr restores the default.
+	void set_adaptive_timer(FrameTimer* timer);
+
+	class AdaptiveSetting {
+	public:
+		float scale = 1.0f;
+		int iterations = 1;
+		float offset = 1.0f;
+		float cost = 0.0f; // relative, see adaptive_cost()
+	};
+
+	// Walks a ladder of settings from full to quarter scale, see blur::process(ImDrawList*, const AdaptiveParameters&).
+	class AdaptiveController {
+	public:
+		static const int max_steps = 5;
+
+		// Fills 'ladder' with the settings for 'radius', best first, and returns how many there are.
+		static int build_ladder(float radius, AdaptiveSetting* ladder);
+
+		// Moves at most once per frame, with the first call's parameters.
+		void update(int frame, const AdaptiveParameters& parameters, FrameTimer& timer);
+		AdaptiveSetting setting(float radius) const;
+
+		int step = 0;
+
+	private:
+		int updated_frame = -1;
+		int changed_frame = -1;   // measurements of earlier frames predate the current step
+		int measured_frame = -1;
+		int over_budget = 0;      // measurements in a row
+		int under_budget = 0;
+		int climb_wait = 30;      // measurements under budget before stepping up
+		bool climbed = false;     // the last change was a step up
+		static const int max_climb_wait = 30 * 32;
+	};
+
+	// Format of pyramid level 'level' for a frame captured as 'source', one 'backend' supports.
+	Format level_format(Backend* backend, const BlurParameters& parameters, Format source, int level);
+
+	// Pixels of 'output' sampled by parameters.regions, or all of it when there are none.
+	RegionSet output_regions(const BlurParameters& parameters, const Framebuffer& output);
+	// Adds the display space rectangles of 'node' and the ones linked after it to 'regions', in pixels of 'output'.
+	void add_region_nodes(RegionSet& regions, const RegionNode* node, const Framebuffer& output);
+
+	// Downsamples 'source' into chain.levels[0..iterations] and upsamples back into level 0, and into chain.output when
+	// parameters.output_requested is set. Separable algorithms blur 'source' into level 0 in two passes instead. With
+	// parameters.levels_requested the upsamples go through chain.scratch and levels 1..iterations keep the downsampled
+	// frame for render() radii.
+	// The levels are resized from 'pool' whenever their layout no longer matches the parameters, chain.graph is only
+	// recompiled when the layout or the regions change.
+	// Each pass is limited to the pixels that end up sampled by output_regions().
+	// 'reusable' means the output already holds this blur for an older frame; returns false when that result was kept.
+	// 'damage', in pixels of the output, is everything that changed in the source since then: when the levels and the
+	// pass graph are the ones that result was computed with, each pass only recomputes the tiles of its target that
+	// read its input's damage, everything else keeps the older frame's texels.
+	// With 'timing' every pass is followed by a timestamp.
+	bool run_chain(Backend* backend, FramebufferPool& pool, const BlurParameters& parameters, const Framebuffer& source, Chain& chain, bool reusable, const RegionSet* damage = nullptr, ChainTiming* timing = nullptr);
+
+	bool set_backend(Backend* backend);
+	Backend* get_backend();
+	// Swaps the active backend without destroying anything, for tools that wrap it (see tools/benchmark.cpp).
+	// destroy() deletes whatever is active at that point.
+	Backend* exchange_backend(Backend* backend);
+}
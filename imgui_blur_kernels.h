@@ -0,0 +1,161 @@
+#pragma once
+
+// Kernel tables of the separable blurs, evaluated at compile time and shared by the core (cost model, pass regions)
+// and every backend: the D3D11 and OpenGL backends upload them as shader constants, the CPU backend runs them as
+// fixed point taps. Nothing in here is part of the public API.
+
+namespace blur {
+	// Standard deviations of the gaussian family, in texels of the level they blur.
+	static constexpr float gaussian_sigma_step = 0.5f;
+	static constexpr int gaussian_kernel_count = 16;
+	static constexpr float max_gaussian_sigma = gaussian_sigma_step * gaussian_kernel_count;
+	// Taps of one side including the center, enough for max_gaussian_sigma.
+	static constexpr int max_gaussian_taps = 13;
+	// GaussianKernel::fixed_weights of both sides add up to this. The CPU row kernels multiply 8 bit texels by
+	// 256 * weight in 16 bit lanes, so no single weight may reach 128.
+	static constexpr int gaussian_fixed_total = 128;
+
+	// One side of a gaussian truncated at three standard deviations, with every two neighbouring texels merged into a
+	// single bilinear tap between them: tap 0 is the center texel, tap i stands for texels 2i - 1 and 2i and is
+	// mirrored to the other side, so 2 * tap_count - 1 taps cover 2 * reach + 1 texels.
+	class GaussianKernel {
+	public:
+		float sigma = 0.0f;
+		int reach = 0;     // furthest texel with a weight
+		int tap_count = 0;
+		float offsets[max_gaussian_taps] = {};     // texels from the center
+		float weights[max_gaussian_taps] = {};     // the center's once, every other tap's for each side
+		int fixed_weights[max_gaussian_taps] = {}; // 'weights' in 1 / gaussian_fixed_total, rounded
+	};
+
+	// exp() for constant expressions: a Taylor series on x / 256, squared back up. Exact to a few ulps for the
+	// arguments below, which never go past -10.
+	constexpr double constexpr_exp(double x) {
+		const double y = x / 256.0;
+		double term = 1.0, sum = 1.0;
+		for (int i = 1; i < 12; ++i) {
+			term *= y / i;
+			sum += term;
+		}
+		for (int i = 0; i < 8; ++i)
+			sum *= sum;
+		return sum;
+	}
+
+	constexpr double constexpr_sqrt(double x) {
+		double root = x > 1.0 ? x : 1.0;
+		for (int i = 0; i < 64; ++i)
+			root = (root + x / root) * 0.5;
+		return root;
+	}
+
+	constexpr GaussianKernel make_gaussian_kernel(float sigma) {
+		GaussianKernel kernel{};
+		kernel.sigma = sigma;
+		kernel.reach = (int)(sigma * 3.0f + 0.999f);
+
+		double texels[max_gaussian_taps * 2] = {};
+		double sum = 0.0;
+		for (int d = 0; d <= kernel.reach; ++d) {
+			texels[d] = constexpr_exp(-(double)d * d / (2.0 * sigma * sigma));
+			sum += d == 0 ? texels[d] : texels[d] * 2.0;
+		}
+
+		// A bilinear tap at the weighted center of two texels reads both with exactly their weights.
+		kernel.tap_count = 1 + (kernel.reach + 1) / 2;
+		kernel.weights[0] = (float)(texels[0] / sum);
+		for (int i = 1; i < kernel.tap_count; ++i) {
+			const double a = texels[2 * i - 1], b = texels[2 * i];
+			kernel.weights[i] = (float)((a + b) / sum);
+			kernel.offsets[i] = (float)((a * (2 * i - 1) + b * (2 * i)) / (a + b));
+		}
+
+		// The center is rounded to leave an even remainder, which is split over the sides by rounding their running sum:
+		// every tap stays within one step of its weight and the fixed point kernel keeps the brightness exactly.
+		const double center = texels[0] / sum * gaussian_fixed_total;
+		int center_weight = (int)(center + 0.5);
+		if ((gaussian_fixed_total - center_weight) % 2 != 0)
+			center_weight += center_weight < center ? 1 : -1;
+		kernel.fixed_weights[0] = center_weight;
+
+		const int side_total = (gaussian_fixed_total - center_weight) / 2;
+		const double side_scale = side_total / ((sum - texels[0]) * 0.5);
+		double running = 0.0;
+		int assigned = 0;
+		for (int i = 1; i < kernel.tap_count; ++i) {
+			running += (texels[2 * i - 1] + texels[2 * i]) * side_scale;
+			const int rounded = i + 1 < kernel.tap_count ? (int)(running + 0.5) : side_total;
+			kernel.fixed_weights[i] = rounded - assigned;
+			assigned = rounded;
+		}
+		return kernel;
+	}
+
+	class GaussianFamily {
+	public:
+		GaussianKernel kernels[gaussian_kernel_count];
+	};
+
+	constexpr GaussianFamily make_gaussian_family() {
+		GaussianFamily family{};
+		for (int i = 0; i < gaussian_kernel_count; ++i)
+			family.kernels[i] = make_gaussian_kernel(gaussian_sigma_step * (i + 1));
+		return family;
+	}
+
+	static constexpr GaussianFamily gaussian_family = make_gaussian_family();
+
+	constexpr bool gaussian_family_is_valid() {
+		for (const GaussianKernel& kernel : gaussian_family.kernels) {
+			if (kernel.tap_count > max_gaussian_taps || kernel.fixed_weights[0] < 0 || kernel.fixed_weights[0] >= gaussian_fixed_total)
+				return false;
+			double sum = kernel.weights[0];
+			int fixed_sum = kernel.fixed_weights[0];
+			for (int i = 1; i < kernel.tap_count; ++i) {
+				sum += kernel.weights[i] * 2.0;
+				fixed_sum += kernel.fixed_weights[i] * 2;
+				if (kernel.fixed_weights[i] < 0)
+					return false;
+			}
+			if (sum < 0.99999 || sum > 1.00001 || fixed_sum != gaussian_fixed_total)
+				return false;
+		}
+		return true;
+	}
+
+	static_assert(gaussian_family_is_valid(), "gaussian kernels must fit their tables and keep the brightness");
+
+	// Family member closest to 'sigma'.
+	constexpr int gaussian_kernel_index(float sigma) {
+		const int index = (int)(sigma / gaussian_sigma_step + 0.5f) - 1;
+		return index < 0 ? 0 : index < gaussian_kernel_count ? index : gaussian_kernel_count - 1;
+	}
+
+	constexpr const GaussianKernel& gaussian_kernel(float sigma) {
+		return gaussian_family.kernels[gaussian_kernel_index(sigma)];
+	}
+
+	// Three box blurs in a row whose variances add up to sigma², all odd so they stay centered: the first 'narrow'
+	// are widths[0] texels wide, the rest two more (Kovesi, "Fast almost-gaussian filtering").
+	class BoxKernel {
+	public:
+		int widths[3] = {};
+		int reach = 0; // furthest texel with a weight, the sum of the half widths
+	};
+
+	constexpr BoxKernel make_box_kernel(float sigma) {
+		const double variance = (double)sigma * sigma;
+		int narrow_width = (int)constexpr_sqrt(4.0 * variance + 1.0);
+		narrow_width -= narrow_width % 2 == 0 ? 1 : 0;
+		const double narrow = (12.0 * variance - 3.0 * narrow_width * narrow_width - 12.0 * narrow_width - 9.0) / (-4.0 * narrow_width - 4.0);
+
+		BoxKernel kernel{};
+		for (int i = 0; i < 3; ++i) {
+			kernel.widths[i] = i < (int)(narrow + 0.5) ? narrow_width : narrow_width + 2;
+			kernel.reach += kernel.widths[i] / 2;
+		}
+		return kernel;
+	}
+
+	static_assert(make_box_kernel(0.5f).widths[0] == 1 && make_box_kernel(8.0f).reach == 22, "box widths must follow the variance");
+}
@@ -0,0 +1,828 @@
+#include "imgui_blur.h"
+#include "imgui_blur_internal.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// Any loader exposing OpenGL 3.3 core (glad, GLEW, gl3w, libepoxy) works, point IMGUI_BLUR_GL_HEADER at it.
+// By default the core prototypes are linked directly, which is what Mesa's libGL/libOpenGL provide.
+#ifdef IMGUI_BLUR_GL_HEADER
+#include IMGUI_BLUR_GL_HEADER
+#else
+#define GL_GLEXT_PROTOTYPES
+#include <GL/glcorearb.h>
+#endif
+
+// Same math as the HLSL in imgui_blur_dx11_shaders.h. Levels are stored top row first like the D3D11 textures,
+// so gl_FragCoord, scissor rectangles and ImGui uvs all address the same texels as on D3D11.
+static const char* g_vertex_src = R"(
+void main() {
+    // One triangle covering the viewport, no vertex buffer.
+    vec2 pos = vec2(gl_VertexID == 1 ? 3.0 : -1.0, gl_VertexID == 2 ? 3.0 : -1.0);
+    gl_Position = vec4(pos, 0.0, 1.0);
+}
+)";
+
+static const char* g_fragment_common_src = R"(
+uniform sampler2D input_texture;
+uniform vec2 half_pixel;
+uniform float offset;
+uniform float noise;
+uniform vec2 input_scale;      // area in use / texture size
+uniform vec2 input_half_texel; // in uv of the area in use
+
+out vec4 out_color;
+
+// Pooled inputs only fill the top left of their texture: mirror at the edges of the area in use
+// and keep the bilinear footprint inside it, which matches a mirror sampler on an exact fit texture.
+vec4 sample_texture(sampler2D tex, vec2 uv, vec2 scale, vec2 half_texel) {
+    uv = 1.0 - abs(1.0 - abs(uv));
+    uv = clamp(uv, half_texel, 1.0 - half_texel);
+    return texture(tex, uv * scale);
+}
+
+vec4 sample_input(vec2 uv) {
+    return sample_texture(input_texture, uv, input_scale, input_half_texel);
+}
+
+vec4 add_noise(vec4 result, vec2 pos) {
+    if (noise > 0.0) {
+        result.rgb += ((fract(sin(dot(pos, vec2(12.9898, 78.233))) * 43758.5453)
+                      + fract(sin(dot(pos * 0.1, vec2(7.898, 4.233))) * 23421.631)) * 0.5 - 0.5)
+                      * noise * 0.3;
+    }
+    return result;
+}
+
+vec4 upsample_texture(sampler2D tex, vec2 uv, vec2 spread, vec2 scale, vec2 half_texel) {
+    vec4 sum = sample_texture(tex, uv + vec2(-spread.x * 2.0, 0.0) * offset, scale, half_texel);
+    sum += sample_texture(tex, uv + vec2(-spread.x, spread.y) * offset, scale, half_texel) * 2.0;
+    sum += sample_texture(tex, uv + vec2(0.0, spread.y * 2.0) * offset, scale, half_texel);
+    sum += sample_texture(tex, uv + vec2(spread.x, spread.y) * offset, scale, half_texel) * 2.0;
+    sum += sample_texture(tex, uv + vec2(spread.x * 2.0, 0.0) * offset, scale, half_texel);
+    sum += sample_texture(tex, uv + vec2(spread.x, -spread.y) * offset, scale, half_texel) * 2.0;
+    sum += sample_texture(tex, uv + vec2(0.0, -spread.y * 2.0) * offset, scale, half_texel);
+    sum += sample_texture(tex, uv + vec2(-spread.x, -spread.y) * offset, scale, half_texel) * 2.0;
+    return sum / 12.0;
+}
+
+vec4 upsample(vec2 uv, vec2 pos) {
+    return add_noise(upsample_texture(input_texture, uv, half_pixel, input_scale, input_half_texel), pos);
+}
+)";
+
+static const char* g_downsample_src = R"(
+void main() {
+    vec2 uv = gl_FragCoord.xy * half_pixel * 2.0;
+    vec4 sum = sample_input(uv) * 4.0;
+    sum += sample_input(uv - half_pixel * offset);
+    sum += sample_input(uv + half_pixel * offset);
+    sum += sample_input(uv + vec2(half_pixel.x, -half_pixel.y) * offset);
+    sum += sample_input(uv - vec2(half_pixel.x, -half_pixel.y) * offset);
+    out_color = add_noise(sum / 8.0, gl_FragCoord.xy);
+}
+)";
+
+static const char* g_upsample_src = R"(
+void main() {
+    out_color = upsample(gl_FragCoord.xy * half_pixel * 2.0, gl_FragCoord.xy);
+}
+)";
+
+// One axis of a separable gaussian at the size of its input, see imgui_blur_kernels.h. update_gaussian_uniforms()
+// uploads the taps of a member of blur::gaussian_family.
+static const char* g_gaussian_src = R"(
+#define MAX_TAPS 13
+uniform vec2 taps[MAX_TAPS]; // texels from the center, weight
+uniform int tap_count;
+uniform vec2 spacing;        // one input texel along the blurred axis, in uv
+
+void main() {
+    vec2 uv = gl_FragCoord.xy * half_pixel * 2.0;
+    vec4 result = sample_input(uv) * taps[0].y;
+    // A constant bound lets the compiler unroll the loop, a uniform one costs llvmpipe twice the time.
+    for (int i = 1; i < MAX_TAPS; ++i) {
+        if (i >= tap_count)
+            break;
+        result += sample_input(uv - spacing * taps[i].x) * taps[i].y;
+        result += sample_input(uv + spacing * taps[i].x) * taps[i].y;
+    }
+    out_color = add_noise(result, gl_FragCoord.xy);
+}
+)";
+
+// Final upsample drawn by blur::render() from a level, fed by ImGui's vertex buffer. ImGui renders bottom row first
+// into its framebuffer, so the pixel position is flipped back to the top row first layout of the levels. For render()
+// radii a second level is mixed in by 'blend'.
+static const char* g_render_vertex_src = R"(
+uniform mat4 projection;
+in vec2 Position;
+in vec2 UV;
+in vec4 Color;
+out vec4 frag_color;
+
+void main() {
+    frag_color = Color;
+    gl_Position = projection * vec4(Position, 0.0, 1.0);
+}
+)";
+
+static const char* g_render_upsample_src = R"(
+uniform float framebuffer_height;
+uniform float opacity;
+uniform vec2 spacing; // tap distance on input_texture, in uv
+uniform float blend;
+uniform sampler2D blend_texture;
+uniform vec2 blend_scale;
+uniform vec2 blend_half_texel;
+uniform vec2 blend_spacing;
+in vec4 frag_color;
+
+void main() {
+    vec2 pos = vec2(gl_FragCoord.x, framebuffer_height - gl_FragCoord.y);
+    vec2 uv = pos * half_pixel * 2.0;
+    vec4 result = upsample_texture(input_texture, uv, spacing, input_scale, input_half_texel);
+    if (blend > 0.0)
+        result = mix(result, upsample_texture(blend_texture, uv, blend_spacing, blend_scale, blend_half_texel), blend);
+    result = add_noise(result, pos) * frag_color;
+    out_color = vec4(result.rgb, result.a * opacity);
+}
+)";
+
+class GlFramebuffer {
+public:
+    void destroy() {
+        if (fbo != 0) { glDeleteFramebuffers(1, &fbo); fbo = 0; }
+        if (texture != 0) { glDeleteTextures(1, &texture); texture = 0; }
+    }
+
+    GLuint texture = 0;
+    GLuint fbo = 0;
+};
+
+// Uniforms of a downsample or upsample pass.
+class GlPassUniforms {
+public:
+    float half_pixel[2];
+    float offset;
+    float noise;
+    float input_scale[2];
+    float input_half_texel[2];
+};
+
+class GlProgram {
+public:
+    GLuint program = 0;
+    GLint half_pixel = -1;
+    GLint offset = -1;
+    GLint noise = -1;
+    GLint input_scale = -1;
+    GLint input_half_texel = -1;
+    GLint projection = -1;         // render upsample only
+    GLint framebuffer_height = -1; // render upsample only
+    GLint opacity = -1;            // render upsample only
+    GLint spacing = -1;            // render upsample and gaussian only
+    GLint blend = -1;              // render upsample only
+    GLint blend_scale = -1;        // render upsample only
+    GLint blend_half_texel = -1;   // render upsample only
+    GLint blend_spacing = -1;      // render upsample only
+    GLint taps = -1;               // gaussian only
+    GLint tap_count = -1;          // gaussian only
+
+    // What the program's uniforms hold, they keep their values between passes and frames.
+    GlPassUniforms uniforms{};
+    bool uniforms_valid = false;
+    int kernel_index = -1; // member of blur::gaussian_family in 'taps'
+    float kernel_spacing[2] = {};
+};
+
+// Timestamp queries of one chain, see Gl3Backend::begin_timing().
+class GlTimingSet {
+public:
+    GLuint start = 0;
+    GLuint timestamps[blur::max_timestamps] = {};
+    int count = 0;
+    ImU32 id = 0;
+    bool pending = false; // ended and not read back yet
+};
+
+static char g_glsl_version[32] = "#version 330 core\n";
+static GlProgram g_downsample{};
+static GlProgram g_upsample{};
+static GlProgram g_render_upsample{};
+static GlProgram g_gaussian{};
+static GLint g_render_attributes[3] = { 0, 1, 2 }; // Position, UV, Color as bound in g_render_upsample
+static GLint g_imgui_program = 0;
+static GLint g_imgui_projection = -1;
+static GLuint g_vertex_array = 0;
+static GLuint g_mirror_sampler = 0;
+static bool g_format_supported[blur::Format_COUNT] = {}; // renderable, probed by setup_opengl3()
+
+// Used in order: sets are opened at g_timing_next and read back at g_timing_read. Empty on OpenGL ES, which only has
+// timestamps through EXT_disjoint_timer_query.
+static GlTimingSet g_timing_sets[IMGUI_BLUR_TIMER_QUERY_SETS];
+static bool g_has_timer_queries = false;
+static ImU32 g_timing_next = 0;
+static ImU32 g_timing_read = 0;
+
+static bool is_es() {
+    return strstr(g_glsl_version, " es") != nullptr;
+}
+
+static void gl_format(blur::Format format, GLenum& internal_format, GLenum& pixel_format, GLenum& type) {
+    pixel_format = GL_RGBA;
+    type = GL_UNSIGNED_BYTE;
+    switch (format) {
+    case blur::Format_RGBA8_SRGB: internal_format = GL_SRGB8_ALPHA8; break;
+    case blur::Format_RGB10A2: internal_format = GL_RGB10_A2; type = GL_UNSIGNED_INT_2_10_10_10_REV; break;
+    case blur::Format_R11G11B10F: internal_format = GL_R11F_G11F_B10F; pixel_format = GL_RGB; type = GL_FLOAT; break;
+    case blur::Format_RGBA16F: internal_format = GL_RGBA16F; type = GL_FLOAT; break;
+    case blur::Format_RGB565: internal_format = GL_RGB565; pixel_format = GL_RGB; type = GL_UNSIGNED_SHORT_5_6_5; break;
+    default: internal_format = GL_RGBA8; break;
+    }
+}
+
+// Leaves the new texture and framebuffer unbound, this also runs outside the draw callback.
+static bool create_framebuffer(GlFramebuffer& framebuffer, int width, int height, blur::Format format) {
+    GLenum internal_format, pixel_format, type;
+    gl_format(format, internal_format, pixel_format, type);
+
+    GLint old_texture = 0, old_framebuffer = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &old_texture);
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &old_framebuffer);
+
+    glGenTextures(1, &framebuffer.texture);
+    glBindTexture(GL_TEXTURE_2D, framebuffer.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, internal_format, width, height, 0, pixel_format, type, nullptr);
+
+    glGenFramebuffers(1, &framebuffer.fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer.fbo);
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, framebuffer.texture, 0);
+    const bool complete = glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+    glBindTexture(GL_TEXTURE_2D, old_texture);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, old_framebuffer);
+    return glGetError() == GL_NO_ERROR && complete;
+}
+
+static GLuint compile_shader(GLenum type, const char* const* sources, int count) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, count, sources, nullptr);
+    glCompileShader(shader);
+
+    GLint status = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (status == GL_FALSE) {
+        char log[1024];
+        glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+        // LOG_ERROR("Failed to compile blur shader: {}", log);
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+// 'attributes' binds Position, UV and Color for vertex shaders that read ImGui's vertices.
+static bool create_program(const char* vertex_src, const char* fragment_src, GlProgram& out_program, GLint texture_unit, const GLint* attributes) {
+    const bool es = is_es();
+    const char* vertex_sources[] = { g_glsl_version, vertex_src };
+    const char* fragment_sources[] = { g_glsl_version, es ? "precision highp float;\n" : "", g_fragment_common_src, fragment_src };
+
+    GLuint vertex = compile_shader(GL_VERTEX_SHADER, vertex_sources, IM_ARRAYSIZE(vertex_sources));
+    GLuint fragment = compile_shader(GL_FRAGMENT_SHADER, fragment_sources, IM_ARRAYSIZE(fragment_sources));
+    if (vertex == 0 || fragment == 0) {
+        if (vertex != 0) glDeleteShader(vertex);
+        if (fragment != 0) glDeleteShader(fragment);
+        return false;
+    }
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertex);
+    glAttachShader(program, fragment);
+    if (attributes != nullptr) {
+        glBindAttribLocation(program, attributes[0], "Position");
+        glBindAttribLocation(program, attributes[1], "UV");
+        glBindAttribLocation(program, attributes[2], "Color");
+    }
+    glLinkProgram(program);
+    glDetachShader(program, vertex);
+    glDetachShader(program, fragment);
+    glDeleteShader(vertex);
+    glDeleteShader(fragment);
+
+    GLint status = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status == GL_FALSE) {
+        // LOG_ERROR("Failed to link blur program");
+        glDeleteProgram(program);
+        return false;
+    }
+
+    out_program.program = program;
+    out_program.half_pixel = glGetUniformLocation(program, "half_pixel");
+    out_program.offset = glGetUniformLocation(program, "offset");
+    out_program.noise = glGetUniformLocation(program, "noise");
+    out_program.input_scale = glGetUniformLocation(program, "input_scale");
+    out_program.input_half_texel = glGetUniformLocation(program, "input_half_texel");
+    out_program.projection = glGetUniformLocation(program, "projection");
+    out_program.framebuffer_height = glGetUniformLocation(program, "framebuffer_height");
+    out_program.opacity = glGetUniformLocation(program, "opacity");
+    out_program.spacing = glGetUniformLocation(program, "spacing");
+    out_program.blend = glGetUniformLocation(program, "blend");
+    out_program.blend_scale = glGetUniformLocation(program, "blend_scale");
+    out_program.blend_half_texel = glGetUniformLocation(program, "blend_half_texel");
+    out_program.blend_spacing = glGetUniformLocation(program, "blend_spacing");
+    out_program.taps = glGetUniformLocation(program, "taps");
+    out_program.tap_count = glGetUniformLocation(program, "tap_count");
+
+    GLint old_program = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &old_program);
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "input_texture"), texture_unit);
+    glUniform1i(glGetUniformLocation(program, "blend_texture"), texture_unit + 1);
+    glUseProgram(old_program);
+    return true;
+}
+
+// Uploads the uniforms that differ from what the current program already holds.
+static void update_uniforms(GlProgram& program, const GlPassUniforms& uniforms) {
+    const GlPassUniforms& last = program.uniforms;
+    const bool all = !program.uniforms_valid;
+    bool updated = false;
+    if (all || memcmp(last.half_pixel, uniforms.half_pixel, sizeof(uniforms.half_pixel)) != 0) {
+        glUniform2fv(program.half_pixel, 1, uniforms.half_pixel);
+        updated = true;
+    }
+    if (all || last.offset != uniforms.offset) {
+        glUniform1f(program.offset, uniforms.offset);
+        updated = true;
+    }
+    if (all || last.noise != uniforms.noise) {
+        glUniform1f(program.noise, uniforms.noise);
+        updated = true;
+    }
+    if (all || memcmp(last.input_scale, uniforms.input_scale, sizeof(uniforms.input_scale)) != 0) {
+        glUniform2fv(program.input_scale, 1, uniforms.input_scale);
+        updated = true;
+    }
+    if (all || memcmp(last.input_half_texel, uniforms.input_half_texel, sizeof(uniforms.input_half_texel)) != 0) {
+        glUniform2fv(program.input_half_texel, 1, uniforms.input_half_texel);
+        updated = true;
+    }
+    program.uniforms = uniforms;
+    program.uniforms_valid = true;
+    if (updated)
+        blur::count(blur::Counter_ConstantUpdates);
+}
+
+// Only uploads the taps when the kernel changes, which with a fixed radius is once.
+static void update_gaussian_uniforms(GlProgram& program, int kernel_index, const float spacing[2]) {
+    if (program.kernel_index != kernel_index) {
+        const blur::GaussianKernel& kernel = blur::gaussian_family.kernels[kernel_index];
+        float taps[blur::max_gaussian_taps][2];
+        for (int i = 0; i < kernel.tap_count; ++i) {
+            taps[i][0] = kernel.offsets[i];
+            taps[i][1] = kernel.weights[i];
+        }
+        glUniform2fv(program.taps, kernel.tap_count, &taps[0][0]);
+        glUniform1i(program.tap_count, kernel.tap_count);
+        program.kernel_index = kernel_index;
+        blur::count(blur::Counter_ConstantUpdates);
+    }
+    if (memcmp(program.kernel_spacing, spacing, sizeof(program.kernel_spacing)) != 0) {
+        glUniform2fv(program.spacing, 1, spacing);
+        memcpy(program.kernel_spacing, spacing, sizeof(program.kernel_spacing));
+        blur::count(blur::Counter_ConstantUpdates);
+    }
+}
+
+static void destroy_device_objects() {
+    if (g_downsample.program) { glDeleteProgram(g_downsample.program); g_downsample = GlProgram{}; }
+    if (g_upsample.program) { glDeleteProgram(g_upsample.program); g_upsample = GlProgram{}; }
+    if (g_render_upsample.program) { glDeleteProgram(g_render_upsample.program); g_render_upsample = GlProgram{}; }
+    if (g_gaussian.program) { glDeleteProgram(g_gaussian.program); g_gaussian = GlProgram{}; }
+    g_imgui_program = 0;
+    g_imgui_projection = -1;
+    if (g_vertex_array) { glDeleteVertexArrays(1, &g_vertex_array); g_vertex_array = 0; }
+    if (g_mirror_sampler) { glDeleteSamplers(1, &g_mirror_sampler); g_mirror_sampler = 0; }
+    if (g_has_timer_queries) {
+        for (GlTimingSet& set : g_timing_sets) {
+            glDeleteQueries(1, &set.start);
+            glDeleteQueries(blur::max_timestamps, set.timestamps);
+            set = GlTimingSet{};
+        }
+    }
+    g_has_timer_queries = false;
+    g_timing_next = g_timing_read = 0;
+}
+
+class Gl3Backend : public blur::Backend {
+public:
+    bool create_framebuffer(blur::Framebuffer& framebuffer, int width, int height, blur::Format format) override {
+        GlFramebuffer* gl_framebuffer = IM_NEW(GlFramebuffer);
+        framebuffer.handle = gl_framebuffer;
+        framebuffer.width = width;
+        framebuffer.height = height;
+        return ::create_framebuffer(*gl_framebuffer, width, height, format);
+    }
+
+    bool supports_format(blur::Format format) override {
+        return g_format_supported[format];
+    }
+
+    void destroy_framebuffer(blur::Framebuffer& framebuffer) override {
+        GlFramebuffer* gl_framebuffer = (GlFramebuffer*)framebuffer.handle;
+        if (gl_framebuffer != nullptr) {
+            gl_framebuffer->destroy();
+            IM_DELETE(gl_framebuffer);
+        }
+        framebuffer = blur::Framebuffer{};
+    }
+
+    ImTextureID get_texture_id(const blur::Framebuffer& framebuffer) override {
+        return (ImTextureID)(intptr_t)((GlFramebuffer*)framebuffer.handle)->texture;
+    }
+
+    // imgui_impl_opengl3 sets the viewport to the framebuffer it renders into, which is what gets captured.
+    // The copy is flipped so the source is top row first like every level.
+    bool begin_chain(blur::Framebuffer& source) override {
+        glGetIntegerv(GL_VIEWPORT, old_viewport);
+        const int width = old_viewport[2];
+        const int height = old_viewport[3];
+        if (width <= 0 || height <= 0)
+            return false;
+
+        // Only what imgui_impl_opengl3 does not set up again is put back in end_chain(), the rest is left to the
+        // ImDrawCallback_ResetRenderState that process() queues right after the chain.
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &old_draw_framebuffer);
+        glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &old_read_framebuffer);
+        glGetIntegerv(GL_ACTIVE_TEXTURE, &old_active_texture);
+        glActiveTexture(GL_TEXTURE0);
+        old_framebuffer_srgb = !is_es() && glIsEnabled(GL_FRAMEBUFFER_SRGB);
+
+        // The copy keeps the framebuffer's format, so the blits below never convert.
+        const blur::Format format = framebuffer_format();
+        if (!ensure_size(screen, screen_width, screen_height, screen_format, width, height, format)) {
+            end_chain();
+            return false;
+        }
+
+        // Multisampled framebuffers are resolved first, a resolve cannot flip.
+        GLint sample_buffers = 0;
+        glGetIntegerv(GL_SAMPLE_BUFFERS, &sample_buffers);
+        GLuint read_framebuffer = (GLuint)old_draw_framebuffer;
+        if (sample_buffers > 0) {
+            if (!ensure_size(resolve, resolve_width, resolve_height, resolve_format, width, height, format)) {
+                end_chain();
+                return false;
+            }
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, read_framebuffer);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, resolve.fbo);
+            glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            read_framebuffer = resolve.fbo;
+        }
+
+        glDisable(GL_SCISSOR_TEST);
+        if (old_framebuffer_srgb)
+            glDisable(GL_FRAMEBUFFER_SRGB);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, read_framebuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, screen.fbo);
+        glBlitFramebuffer(0, 0, width, height, 0, height, width, 0, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+        source.handle = &screen;
+        source.width = source.texture_width = width;
+        source.height = source.texture_height = height;
+        source.format = format;
+
+        // sRGB levels hold linear colors encoded on write, which desktop GL only does while this is enabled.
+        if (format == blur::Format_RGBA8_SRGB && !is_es())
+            glEnable(GL_FRAMEBUFFER_SRGB);
+
+        // State every pass of the chain shares is set once here, render_pass() only changes what differs.
+        glDisable(GL_BLEND);
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_STENCIL_TEST);
+        glDisable(GL_CULL_FACE);
+        glEnable(GL_SCISSOR_TEST);
+        glBindVertexArray(g_vertex_array);
+        glBindSampler(0, g_mirror_sampler);
+        bound_program = 0;
+        bound_width = bound_height = 0;
+        return true;
+    }
+
+    void render_pass(const blur::Framebuffer& target, const blur::Framebuffer& input, blur::Kernel kernel, float offset, float noise, const blur::RegionSet& regions) override {
+        const GlFramebuffer* framebuffer = (const GlFramebuffer*)target.handle;
+        const bool gaussian = kernel == blur::Kernel_GaussianX || kernel == blur::Kernel_GaussianY;
+        // The box kernels are never scheduled, kernel_costs() leaves them out.
+        if (kernel == blur::Kernel_BoxX || kernel == blur::Kernel_BoxY)
+            return;
+        GlProgram& program = gaussian ? g_gaussian : kernel == blur::Kernel_Downsample ? g_downsample : g_upsample;
+
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer->fbo);
+        if (bound_width != target.width || bound_height != target.height) {
+            glViewport(0, 0, target.width, target.height);
+            bound_width = target.width;
+            bound_height = target.height;
+        }
+        if (bound_program != program.program) {
+            glUseProgram(program.program);
+            bound_program = program.program;
+        }
+
+        GlPassUniforms uniforms;
+        uniforms.half_pixel[0] = 0.5f / target.width;
+        uniforms.half_pixel[1] = 0.5f / target.height;
+        uniforms.offset = offset;
+        uniforms.noise = noise;
+        uniforms.input_scale[0] = (float)input.width / input.texture_width;
+        uniforms.input_scale[1] = (float)input.height / input.texture_height;
+        uniforms.input_half_texel[0] = 0.5f / input.width;
+        uniforms.input_half_texel[1] = 0.5f / input.height;
+        update_uniforms(program, uniforms);
+        if (gaussian) {
+            const float spacing[2] = { kernel == blur::Kernel_GaussianX ? 1.0f / input.width : 0.0f, kernel == blur::Kernel_GaussianY ? 1.0f / input.height : 0.0f };
+            update_gaussian_uniforms(program, blur::gaussian_kernel_index(offset), spacing);
+        }
+        glBindTexture(GL_TEXTURE_2D, ((const GlFramebuffer*)input.handle)->texture);
+
+        // One scissored triangle per region, pixels outside them are never sampled.
+        for (int i = 0; i < regions.count; ++i) {
+            const blur::Rect& region = regions.rects[i];
+            glScissor(region.x0, region.y0, region.x1 - region.x0, region.y1 - region.y0);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+    }
+
+    void end_chain() override {
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, old_draw_framebuffer);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, old_read_framebuffer);
+        glActiveTexture(old_active_texture);
+        if (!is_es()) {
+            if (old_framebuffer_srgb) glEnable(GL_FRAMEBUFFER_SRGB); else glDisable(GL_FRAMEBUFFER_SRGB);
+        }
+    }
+
+    bool can_render_upsample() override {
+        return g_render_upsample.program != 0;
+    }
+
+    // Runs between ImGui's draw commands: its vertex array, blend state and scissor stay as they are. The projection
+    // and attribute locations are taken from ImGui's program, which may only assign them at link time. Uvs come from
+    // the viewport rather than 'output' since imgui_impl_opengl3 renders at the framebuffer scale.
+    void begin_render_upsample(const blur::RenderSource& source, const blur::Framebuffer& output, float offset, float noise) override {
+        GLint imgui_program = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &imgui_program);
+        if (imgui_program == 0)
+            return;
+
+        if (imgui_program != g_imgui_program) {
+            const GLint attributes[3] = {
+                glGetAttribLocation(imgui_program, "Position"),
+                glGetAttribLocation(imgui_program, "UV"),
+                glGetAttribLocation(imgui_program, "Color"),
+            };
+            if (attributes[0] < 0 || attributes[1] < 0 || attributes[2] < 0)
+                return;
+
+            if (memcmp(attributes, g_render_attributes, sizeof(attributes)) != 0) {
+                GlProgram program{};
+                if (!create_program(g_render_vertex_src, g_render_upsample_src, program, 1, attributes))
+                    return;
+                glDeleteProgram(g_render_upsample.program);
+                g_render_upsample = program;
+                memcpy(g_render_attributes, attributes, sizeof(attributes));
+            }
+            g_imgui_program = imgui_program;
+            g_imgui_projection = glGetUniformLocation(imgui_program, "ProjMtx");
+        }
+
+        float projection[16];
+        glGetUniformfv(imgui_program, g_imgui_projection, projection);
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+
+        const blur::Framebuffer* level = source.levels[0];
+        const blur::Framebuffer* blend = source.levels[1];
+        const GlProgram& program = g_render_upsample;
+        glUseProgram(program.program);
+        glUniformMatrix4fv(program.projection, 1, GL_FALSE, projection);
+        glUniform1f(program.framebuffer_height, (float)viewport[3]);
+        glUniform1f(program.opacity, level != nullptr ? source.opacity : 0.0f);
+        glUniform2f(program.half_pixel, 0.5f / viewport[2], 0.5f / viewport[3]);
+        glUniform1f(program.offset, offset);
+        glUniform1f(program.noise, noise);
+        glUniform2f(program.spacing, source.spacing[0].x, source.spacing[0].y);
+        glUniform1f(program.blend, blend != nullptr ? source.blend : 0.0f);
+        if (level != nullptr) {
+            glUniform2f(program.input_scale, (float)level->width / level->texture_width, (float)level->height / level->texture_height);
+            glUniform2f(program.input_half_texel, 0.5f / level->width, 0.5f / level->height);
+        }
+        if (blend != nullptr) {
+            glUniform2f(program.blend_scale, (float)blend->width / blend->texture_width, (float)blend->height / blend->texture_height);
+            glUniform2f(program.blend_half_texel, 0.5f / blend->width, 0.5f / blend->height);
+            glUniform2f(program.blend_spacing, source.spacing[1].x, source.spacing[1].y);
+        }
+        blur::count(blur::Counter_ConstantUpdates);
+
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, level != nullptr ? ((const GlFramebuffer*)level->handle)->texture : 0);
+        glBindSampler(1, g_mirror_sampler);
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, blend != nullptr ? ((const GlFramebuffer*)blend->handle)->texture : 0);
+        glBindSampler(2, g_mirror_sampler);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    void end_render_upsample() override {
+        for (GLenum unit = 1; unit <= 2; ++unit) {
+            glActiveTexture(GL_TEXTURE0 + unit);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            glBindSampler(unit, 0);
+        }
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    bool has_timer_queries() override {
+        return g_has_timer_queries;
+    }
+
+    bool begin_timing(ImU32 id) override {
+        GlTimingSet& set = g_timing_sets[g_timing_next % IMGUI_BLUR_TIMER_QUERY_SETS];
+        if (set.pending)
+            return false;
+
+        set.id = id;
+        set.count = 0;
+        glQueryCounter(set.start, GL_TIMESTAMP);
+        timing_set = &set;
+        return true;
+    }
+
+    void timestamp() override {
+        if (timing_set != nullptr && timing_set->count < blur::max_timestamps)
+            glQueryCounter(timing_set->timestamps[timing_set->count++], GL_TIMESTAMP);
+    }
+
+    void end_timing() override {
+        if (timing_set == nullptr)
+            return;
+
+        timing_set->pending = true;
+        timing_set = nullptr;
+        ++g_timing_next;
+    }
+
+    // Queries complete in order, once the last one is available so are the others.
+    bool read_timing(ImU32& id, float* ms, int& count) override {
+        GlTimingSet& set = g_timing_sets[g_timing_read % IMGUI_BLUR_TIMER_QUERY_SETS];
+        if (!set.pending)
+            return false;
+
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(set.count > 0 ? set.timestamps[set.count - 1] : set.start, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            return false;
+
+        GLuint64 start = 0;
+        glGetQueryObjectui64v(set.start, GL_QUERY_RESULT, &start);
+        for (int i = 0; i < set.count; ++i) {
+            GLuint64 timestamp = 0;
+            glGetQueryObjectui64v(set.timestamps[i], GL_QUERY_RESULT, &timestamp);
+            ms[i] = (float)((double)(timestamp - start) / 1000000.0);
+        }
+
+        id = set.id;
+        count = set.count;
+        set.pending = false;
+        ++g_timing_read;
+        return true;
+    }
+
+    ~Gl3Backend() override {
+        screen.destroy();
+        resolve.destroy();
+        destroy_device_objects();
+    }
+
+private:
+    static bool ensure_size(GlFramebuffer& framebuffer, int& width, int& height, blur::Format& format, int new_width, int new_height, blur::Format new_format) {
+        if (framebuffer.fbo != 0 && width == new_width && height == new_height && format == new_format)
+            return true;
+
+        framebuffer.destroy();
+        width = height = 0;
+        if (!::create_framebuffer(framebuffer, new_width, new_height, new_format)) {
+            framebuffer.destroy();
+            return false;
+        }
+        width = new_width;
+        height = new_height;
+        format = new_format;
+        return true;
+    }
+
+    // What ImGui is drawing into. Its colors only count as sRGB when writes to it are encoded, an sRGB capable
+    // default framebuffer without GL_FRAMEBUFFER_SRGB holds the same values as a linear one.
+    static blur::Format framebuffer_format() {
+        GLint draw_buffer = GL_NONE;
+        glGetIntegerv(GL_DRAW_BUFFER0, &draw_buffer);
+        if (draw_buffer == GL_NONE)
+            return blur::Format_RGBA8;
+
+        // Desktop GL names the left buffers of the default framebuffer.
+        GLenum attachment = (GLenum)draw_buffer;
+        if (!is_es() && attachment == GL_BACK)
+            attachment = GL_BACK_LEFT;
+        else if (!is_es() && attachment == GL_FRONT)
+            attachment = GL_FRONT_LEFT;
+
+        GLint component_type = GL_UNSIGNED_NORMALIZED, encoding = GL_LINEAR, red_size = 8;
+        glGetFramebufferAttachmentParameteriv(GL_DRAW_FRAMEBUFFER, attachment, GL_FRAMEBUFFER_ATTACHMENT_COMPONENT_TYPE, &component_type);
+        glGetFramebufferAttachmentParameteriv(GL_DRAW_FRAMEBUFFER, attachment, GL_FRAMEBUFFER_ATTACHMENT_COLOR_ENCODING, &encoding);
+        glGetFramebufferAttachmentParameteriv(GL_DRAW_FRAMEBUFFER, attachment, GL_FRAMEBUFFER_ATTACHMENT_RED_SIZE, &red_size);
+
+        blur::Format format = blur::Format_RGBA8;
+        if (component_type == GL_FLOAT)
+            format = red_size <= 11 ? blur::Format_R11G11B10F : blur::Format_RGBA16F;
+        else if (encoding == GL_SRGB && (is_es() || glIsEnabled(GL_FRAMEBUFFER_SRGB)))
+            format = blur::Format_RGBA8_SRGB;
+        else if (red_size == 10)
+            format = blur::Format_RGB10A2;
+        return g_format_supported[format] ? format : blur::Format_RGBA8;
+    }
+
+    GlFramebuffer screen{};
+    int screen_width = 0, screen_height = 0;
+    blur::Format screen_format = blur::Format_RGBA8;
+    GlFramebuffer resolve{};
+    int resolve_width = 0, resolve_height = 0;
+    blur::Format resolve_format = blur::Format_RGBA8;
+    GlTimingSet* timing_set = nullptr;
+
+    GLint old_viewport[4] = {};
+    GLint old_draw_framebuffer = 0;
+    GLint old_read_framebuffer = 0;
+    GLint old_active_texture = 0;
+    bool old_framebuffer_srgb = false;
+
+    // What the passes of the current chain left bound, see render_pass().
+    GLuint bound_program = 0;
+    int bound_width = 0, bound_height = 0;
+};
+
+bool blur::setup_opengl3(const char* glsl_version) {
+    destroy();
+    begin_setup_report();
+
+    if (glsl_version != nullptr)
+        snprintf(g_glsl_version, sizeof(g_glsl_version), "%s\n", glsl_version);
+    else
+        snprintf(g_glsl_version, sizeof(g_glsl_version), "#version 330 core\n");
+
+    if (!create_program(g_vertex_src, g_downsample_src, g_downsample, 0, nullptr)
+        || !create_program(g_vertex_src, g_upsample_src, g_upsample, 0, nullptr)
+        || !create_program(g_vertex_src, g_gaussian_src, g_gaussian, 0, nullptr)
+        || !create_program(g_render_vertex_src, g_render_upsample_src, g_render_upsample, 1, g_render_attributes)) {
+        destroy_device_objects();
+        return false;
+    }
+
+    // Core profiles need a bound vertex array even though the triangle comes from gl_VertexID.
+    glGenVertexArrays(1, &g_vertex_array);
+
+    glGenSamplers(1, &g_mirror_sampler);
+    glSamplerParameteri(g_mirror_sampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glSamplerParameteri(g_mirror_sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glSamplerParameteri(g_mirror_sampler, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
+    glSamplerParameteri(g_mirror_sampler, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
+
+    // Levels may only use what can be rendered to here, ES 3.0 needs extensions for the float formats.
+    for (int format = 0; format < blur::Format_COUNT; ++format) {
+        GlFramebuffer probe{};
+        g_format_supported[format] = ::create_framebuffer(probe, 4, 4, (blur::Format)format);
+        probe.destroy();
+    }
+
+    if (!is_es()) {
+        for (GlTimingSet& set : g_timing_sets) {
+            glGenQueries(1, &set.start);
+            glGenQueries(blur::max_timestamps, set.timestamps);
+        }
+        g_has_timer_queries = true;
+    }
+
+    if (glGetError() != GL_NO_ERROR) {
+        // LOG_ERROR("Failed to create blur device objects");
+        destroy_device_objects();
+        return false;
+    }
+
+    end_setup_report();
+    return set_backend(IM_NEW(Gl3Backend));
+}
@@ -0,0 +1,175 @@
+#include "imgui_blur.h"
+#include "imgui_blur_internal.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+
+typedef std::chrono::steady_clock Clock;
+
+static blur::SetupReport g_setup_report{};
+static Clock::time_point g_setup_start{};
+static char g_shader_cache_path[512] = "";
+
+// Cache files are this header followed by the bytecode.
+class ShaderCacheHeader {
+public:
+    ImU32 magic;
+    ImU32 size;
+    ImU64 key;
+    float compile_ms;
+    ImU32 checksum; // of the bytecode, see hash_bytes()
+};
+
+static const ImU32 g_shader_cache_magic = 0x43534249; // "IBSC"
+static const ImU32 g_max_shader_bytes = 16 * 1024 * 1024; // far above any blur shader, bounds what a damaged size allocates
+
+static float elapsed_ms(Clock::time_point start) {
+    return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+}
+
+// FNV-1a, continued from 'hash'.
+static ImU64 hash_string(ImU64 hash, const char* string) {
+    for (; *string; ++string)
+        hash = (hash ^ (unsigned char)*string) * 0x100000001B3ull;
+    return (hash ^ 0xFF) * 0x100000001B3ull; // separates "ab" + "c" from "a" + "bc"
+}
+
+ImU64 blur::shader_key(const ShaderSource& shader, ImU64 compiler_version) {
+    ImU64 hash = 0xCBF29CE484222325ull;
+    hash = hash_string(hash, shader.source);
+    hash = hash_string(hash, shader.entry);
+    hash = hash_string(hash, shader.target);
+    for (int i = 0; i < 8; ++i)
+        hash = (hash ^ ((compiler_version >> (i * 8)) & 0xFF)) * 0x100000001B3ull;
+    return hash;
+}
+
+// FNV-1a folded to 32 bits, so bytecode damaged on disk is compiled again instead of handed to the device.
+static ImU32 hash_bytes(const unsigned char* data, size_t size) {
+    ImU64 hash = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i < size; ++i)
+        hash = (hash ^ data[i]) * 0x100000001B3ull;
+    return (ImU32)(hash ^ (hash >> 32));
+}
+
+static void cache_file_path(char* path, size_t path_size, ImU64 key) {
+    snprintf(path, path_size, "%s/imgui_blur_%016llx.cso", g_shader_cache_path, (unsigned long long)key);
+}
+
+static bool read_cache(ImU64 key, ImVector<unsigned char>& bytecode, float& compile_ms) {
+    char path[600];
+    cache_file_path(path, sizeof(path), key);
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr)
+        return false;
+
+    // The size has to match the file before anything is allocated for it.
+    fseek(file, 0, SEEK_END);
+    const long file_size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    ShaderCacheHeader header;
+    bool valid = fread(&header, sizeof(header), 1, file) == 1
+        && header.magic == g_shader_cache_magic && header.key == key && header.size > 0 && header.size <= g_max_shader_bytes
+        && file_size == (long)(sizeof(header) + header.size);
+    if (valid) {
+        bytecode.resize((int)header.size);
+        valid = fread(bytecode.Data, 1, header.size, file) == header.size
+            && hash_bytes(bytecode.Data, header.size) == header.checksum;
+    }
+
+    fclose(file);
+    compile_ms = valid ? header.compile_ms : 0.0f;
+    return valid;
+}
+
+// Written next to the cache file and renamed over it, so other processes loading the same shader never see half of it.
+// The temporary name carries the clock, two processes writing the same shader do not share one.
+static void write_cache(ImU64 key, const ImVector<unsigned char>& bytecode, float compile_ms) {
+    char path[600], temporary_path[640];
+    cache_file_path(path, sizeof(path), key);
+    snprintf(temporary_path, sizeof(temporary_path), "%s.%llx.tmp", path, (unsigned long long)Clock::now().time_since_epoch().count());
+    FILE* file = fopen(temporary_path, "wb");
+    if (file == nullptr) {
+        // LOG_WARN("cannot write shader cache {}", path);
+        return;
+    }
+
+    const ShaderCacheHeader header = { g_shader_cache_magic, (ImU32)bytecode.Size, key, compile_ms, hash_bytes(bytecode.Data, (size_t)bytecode.Size) };
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+    written = written && fwrite(bytecode.Data, 1, (size_t)bytecode.Size, file) == (size_t)bytecode.Size;
+    written = fclose(file) == 0 && written;
+
+    // rename() does not replace an existing file on Windows.
+    if (written && rename(temporary_path, path) != 0) {
+        remove(path);
+        written = rename(temporary_path, path) == 0;
+    }
+    if (!written) {
+        // LOG_WARN("cannot write shader cache {}", path);
+        remove(temporary_path);
+    }
+}
+
+blur::ShaderLibrary::ShaderLibrary(ShaderCompiler* compiler, const PrecompiledShader* precompiled, int precompiled_count)
+    : compiler(compiler), precompiled(precompiled), precompiled_count(precompiled_count) {
+}
+
+bool blur::ShaderLibrary::load(const ShaderSource& shader, ImVector<unsigned char>& bytecode) {
+    const Clock::time_point start = Clock::now();
+    const ImU64 key = shader_key(shader, compiler->version());
+
+    for (int i = 0; i < precompiled_count; ++i) {
+        const PrecompiledShader& blob = precompiled[i];
+        if (blob.key != key || strcmp(blob.name, shader.name) != 0)
+            continue;
+
+        bytecode.resize((int)blob.size);
+        memcpy(bytecode.Data, blob.bytecode, blob.size);
+        g_setup_report.embedded++;
+        g_setup_report.saved_ms += blob.compile_ms - elapsed_ms(start);
+        return true;
+    }
+
+    float compile_ms = 0.0f;
+    if (g_shader_cache_path[0] != '\0' && read_cache(key, bytecode, compile_ms)) {
+        g_setup_report.cached++;
+        g_setup_report.saved_ms += compile_ms - elapsed_ms(start);
+        return true;
+    }
+
+    if (!compiler->compile(shader, bytecode))
+        return false;
+
+    compile_ms = elapsed_ms(start);
+    g_setup_report.compiled++;
+    g_setup_report.compile_ms += compile_ms;
+    if (g_shader_cache_path[0] != '\0')
+        write_cache(key, bytecode, compile_ms);
+    return true;
+}
+
+void blur::begin_setup_report() {
+    g_setup_report = SetupReport{};
+    g_setup_start = Clock::now();
+}
+
+void blur::end_setup_report() {
+    g_setup_report.setup_ms = elapsed_ms(g_setup_start);
+    // LOG_INFO("blur setup took {:.1f} ms: {} embedded, {} cached, {} compiled shaders, {:.1f} ms saved", ...);
+}
+
+const blur::SetupReport& blur::get_setup_report() {
+    return g_setup_report;
+}
+
+void blur::set_shader_cache_path(const char* directory) {
+    if (directory == nullptr) {
+        g_shader_cache_path[0] = '\0';
+        return;
+    }
+
+    snprintf(g_shader_cache_path, sizeof(g_shader_cache_path), "%s", directory);
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include "imgui.h"
+#include "imgui_blur_internal.h"
+
+#include <stdint.h>
+#include <string.h>
+
+// A blur::Backend that renders nothing and counts what the D3D11 pixel shader backend would call instead: every pass
+// binds its target and draws one scissored quad per region, and the other binds are the ones blur::BoundState asks
+// for, the same code Dx11Backend::render_pass() runs. Constants are created once per distinct set and kept, like the
+// D3D11 constant buffer cache; the gaussian kernel buffers are left out. begin_chain() forgets the bound state, the
+// renderer's ImDrawCallback_ResetRenderState runs in between. The captured format and the formats it supports are
+// settable.
+class RecordingBackend : public blur::Backend {
+public:
+    class Texture {
+    public:
+        int id;
+        int width, height;
+        blur::Format format;
+    };
+
+    class Calls {
+    public:
+        int chains = 0;
+        int passes = 0;
+        int draws = 0;
+        int target_binds = 0;
+        int input_binds = 0;
+        int shader_binds = 0;
+        int viewport_binds = 0;
+        int constant_binds = 0;
+        int constant_updates = 0;
+        int upsample_binds = 0; // begin_render_upsample()
+        int framebuffers_created = 0;
+        int framebuffers_destroyed = 0;
+        int formats_created[blur::Format_COUNT] = {};
+    };
+
+    // One render_pass() call, textures by id with 0 for the captured frame.
+    class RecordedPass {
+    public:
+        int chain; // index into the chains of the frame
+        int target, input;
+        blur::Kernel kernel;
+        int width, height;
+        blur::RegionSet regions;
+    };
+
+    ~RecordingBackend() override {
+        IM_ASSERT(live_textures == 0 && "every framebuffer goes back to the backend before it is destroyed");
+    }
+
+    // Clears the counters and the pass log, call it before the frame that should be recorded.
+    void reset() {
+        calls = Calls{};
+        passes.resize(0);
+        destroyed.resize(0);
+    }
+
+    bool create_framebuffer(blur::Framebuffer& framebuffer, int width, int height, blur::Format format) override {
+        Texture* texture = IM_NEW(Texture);
+        texture->id = ++last_texture_id;
+        texture->width = width;
+        texture->height = height;
+        texture->format = format;
+        framebuffer.handle = texture;
+        framebuffer.width = width;
+        framebuffer.height = height;
+        ++live_textures;
+        ++calls.framebuffers_created;
+        ++calls.formats_created[format];
+        return true;
+    }
+
+    void destroy_framebuffer(blur::Framebuffer& framebuffer) override {
+        Texture* texture = (Texture*)framebuffer.handle;
+        if (texture != nullptr) {
+            destroyed.push_back(texture->id);
+            IM_DELETE(texture);
+            --live_textures;
+            ++calls.framebuffers_destroyed;
+        }
+        framebuffer = blur::Framebuffer{};
+    }
+
+    bool supports_format(blur::Format format) override {
+        return (supported_formats & (1 << format)) != 0;
+    }
+
+    ImTextureID get_texture_id(const blur::Framebuffer& framebuffer) override {
+        return (ImTextureID)(intptr_t)framebuffer.handle;
+    }
+
+    bool begin_chain(blur::Framebuffer& source) override {
+        source.handle = &source_texture;
+        source.width = source.texture_width = source_width;
+        source.height = source.texture_height = source_height;
+        source.format = source_texture.format = source_format;
+        bound.forget();
+        ++calls.chains;
+        return true;
+    }
+
+    void render_pass(const blur::Framebuffer& target, const blur::Framebuffer& input, blur::Kernel kernel, float offset, float noise, const blur::RegionSet& regions) override {
+        const int target_id = ((const Texture*)target.handle)->id;
+        const int input_id = ((const Texture*)input.handle)->id;
+        passes.push_back({ calls.chains - 1, target_id, input_id, kernel, target.width, target.height, regions });
+        ++calls.passes;
+
+        // Shaders and constants by index, both directions of a separable blur share a shader.
+        const int shader = kernel == blur::Kernel_GaussianY ? blur::Kernel_GaussianX : kernel == blur::Kernel_BoxY ? blur::Kernel_BoxX : kernel;
+        const int constants = find_constants(target, input, kernel, offset, noise);
+        const blur::PassBinds binds = bound.bind_pass(target.handle, input.handle, (const void*)(intptr_t)(shader + 1), (const void*)(intptr_t)(constants + 1), nullptr, target.width, target.height);
+        ++calls.target_binds;
+        calls.viewport_binds += binds.viewport ? 1 : 0;
+        calls.shader_binds += binds.shader ? 1 : 0;
+        calls.constant_binds += binds.constants ? 1 : 0;
+        calls.input_binds += binds.input ? 1 : 0;
+
+        calls.draws += regions.count;
+    }
+
+    void end_chain() override {}
+
+    bool can_render_upsample() override { return fuse_upsample; }
+
+    void begin_render_upsample(const blur::RenderSource& source, const blur::Framebuffer& output, float offset, float noise) override {
+        ++calls.upsample_binds;
+    }
+
+    int source_width = 0, source_height = 0; // what begin_chain() captures
+    blur::Format source_format = blur::Format_RGBA8;
+    int supported_formats = 1 << blur::Format_RGBA8; // a bit per blur::Format
+    bool fuse_upsample = false;
+
+    Calls calls;
+    ImVector<RecordedPass> passes;
+    ImVector<int> destroyed; // texture ids in the order they were destroyed
+    int live_textures = 0;
+
+private:
+    // Zero initialized as a whole, compared bytewise like BlurConstants.
+    class PassConstants {
+    public:
+        int target_width, target_height;
+        int input_width, input_height;
+        int input_texture_width, input_texture_height;
+        float offset;
+        float noise;
+        int kernel;
+    };
+
+    int find_constants(const blur::Framebuffer& target, const blur::Framebuffer& input, blur::Kernel kernel, float offset, float noise) {
+        PassConstants constants;
+        memset(&constants, 0, sizeof(constants));
+        constants.target_width = target.width;
+        constants.target_height = target.height;
+        constants.input_width = input.width;
+        constants.input_height = input.height;
+        constants.input_texture_width = input.texture_width;
+        constants.input_texture_height = input.texture_height;
+        constants.offset = offset;
+        constants.noise = noise;
+        constants.kernel = kernel;
+        for (int i = 0; i < constant_cache.Size; ++i) {
+            if (memcmp(&constant_cache[i], &constants, sizeof(constants)) == 0)
+                return i;
+        }
+
+        constant_cache.push_back(constants);
+        ++calls.constant_updates;
+        return constant_cache.Size - 1;
+    }
+
+    Texture source_texture = { 0, 0, 0, blur::Format_RGBA8 };
+    int last_texture_id = 0;
+    blur::BoundState bound;
+    ImVector<PassConstants> constant_cache;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+// Shared by the tests in this directory. Each one is a standalone program, built with the command at the top of its
+// file, that prints every failed check and exits with 1 when there was any.
+
+#include "imgui.h"
+
+#include <stdio.h>
+
+static int g_failures = 0;
+
+static inline bool check(bool condition, const char* expression, const char* file, int line) {
+    if (!condition) {
+        fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+        ++g_failures;
+    }
+    return condition;
+}
+
+#define CHECK(expression) check((expression), #expression, __FILE__, __LINE__)
+
+static inline void create_imgui_context() {
+    ImGui::CreateContext();
+    unsigned char* font_pixels = nullptr;
+    int font_width = 0, font_height = 0;
+    ImGui::GetIO().Fonts->GetTexDataAsRGBA32(&font_pixels, &font_width, &font_height);
+}
+
+static inline void begin_frame(int width, int height) {
+    ImGuiIO& io = ImGui::GetIO();
+    io.DisplaySize = ImVec2((float)width, (float)height);
+    io.DeltaTime = 1.0f / 60.0f;
+    ImGui::NewFrame();
+}
+
+// Stands in for the renderer backend: ImGui::Render() and every draw callback of the frame, nothing is drawn.
+static inline void render_frame() {
+    ImGui::Render();
+    ImDrawData* draw_data = ImGui::GetDrawData();
+    for (ImDrawList* list : draw_data->CmdLists) {
+        for (const ImDrawCmd& cmd : list->CmdBuffer) {
+            if (cmd.UserCallback != nullptr && cmd.UserCallback != ImDrawCallback_ResetRenderState)
+                cmd.UserCallback(list, &cmd);
+        }
+    }
+}
+
+static inline int report(const char* name) {
+    if (g_failures > 0)
+        printf("%s: %d checks failed\n", name, g_failures);
+    else
+        printf("%s: passed\n", name);
+    return g_failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,207 @@
+// Drives blur::AdaptiveController with a fake FrameTimer whose readbacks come back a few frames late, sometimes much
+// later: a blur over budget steps the scale down until it fits, one under budget climbs back to full scale, and every
+// change waits for the timing of the frame it was made in. At the boundary, where the cost model says the better step
+// fits but it does not, the climbs that have to be undone get rarer instead of oscillating. Then the fake timer goes
+// in through blur::set_adaptive_timer() and the adaptive process() shrinks the pyramid on the recording backend.
+//
+//   g++ -std=c++17 -pthread -I. -I<imgui> tests/test_adaptive.cpp imgui_blur.cpp
+//       <imgui>/imgui.cpp <imgui>/imgui_draw.cpp <imgui>/imgui_tables.cpp <imgui>/imgui_widgets.cpp
+
+#include "imgui.h"
+#include "imgui_blur.h"
+#include "imgui_blur_internal.h"
+
+#include "recording_backend.h"
+#include "test.h"
+
+static const float g_radius = 24.0f;
+
+// Times of the simulated frames, each readable once 'delay' more frames have started, and never earlier than one
+// read before, as a queue of GPU timer queries would.
+class FakeTimer : public blur::FrameTimer {
+public:
+    bool measure(int& frame, float& ms) override {
+        int ready = current - delay;
+        if (stall_from >= 0 && current >= stall_from && current < stall_from + stall_frames && ready > stall_from)
+            ready = stall_from; // a readback that takes 'stall_frames' longer
+        if (ready < last_measured)
+            ready = last_measured;
+        if (ready < 0 || ready >= times.Size)
+            return false;
+        frame = last_measured = ready;
+        ms = times[ready];
+        return true;
+    }
+
+    ImVector<float> times; // by frame
+    int current = 0;       // the frame being recorded
+    int delay = 3;
+    int stall_from = -1;
+    int stall_frames = 0;
+    int last_measured = -1;
+};
+
+// What a frame at 'setting' costs, in ms.
+typedef float (*TimeModel)(const blur::AdaptiveSetting& setting, float full_cost);
+
+class Run {
+public:
+    int changes = 0;
+    int over_budget = 0; // frames
+    int last_change = -1;
+};
+
+// Simulates 'frames' frames. Each change of step has to come from a timing of the frame of the last change or later.
+static Run run(blur::AdaptiveController& controller, FakeTimer& timer, const blur::AdaptiveParameters& parameters, int frames, TimeModel time, int stall_every = 0) {
+    blur::AdaptiveSetting ladder[blur::AdaptiveController::max_steps];
+    blur::AdaptiveController::build_ladder(parameters.radius, ladder);
+
+    Run result;
+    int changed_frame = -1;
+    for (int i = 0; i < frames; ++i) {
+        const int frame = timer.current = timer.times.Size;
+        if (stall_every > 0 && frame % stall_every == 0) {
+            timer.stall_from = frame - timer.delay;
+            timer.stall_frames = 12;
+        }
+
+        const int step = controller.step;
+        controller.update(frame, parameters, timer);
+        if (controller.step != step) {
+            if (changed_frame >= 0 && !CHECK(timer.last_measured >= changed_frame))
+                printf("  frame %d changed step on the timing of frame %d, before the change at %d\n", frame, timer.last_measured, changed_frame);
+            changed_frame = result.last_change = frame;
+            ++result.changes;
+        }
+
+        const float ms = time(controller.setting(parameters.radius), ladder[0].cost);
+        result.over_budget += ms > parameters.budget_ms ? 1 : 0;
+        timer.times.push_back(ms);
+    }
+    return result;
+}
+
+// Three times the budget at full scale, linear in the modelled cost.
+static float heavy_time(const blur::AdaptiveSetting& setting, float full_cost) {
+    return 3.0f * setting.cost / full_cost;
+}
+
+static float light_time(const blur::AdaptiveSetting& setting, float full_cost) {
+    return 0.3f * setting.cost / full_cost;
+}
+
+static blur::AdaptiveParameters parameters() {
+    blur::AdaptiveParameters parameters;
+    parameters.budget_ms = 1.0f;
+    parameters.radius = g_radius;
+    parameters.algorithm = blur::Algorithm_Kawase;
+    return parameters;
+}
+
+static void check_steps_down_and_up() {
+    blur::AdaptiveController controller;
+    FakeTimer timer;
+    const Run down = run(controller, timer, parameters(), 300, heavy_time);
+    CHECK(controller.step > 0);
+    CHECK(down.changes >= 1 && down.changes <= 3);
+    CHECK(timer.times.back() <= parameters().budget_ms);
+    CHECK(down.last_change < 100); // settled
+
+    const Run up = run(controller, timer, parameters(), 1000, light_time);
+    CHECK(controller.step == 0);
+    CHECK(up.changes >= 1 && up.changes <= blur::AdaptiveController::max_steps);
+}
+
+// Readbacks up to 12 frames late every 40 frames, the timings of the frames before a change keep coming back after it.
+static void check_delayed_readbacks() {
+    blur::AdaptiveController controller;
+    FakeTimer timer;
+    timer.delay = 5;
+    const Run down = run(controller, timer, parameters(), 400, heavy_time, 40);
+    CHECK(controller.step > 0);
+    CHECK(down.changes >= 1 && down.changes <= 3);
+    CHECK(timer.times.back() <= parameters().budget_ms);
+
+    run(controller, timer, parameters(), 2000, light_time, 40);
+    CHECK(controller.step == 0);
+}
+
+// From 'g_boundary_step' the cost model predicts the step above at 80% of the budget, but it takes 125%, so every
+// climb to it lands over budget and is undone.
+static const int g_boundary_step = 2;
+static float g_boundary_scale = 0.0f;
+
+static float boundary_time(const blur::AdaptiveSetting& setting, float) {
+    blur::AdaptiveSetting ladder[blur::AdaptiveController::max_steps];
+    blur::AdaptiveController::build_ladder(g_radius, ladder);
+    const float predicted = 0.8f * setting.cost / ladder[g_boundary_step - 1].cost;
+    return setting.scale > g_boundary_scale ? predicted * 1.25f / 0.8f : predicted;
+}
+
+static void check_boundary() {
+    blur::AdaptiveSetting ladder[blur::AdaptiveController::max_steps];
+    if (!CHECK(blur::AdaptiveController::build_ladder(g_radius, ladder) > g_boundary_step))
+        return;
+    g_boundary_scale = ladder[g_boundary_step].scale;
+
+    blur::AdaptiveController controller;
+    FakeTimer timer;
+    run(controller, timer, parameters(), 3000, boundary_time);
+    CHECK(controller.step >= g_boundary_step - 1 && controller.step <= g_boundary_step);
+
+    // The climb wait doubles up to 960 measurements, so only a few climbs and drops are left in 3000 frames.
+    const Run settled = run(controller, timer, parameters(), 3000, boundary_time);
+    CHECK(settled.changes <= 8);
+    CHECK(settled.over_budget < 3000 / 50);
+}
+
+// Five times the budget, measured on the frame two frames back.
+class OverBudgetTimer : public blur::FrameTimer {
+public:
+    bool measure(int& frame, float& ms) override {
+        frame = ImGui::GetFrameCount() - 2;
+        ms = 5.0f;
+        return frame >= 0;
+    }
+};
+
+// The width of level 0, read from the first pass, which downsamples the frame into it.
+static int level0_width(RecordingBackend& backend) {
+    begin_frame(1280, 720);
+    ImDrawList* draw_list = ImGui::GetBackgroundDrawList();
+    blur::process(draw_list, parameters());
+    blur::render(draw_list, ImVec2(0.0f, 0.0f), ImVec2(1280.0f, 720.0f), 0xFFFFFFFF);
+    backend.reset();
+    render_frame();
+    return backend.passes.Size > 0 ? backend.passes[0].width : 0;
+}
+
+static void check_set_adaptive_timer(RecordingBackend& backend) {
+    const int full_width = level0_width(backend);
+    CHECK(full_width > 0);
+
+    OverBudgetTimer timer;
+    blur::set_adaptive_timer(&timer);
+    int width = full_width;
+    for (int frame = 0; frame < 30; ++frame)
+        width = level0_width(backend);
+    CHECK(width > 0 && width < full_width);
+    blur::set_adaptive_timer(nullptr);
+}
+
+int main() {
+    create_imgui_context();
+    check_steps_down_and_up();
+    check_delayed_readbacks();
+    check_boundary();
+
+    RecordingBackend* backend = IM_NEW(RecordingBackend);
+    backend->source_width = 1280;
+    backend->source_height = 720;
+    blur::set_backend(backend);
+    check_set_adaptive_timer(*backend);
+
+    blur::destroy();
+    ImGui::DestroyContext();
+    return report("test_adaptive");
+}
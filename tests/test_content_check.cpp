@@ -0,0 +1,248 @@
+// Blurs a still frame with ProcessFlags_ContentHash and changes one pixel at a time, each away from the top left
+// corner: an unchanged frame reuses the last blur, a changed pixel anywhere in the sampled region recomputes it, and
+// changing it back gives the first result again. Runs on the CPU backend, or on a Direct3D 11 WARP device where the
+// compare shader runs under an occlusion predicate and only the output shows whether the passes ran.
+//
+//   g++ -std=c++17 -pthread -I. -I<imgui> tests/test_content_check.cpp imgui_blur.cpp imgui_blur_cpu.cpp
+//       imgui_blur_shader_cache.cpp <imgui>/imgui.cpp <imgui>/imgui_draw.cpp <imgui>/imgui_tables.cpp <imgui>/imgui_widgets.cpp
+//   Direct3D 11 on WARP: add /DIMGUI_BLUR_TEST_DX11 imgui_blur_dx11.cpp d3d11.lib
+
+#include "imgui.h"
+#include "imgui_blur.h"
+
+#include "test.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef IMGUI_BLUR_TEST_DX11
+#include "imgui_impl_dx11.h"
+#include <d3d11.h>
+#pragma comment(lib, "d3d11.lib")
+#endif
+
+static const int g_width = 160, g_height = 96;
+
+// The frame the blur captures, and a way to read back what get_texture() returned.
+class Target {
+public:
+    virtual ~Target() {}
+
+    virtual bool setup() = 0;
+    virtual void upload(const ImVector<unsigned char>& pixels) = 0;
+    // Makes the frame the target the renderer is drawing into, as the ImGui backend would.
+    virtual void bind() = 0;
+    // RGBA8, the top 'g_width' x 'g_height' of the texture.
+    virtual bool read(ImTextureID texture, ImVector<unsigned char>& out) = 0;
+};
+
+class CpuTarget : public Target {
+public:
+    bool setup() override {
+        pixels.resize(g_width * g_height * 4);
+        return blur::setup_cpu();
+    }
+
+    void upload(const ImVector<unsigned char>& frame) override {
+        memcpy(pixels.Data, frame.Data, (size_t)frame.Size);
+    }
+
+    void bind() override {
+        blur::CpuImage target;
+        target.pixels = pixels.Data;
+        target.width = g_width;
+        target.height = g_height;
+        target.stride = g_width * 4;
+        blur::set_cpu_target(target);
+    }
+
+    bool read(ImTextureID texture, ImVector<unsigned char>& out) override {
+        const blur::CpuImage& image = *(const blur::CpuImage*)(intptr_t)texture;
+        out.resize(g_width * g_height * 4);
+        for (int y = 0; y < g_height; ++y)
+            memcpy(&out[y * g_width * 4], image.pixels + (size_t)y * image.stride, g_width * 4);
+        return true;
+    }
+
+private:
+    ImVector<unsigned char> pixels;
+};
+
+#ifdef IMGUI_BLUR_TEST_DX11
+class Dx11Target : public Target {
+public:
+    ~Dx11Target() override {
+        if (rtv) rtv->Release();
+        if (texture) texture->Release();
+        if (device_context) device_context->Release();
+        if (device) device->Release();
+    }
+
+    // WARP is the software rasterizer every Windows install ships with.
+    bool setup() override {
+        const D3D_FEATURE_LEVEL feature_levels[] = { D3D_FEATURE_LEVEL_11_0, D3D_FEATURE_LEVEL_10_0 };
+        if (FAILED(D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_WARP, nullptr, 0, feature_levels, IM_ARRAYSIZE(feature_levels), D3D11_SDK_VERSION, &device, nullptr, &device_context)))
+            return false;
+
+        D3D11_TEXTURE2D_DESC tex_desc = {};
+        tex_desc.Width = g_width;
+        tex_desc.Height = g_height;
+        tex_desc.MipLevels = 1;
+        tex_desc.ArraySize = 1;
+        tex_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+        tex_desc.SampleDesc.Count = 1;
+        tex_desc.Usage = D3D11_USAGE_DEFAULT;
+        tex_desc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+        if (FAILED(device->CreateTexture2D(&tex_desc, nullptr, &texture)) || FAILED(device->CreateRenderTargetView(texture, nullptr, &rtv)))
+            return false;
+
+        // What imgui_impl_dx11 hands to draw callbacks.
+        render_state = {};
+        render_state.Device = device;
+        render_state.DeviceContext = device_context;
+        ImGui::GetPlatformIO().Renderer_RenderState = &render_state;
+        return blur::setup(device, device_context);
+    }
+
+    void upload(const ImVector<unsigned char>& frame) override {
+        device_context->UpdateSubresource(texture, 0, nullptr, frame.Data, g_width * 4, 0);
+    }
+
+    void bind() override {
+        D3D11_VIEWPORT viewport = {};
+        viewport.Width = (float)g_width;
+        viewport.Height = (float)g_height;
+        viewport.MaxDepth = 1.0f;
+        device_context->OMSetRenderTargets(1, &rtv, nullptr);
+        device_context->RSSetViewports(1, &viewport);
+    }
+
+    // Through a staging copy of the whole texture.
+    bool read(ImTextureID id, ImVector<unsigned char>& out) override {
+        ID3D11Resource* resource = nullptr;
+        ((ID3D11ShaderResourceView*)id)->GetResource(&resource);
+        ID3D11Texture2D* source = nullptr;
+        const bool is_texture = SUCCEEDED(resource->QueryInterface(__uuidof(ID3D11Texture2D), (void**)&source));
+        resource->Release();
+        if (!is_texture)
+            return false;
+
+        D3D11_TEXTURE2D_DESC desc;
+        source->GetDesc(&desc);
+        desc.Usage = D3D11_USAGE_STAGING;
+        desc.BindFlags = 0;
+        desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+        desc.MiscFlags = 0;
+        ID3D11Texture2D* staging = nullptr;
+        bool result = false;
+        if (SUCCEEDED(device->CreateTexture2D(&desc, nullptr, &staging))) {
+            device_context->CopyResource(staging, source);
+            D3D11_MAPPED_SUBRESOURCE mapped;
+            if (SUCCEEDED(device_context->Map(staging, 0, D3D11_MAP_READ, 0, &mapped))) {
+                out.resize(g_width * g_height * 4);
+                for (int y = 0; y < g_height; ++y)
+                    memcpy(&out[y * g_width * 4], (const unsigned char*)mapped.pData + (size_t)y * mapped.RowPitch, g_width * 4);
+                device_context->Unmap(staging, 0);
+                result = true;
+            }
+            staging->Release();
+        }
+        source->Release();
+        return result;
+    }
+
+private:
+    ID3D11Device* device = nullptr;
+    ID3D11DeviceContext* device_context = nullptr;
+    ID3D11Texture2D* texture = nullptr;
+    ID3D11RenderTargetView* rtv = nullptr;
+    ImGui_ImplDX11_RenderState render_state{};
+};
+#endif
+
+// Gradients and a checker pattern, so neighbouring pixels differ.
+static void fill_frame(ImVector<unsigned char>& pixels) {
+    pixels.resize(g_width * g_height * 4);
+    for (int y = 0; y < g_height; ++y) {
+        for (int x = 0; x < g_width; ++x) {
+            unsigned char* pixel = &pixels[(y * g_width + x) * 4];
+            pixel[0] = (unsigned char)(x * 255 / g_width);
+            pixel[1] = (unsigned char)(y * 255 / g_height);
+            pixel[2] = ((x >> 3) ^ (y >> 3)) & 1 ? 200 : 40;
+            pixel[3] = 255;
+        }
+    }
+}
+
+static bool same_bytes(const ImVector<unsigned char>& a, const ImVector<unsigned char>& b) {
+    return a.Size == b.Size && memcmp(a.Data, b.Data, (size_t)a.Size) == 0;
+}
+
+// One iteration at offset 1 keeps a single pixel's share of the output well above one 8 bit step. 'passes' gets how
+// many passes the frame before ran, blur::get_stats() only has them once this one began.
+static ImTextureID run_frame(Target& target, int* passes = nullptr) {
+    begin_frame(g_width, g_height);
+    if (passes != nullptr)
+        *passes = blur::get_stats().passes;
+
+    const blur::Snapshot snapshot = blur::process(ImGui::GetBackgroundDrawList(), 1, 1.0f, 0.0f, 1.0f, blur::ProcessFlags_ContentHash);
+    blur::add_region(snapshot, ImVec2(0.0f, 0.0f), ImVec2((float)g_width, (float)g_height));
+    const ImTextureID texture = blur::get_texture(snapshot);
+    target.bind();
+    render_frame();
+    return texture;
+}
+
+static void check_single_pixels(Target& target, bool count_passes) {
+    ImVector<unsigned char> frame, first, blurred;
+    fill_frame(frame);
+    target.upload(frame);
+    run_frame(target);
+    ImTextureID texture = run_frame(target);
+    if (!CHECK(texture != 0 && target.read(texture, first)))
+        return;
+
+    const int positions[][2] = { { g_width - 1, g_height - 1 }, { g_width / 2 + 3, g_height / 2 + 1 }, { g_width - 1, 0 }, { 0, g_height - 1 }, { 1, 0 } };
+    for (const int* position : positions) {
+        unsigned char* pixel = &frame[(position[1] * g_width + position[0]) * 4];
+        const unsigned char original[3] = { pixel[0], pixel[1], pixel[2] };
+        for (int c = 0; c < 3; ++c)
+            pixel[c] = (unsigned char)(255 - pixel[c]);
+        target.upload(frame);
+        int passes = -1;
+        texture = run_frame(target, &passes);
+        if (count_passes)
+            CHECK(passes == 0); // the frame before was unchanged
+        if (!CHECK(target.read(texture, blurred) && !same_bytes(first, blurred)))
+            printf("  the change at %d, %d was not blurred\n", position[0], position[1]);
+
+        memcpy(pixel, original, 3);
+        target.upload(frame);
+        run_frame(target, &passes);
+        if (count_passes)
+            CHECK(passes > 0);
+        texture = run_frame(target, &passes);
+        if (count_passes)
+            CHECK(passes > 0);
+        CHECK(target.read(texture, blurred) && same_bytes(first, blurred));
+    }
+}
+
+int main() {
+    create_imgui_context();
+#ifdef IMGUI_BLUR_TEST_DX11
+    Dx11Target target;
+    const bool count_passes = false; // predicated passes are counted whether they ran or not
+#else
+    CpuTarget target;
+    const bool count_passes = true;
+#endif
+    if (!CHECK(target.setup()))
+        return report("test_content_check");
+
+    check_single_pixels(target, count_passes);
+
+    blur::destroy();
+    ImGui::DestroyContext();
+    return report("test_content_check");
+}
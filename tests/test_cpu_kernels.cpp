@@ -0,0 +1,141 @@
+// Runs every pass of the CPU backend with each row kernel this machine supports (SSE2, AVX2, NEON) on fixed random
+// images, whole and over odd regions, and checks each output byte stays within 1 of CpuKernel_Scalar.
+//
+//   g++ -std=c++17 -pthread -I. -I<imgui> tests/test_cpu_kernels.cpp imgui_blur.cpp imgui_blur_cpu.cpp
+//       imgui_blur_shader_cache.cpp <imgui>/imgui.cpp <imgui>/imgui_draw.cpp <imgui>/imgui_tables.cpp <imgui>/imgui_widgets.cpp
+
+#include "imgui.h"
+#include "imgui_blur.h"
+#include "imgui_blur_internal.h"
+
+#include "test.h"
+
+#include <string.h>
+
+#include <vector>
+
+static const int g_width = 331, g_height = 197; // odd, so the SIMD kernels end rows on a partial step
+
+class PassCase {
+public:
+    blur::Kernel kernel;
+    float offset; // sigma for the gaussian kernels
+    int input_width, input_height;
+    int target_width, target_height;
+};
+
+static const PassCase g_cases[] = {
+    { blur::Kernel_Downsample, 1.0f, g_width, g_height, (g_width + 1) / 2, (g_height + 1) / 2 },
+    { blur::Kernel_Downsample, 2.0f, g_width, g_height, (g_width + 1) / 2, (g_height + 1) / 2 },
+    { blur::Kernel_Downsample, 3.5f, g_width, g_height, (g_width + 1) / 2, (g_height + 1) / 2 },
+    { blur::Kernel_Upsample, 1.0f, (g_width + 1) / 2, (g_height + 1) / 2, g_width, g_height },
+    { blur::Kernel_Upsample, 2.0f, (g_width + 1) / 2, (g_height + 1) / 2, g_width, g_height },
+    { blur::Kernel_Upsample, 3.5f, (g_width + 1) / 2, (g_height + 1) / 2, g_width, g_height },
+    { blur::Kernel_Upsample, 0.0f, g_width, g_height, g_width, g_height },
+    { blur::Kernel_GaussianX, 1.5f, g_width, g_height, g_width, g_height },
+    { blur::Kernel_GaussianY, 1.5f, g_width, g_height, g_width, g_height },
+    { blur::Kernel_GaussianX, 6.0f, g_width, g_height, g_width, g_height },
+    { blur::Kernel_GaussianY, 6.0f, g_width, g_height, g_width, g_height },
+};
+
+static const float g_noises[] = { 0.0f, 0.02f };
+
+static ImU32 g_random = 0x2545F491u;
+
+// xorshift32, the same sequence on every run.
+static unsigned char random_byte() {
+    g_random ^= g_random << 13;
+    g_random ^= g_random >> 17;
+    g_random ^= g_random << 5;
+    return (unsigned char)(g_random >> 24);
+}
+
+static blur::Framebuffer create_image(blur::Backend* backend, int width, int height) {
+    blur::Framebuffer framebuffer;
+    backend->create_framebuffer(framebuffer, width, height, blur::Format_RGBA8);
+    framebuffer.texture_width = width;
+    framebuffer.texture_height = height;
+    return framebuffer;
+}
+
+static blur::CpuImage& image_of(const blur::Framebuffer& framebuffer) {
+    return *(blur::CpuImage*)framebuffer.handle;
+}
+
+// The whole target, then a few rectangles starting and ending at odd columns.
+static blur::RegionSet make_regions(int width, int height, bool whole) {
+    blur::RegionSet regions;
+    if (whole) {
+        regions.add({ 0, 0, width, height });
+    } else {
+        regions.add({ 1, 2, width / 2 + 1, height / 3 });
+        regions.add({ width / 3, height / 2, width - 3, height - 1 });
+    }
+    return regions;
+}
+
+// Output of one pass over the image in 'input' with 'kernel', starting from the same target contents every time.
+static void run_pass(blur::Backend* backend, blur::CpuKernel kernel, const PassCase& pass, float noise, const blur::RegionSet& regions,
+                     const blur::Framebuffer& input, const blur::Framebuffer& target, const std::vector<unsigned char>& initial, std::vector<unsigned char>& out) {
+    blur::CpuImage& image = image_of(target);
+    memcpy(image.pixels, initial.data(), initial.size());
+    blur::set_cpu_kernel(kernel);
+    backend->render_pass(target, input, pass.kernel, pass.offset, noise, regions);
+    out.assign(image.pixels, image.pixels + initial.size());
+}
+
+static void check_kernel(blur::Backend* backend, blur::CpuKernel kernel, const char* name) {
+    for (const PassCase& pass : g_cases) {
+        blur::Framebuffer input = create_image(backend, pass.input_width, pass.input_height);
+        blur::Framebuffer target = create_image(backend, pass.target_width, pass.target_height);
+        const blur::CpuImage& input_image = image_of(input);
+        for (int i = 0; i < input_image.stride * input_image.height; ++i)
+            input_image.pixels[i] = random_byte();
+        std::vector<unsigned char> initial((size_t)image_of(target).stride * pass.target_height);
+        for (unsigned char& value : initial)
+            value = random_byte();
+
+        for (float noise : g_noises) {
+            for (int whole = 0; whole < 2; ++whole) {
+                const blur::RegionSet regions = make_regions(pass.target_width, pass.target_height, whole != 0);
+                std::vector<unsigned char> reference, result;
+                run_pass(backend, blur::CpuKernel_Scalar, pass, noise, regions, input, target, initial, reference);
+                run_pass(backend, kernel, pass, noise, regions, input, target, initial, result);
+
+                int max_diff = 0;
+                for (size_t i = 0; i < reference.size(); ++i) {
+                    const int diff = reference[i] > result[i] ? reference[i] - result[i] : result[i] - reference[i];
+                    max_diff = diff > max_diff ? diff : max_diff;
+                }
+                if (!CHECK(max_diff <= 1))
+                    printf("  %s, kernel %d offset %.1f noise %.2f %s: %d steps off\n", name, (int)pass.kernel, pass.offset, noise,
+                           whole ? "whole" : "regions", max_diff);
+            }
+        }
+
+        backend->destroy_framebuffer(input);
+        backend->destroy_framebuffer(target);
+    }
+}
+
+int main() {
+    create_imgui_context();
+    if (!CHECK(blur::setup_cpu()))
+        return report("test_cpu_kernels");
+
+    blur::Backend* backend = blur::get_backend();
+    const blur::CpuKernel kernels[] = { blur::CpuKernel_SSE2, blur::CpuKernel_AVX2, blur::CpuKernel_NEON };
+    const char* names[] = { "sse2", "avx2", "neon" };
+    for (int i = 0; i < IM_ARRAYSIZE(kernels); ++i) {
+        if (!blur::set_cpu_kernel(kernels[i])) {
+            printf("%s: not available\n", names[i]);
+            continue;
+        }
+        check_kernel(backend, kernels[i], names[i]);
+        printf("%s: checked\n", names[i]);
+    }
+
+    blur::destroy();
+    ImGui::DestroyContext();
+    return report("test_cpu_kernels");
+}
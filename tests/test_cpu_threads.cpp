@@ -0,0 +1,130 @@
+// Blurs the same frames on the CPU backend with 1, 2, 3, 4, 7 threads and every core (blur::set_cpu_threads()) and
+// checks each output is byte for byte the single threaded one. The frame is large enough for its first levels to be
+// split into row bands, and odd sized so the last band of a level is short. Runs every algorithm, over the whole frame
+// and over regions whose rows start and end inside bands.
+//
+//   g++ -std=c++17 -pthread -I. -I<imgui> tests/test_cpu_threads.cpp imgui_blur.cpp imgui_blur_cpu.cpp
+//       imgui_blur_shader_cache.cpp <imgui>/imgui.cpp <imgui>/imgui_draw.cpp <imgui>/imgui_tables.cpp <imgui>/imgui_widgets.cpp
+
+#include "imgui.h"
+#include "imgui_blur.h"
+
+#include "test.h"
+
+#include <stdint.h>
+#include <string.h>
+
+static const int g_width = 721, g_height = 407;
+static const int g_thread_counts[] = { 2, 3, 4, 7, 0 };
+
+class Case {
+public:
+    blur::Algorithm algorithm;
+    float radius;
+    bool regions; // g_regions instead of the whole frame
+};
+
+// x0 y0 x1 y1, only these pixels of the output are computed.
+static const int g_regions[2][4] = { { 37, 21, 400, 133 }, { 300, 250, g_width, 399 } };
+
+static const Case g_cases[] = {
+    { blur::Algorithm_Kawase, 8.0f, false },
+    { blur::Algorithm_Kawase, 40.0f, false },
+    { blur::Algorithm_Kawase, 16.0f, true },
+    { blur::Algorithm_Gaussian, 5.0f, false },
+    { blur::Algorithm_Gaussian, 3.0f, true },
+    { blur::Algorithm_Box, 12.0f, false },
+    { blur::Algorithm_Box, 12.0f, true },
+};
+
+// Gradients, a checker pattern and a few hashed pixels, so rows and bands differ from their neighbours.
+static void fill_frame(ImVector<unsigned char>& pixels) {
+    pixels.resize(g_width * g_height * 4);
+    for (int y = 0; y < g_height; ++y) {
+        for (int x = 0; x < g_width; ++x) {
+            unsigned char* pixel = &pixels[(y * g_width + x) * 4];
+            const unsigned int hash = (unsigned int)x * 73856093u ^ (unsigned int)y * 19349663u;
+            pixel[0] = (unsigned char)(x * 255 / g_width);
+            pixel[1] = (unsigned char)(y * 255 / g_height);
+            pixel[2] = ((x >> 4) ^ (y >> 4)) & 1 ? 210 : 50;
+            pixel[3] = hash % 97 == 0 ? (unsigned char)hash : 255;
+        }
+    }
+}
+
+// One frame blurred as 'blur_case' says, read back. Outside its regions the output keeps whatever its pooled texture
+// held, so only the regions are copied and the rest is zero.
+static bool blur_frame(ImVector<unsigned char>& frame, const Case& blur_case, ImVector<unsigned char>& out) {
+    blur::AdaptiveParameters parameters;
+    parameters.budget_ms = 0.0f;
+    parameters.radius = blur_case.radius;
+    parameters.algorithm = blur_case.algorithm;
+
+    begin_frame(g_width, g_height);
+    const blur::Snapshot snapshot = blur::process(ImGui::GetBackgroundDrawList(), parameters);
+    if (blur_case.regions) {
+        for (const int* region : g_regions)
+            blur::add_region(snapshot, ImVec2((float)region[0], (float)region[1]), ImVec2((float)region[2], (float)region[3]));
+    } else {
+        blur::add_region(snapshot, ImVec2(0.0f, 0.0f), ImVec2((float)g_width, (float)g_height));
+    }
+    const ImTextureID texture = blur::get_texture(snapshot);
+    blur::CpuImage target;
+    target.pixels = frame.Data;
+    target.width = g_width;
+    target.height = g_height;
+    target.stride = g_width * 4;
+    blur::set_cpu_target(target);
+    render_frame();
+    if (texture == 0)
+        return false;
+
+    const blur::CpuImage& image = *(const blur::CpuImage*)(intptr_t)texture;
+    out.resize(g_width * g_height * 4);
+    if (!blur_case.regions) {
+        for (int y = 0; y < g_height; ++y)
+            memcpy(&out[y * g_width * 4], image.pixels + (size_t)y * image.stride, g_width * 4);
+        return true;
+    }
+
+    memset(out.Data, 0, (size_t)out.Size);
+    for (const int* region : g_regions) {
+        for (int y = region[1]; y < region[3]; ++y)
+            memcpy(&out[(y * g_width + region[0]) * 4], image.pixels + (size_t)y * image.stride + region[0] * 4, (region[2] - region[0]) * 4);
+    }
+    return true;
+}
+
+// Each thread count blurs from fresh pyramids, so no result of another one is reused.
+static void check_case(ImVector<unsigned char>& frame, const Case& blur_case) {
+    ImVector<unsigned char> single, threaded;
+    blur::set_cpu_threads(1);
+    blur::destroy_context();
+    if (!CHECK(blur_frame(frame, blur_case, single)))
+        return;
+
+    for (int thread_count : g_thread_counts) {
+        blur::set_cpu_threads(thread_count);
+        blur::destroy_context();
+        if (!CHECK(blur_frame(frame, blur_case, threaded)))
+            return;
+        if (!CHECK(single.Size == threaded.Size && memcmp(single.Data, threaded.Data, (size_t)single.Size) == 0))
+            printf("  algorithm %d radius %g%s: %d threads differ from one\n", (int)blur_case.algorithm, blur_case.radius,
+                   blur_case.regions ? " over regions" : "", thread_count);
+    }
+}
+
+int main() {
+    create_imgui_context();
+    if (!CHECK(blur::setup_cpu()))
+        return report("test_cpu_threads");
+
+    ImVector<unsigned char> frame;
+    fill_frame(frame);
+    for (const Case& blur_case : g_cases)
+        check_case(frame, blur_case);
+
+    blur::destroy();
+    ImGui::DestroyContext();
+    return report("test_cpu_threads");
+}
@@ -0,0 +1,158 @@
+// Checks the framebuffer pool on the recording backend of tests/recording_backend.h: sizes share textures within a
+// bucket, trim() destroys the least recently released textures first, and blurred frames stop creating framebuffers
+// (blur::get_stats().framebuffers_created drops to 0) as soon as their parameters settle, and do not create any when
+// animated iterations or a dragged window edge come back to sizes they had before.
+//
+//   g++ -std=c++17 -pthread -I. -I<imgui> tests/test_framebuffer_pool.cpp imgui_blur.cpp
+//       <imgui>/imgui.cpp <imgui>/imgui_draw.cpp <imgui>/imgui_tables.cpp <imgui>/imgui_widgets.cpp
+
+#include "imgui.h"
+#include "imgui_blur.h"
+#include "imgui_blur_internal.h"
+
+#include "recording_backend.h"
+#include "test.h"
+
+static const size_t g_texture_bytes = 64 * 64 * 4;
+
+static int texture_id(const blur::Framebuffer& framebuffer) {
+    return ((const RecordingBackend::Texture*)framebuffer.handle)->id;
+}
+
+static void check_buckets() {
+    RecordingBackend backend;
+    blur::FramebufferPool pool;
+    blur::Framebuffer framebuffer = pool.acquire(&backend, 64, 64, blur::Format_RGBA8);
+    const int id = texture_id(framebuffer);
+    pool.release(framebuffer);
+
+    // A smaller size in the same bucket takes the idle texture and uses its top left.
+    framebuffer = pool.acquire(&backend, 50, 60, blur::Format_RGBA8);
+    CHECK(backend.calls.framebuffers_created == 1);
+    CHECK(texture_id(framebuffer) == id);
+    CHECK(framebuffer.width == 50 && framebuffer.height == 60);
+    CHECK(framebuffer.texture_width == 64 && framebuffer.texture_height == 64);
+
+    // Growing past the texture or changing the format needs a new one.
+    CHECK(pool.resize(&backend, framebuffer, 56, 64, blur::Format_RGBA8));
+    CHECK(texture_id(framebuffer) == id);
+    CHECK(pool.resize(&backend, framebuffer, 80, 64, blur::Format_RGBA8));
+    CHECK(texture_id(framebuffer) != id);
+    CHECK(backend.calls.framebuffers_created == 2);
+    CHECK(pool.resize(&backend, framebuffer, 80, 64, blur::Format_RGBA16F));
+    CHECK(backend.calls.framebuffers_created == 3);
+
+    pool.release(framebuffer);
+    pool.clear(&backend);
+    CHECK(backend.live_textures == 0);
+}
+
+static void check_trim_order() {
+    RecordingBackend backend;
+    blur::FramebufferPool pool;
+    blur::Framebuffer framebuffers[4];
+    int ids[4];
+    for (int i = 0; i < 4; ++i) {
+        framebuffers[i] = pool.acquire(&backend, 64, 64, blur::Format_RGBA8);
+        ids[i] = texture_id(framebuffers[i]);
+    }
+
+    // Released 2, 0, 3, 1: texture 2 has been idle the longest.
+    const int release_order[] = { 2, 0, 3, 1 };
+    for (int i : release_order)
+        pool.release(framebuffers[i]);
+    CHECK(pool.idle_bytes() == g_texture_bytes * 4);
+
+    pool.trim(&backend, g_texture_bytes * 2);
+    CHECK(pool.idle_bytes() == g_texture_bytes * 2);
+    CHECK(backend.destroyed.Size == 2 && backend.destroyed[0] == ids[2] && backend.destroyed[1] == ids[0]);
+
+    // Taking texture 3 and releasing it again leaves texture 1 the oldest.
+    blur::Framebuffer framebuffer = pool.acquire(&backend, 64, 64, blur::Format_RGBA8);
+    CHECK(texture_id(framebuffer) == ids[3]);
+    pool.release(framebuffer);
+    pool.trim(&backend, g_texture_bytes);
+    CHECK(backend.destroyed.Size == 3 && backend.destroyed[2] == ids[1]);
+
+    // Within budget nothing goes.
+    pool.trim(&backend, g_texture_bytes);
+    CHECK(backend.destroyed.Size == 3);
+    CHECK(backend.calls.framebuffers_created == 4);
+
+    pool.clear(&backend);
+    CHECK(backend.destroyed.Size == 4 && backend.destroyed[3] == ids[3]);
+    CHECK(backend.live_textures == 0);
+}
+
+// A blurred panel at 'width' x 'height'. Returns the framebuffers the frame created; the stats of a frame are only
+// complete once the next one began, 'reported' gets what blur::get_stats() says about the frame before.
+static int run_frame(RecordingBackend& backend, int width, int height, int iterations, int* reported = nullptr) {
+    begin_frame(width, height);
+    if (reported != nullptr)
+        *reported = blur::get_stats().framebuffers_created;
+
+    ImDrawList* draw_list = ImGui::GetBackgroundDrawList();
+    blur::process(draw_list, iterations, 2.0f, 0.01f, 1.0f);
+    blur::render(draw_list, ImVec2(width * 0.2f, height * 0.2f), ImVec2(width * 0.8f, height * 0.8f), 0xFFFFFFFF, 12.0f);
+
+    backend.source_width = width;
+    backend.source_height = height;
+    backend.reset();
+    render_frame();
+    blur::garbage_collect();
+    return backend.calls.framebuffers_created;
+}
+
+// Whatever the first frame with new parameters allocates, the following ones allocate nothing.
+static void check_settles(RecordingBackend& backend, int width, int height, int iterations) {
+    run_frame(backend, width, height, iterations);
+    CHECK(run_frame(backend, width, height, iterations) == 0);
+    for (int i = 0; i < 3; ++i) {
+        int reported = -1;
+        CHECK(run_frame(backend, width, height, iterations, &reported) == 0);
+        CHECK(reported == 0);
+    }
+}
+
+// An open/close transition animating the iterations, run twice: the second time every level is in the pool.
+static void check_iteration_changes(RecordingBackend& backend) {
+    const int iterations[] = { 4, 3, 2, 1, 2, 3, 4, 5, 6, 5, 4 };
+    int created[2] = {};
+    for (int pass = 0; pass < 2; ++pass) {
+        for (int i : iterations)
+            created[pass] += run_frame(backend, 1280, 720, i);
+    }
+    CHECK(created[1] == 0);
+    check_settles(backend, 1280, 720, 4);
+}
+
+// A window edge dragged out and back twice. Only crossing a bucket allocates, and the second time nothing does.
+static void check_resizes(RecordingBackend& backend) {
+    const int steps = 20;
+    int created[2] = {};
+    for (int pass = 0; pass < 2; ++pass) {
+        for (int i = 0; i <= steps * 2; ++i) {
+            const int step = i <= steps ? i : steps * 2 - i;
+            created[pass] += run_frame(backend, 1280 + step * 16, 720 + step * 9, 4);
+        }
+    }
+    CHECK(created[0] < steps);
+    CHECK(created[1] == 0);
+    check_settles(backend, 1280, 720, 4);
+}
+
+int main() {
+    create_imgui_context();
+    check_buckets();
+    check_trim_order();
+
+    RecordingBackend* backend = IM_NEW(RecordingBackend);
+    blur::set_backend(backend);
+    check_settles(*backend, 1280, 720, 4);
+    check_iteration_changes(*backend);
+    check_resizes(*backend);
+
+    blur::destroy();
+    ImGui::DestroyContext();
+    return report("test_framebuffer_pool");
+}
@@ -0,0 +1,151 @@
+// Runs ProcessFlags_Incremental chains on the CPU backend over a script of damaged rectangles and compares every frame
+// byte for byte with the same blur recomputed in full. The frame is not a multiple of the 16 pixel tiles in either
+// direction and the rectangles touch the corners and edges of the frame, tile boundaries and single pixels, so the
+// partial tiles at the edge of every pyramid level are recomputed too. Each algorithm runs at two radii.
+//
+//   g++ -std=c++17 -pthread -I. -I<imgui> tests/test_incremental.cpp imgui_blur.cpp imgui_blur_cpu.cpp
+//       imgui_blur_shader_cache.cpp <imgui>/imgui.cpp <imgui>/imgui_draw.cpp <imgui>/imgui_tables.cpp <imgui>/imgui_widgets.cpp
+
+#include "imgui.h"
+#include "imgui_blur.h"
+
+#include "test.h"
+
+#include <stdint.h>
+#include <string.h>
+
+static const int g_width = 203, g_height = 117;
+
+// Rectangles redrawn in each frame of the script, x0 y0 x1 y1, until a row of zeros.
+static const int g_script[][4][4] = {
+    { { 0, 0, 3, 3 } },                                                  // top left corner
+    { { g_width - 5, g_height - 2, g_width, g_height } },                // bottom right corner
+    { { 90, 50, 91, 51 } },                                              // one pixel
+    { },                                                                 // nothing changed
+    { { 15, 15, 17, 17 }, { 31, 0, 33, g_height } },                     // across tile boundaries
+    { { g_width - 1, 0, g_width, g_height }, { 0, g_height - 1, g_width, g_height } }, // last column and row
+    { { 40, 20, 160, 90 } },                                             // most of the frame
+    { { 100, 60, 110, 64 }, { 0, 50, 2, 70 }, { 190, 0, 203, 9 } },
+};
+
+class Frame {
+public:
+    Frame() {
+        pixels.resize(g_width * g_height * 4);
+        for (int y = 0; y < g_height; ++y) {
+            for (int x = 0; x < g_width; ++x)
+                fill(x, y, 0);
+        }
+    }
+
+    void fill(int x, int y, int seed) {
+        unsigned char* pixel = &pixels[(y * g_width + x) * 4];
+        pixel[0] = (unsigned char)(x * 7 + seed * 31);
+        pixel[1] = (unsigned char)(y * 5 + seed * 17);
+        pixel[2] = ((x >> 2) ^ (y >> 2) ^ seed) & 1 ? 220 : 30;
+        pixel[3] = 255;
+    }
+
+    void redraw(const int* rect, int seed) {
+        for (int y = rect[1]; y < rect[3]; ++y) {
+            for (int x = rect[0]; x < rect[2]; ++x)
+                fill(x, y, seed);
+        }
+    }
+
+    ImVector<unsigned char> pixels;
+};
+
+static void read(ImTextureID texture, ImVector<unsigned char>& out) {
+    const blur::CpuImage& image = *(const blur::CpuImage*)(intptr_t)texture;
+    out.resize(g_width * g_height * 4);
+    for (int y = 0; y < g_height; ++y)
+        memcpy(&out[y * g_width * 4], image.pixels + (size_t)y * image.stride, g_width * 4);
+}
+
+// The first byte that differs, -1 when none does.
+static int first_difference(const ImVector<unsigned char>& a, const ImVector<unsigned char>& b) {
+    for (int i = 0; i < a.Size; ++i) {
+        if (a[i] != b[i])
+            return i;
+    }
+    return -1;
+}
+
+// Both blurs of one frame: [0] incremental with 'rects' reported, [1] in full. Without 'report' the incremental one
+// gets no damage at all and is recomputed in full too.
+static void run_frame(Frame& frame, const blur::AdaptiveParameters& parameters, const int (*rects)[4], bool report, ImTextureID* textures) {
+    blur::CpuImage target;
+    target.pixels = frame.pixels.Data;
+    target.width = g_width;
+    target.height = g_height;
+    target.stride = g_width * 4;
+
+    begin_frame(g_width, g_height);
+    for (int i = 0; i < 2; ++i) {
+        blur::AdaptiveParameters variant = parameters;
+        variant.flags = i == 0 ? blur::ProcessFlags_Incremental : 0;
+        const blur::Snapshot snapshot = blur::process(ImGui::GetBackgroundDrawList(), variant);
+        blur::add_region(snapshot, ImVec2(0.0f, 0.0f), ImVec2((float)g_width, (float)g_height));
+        if (i == 0 && report) {
+            bool any = false;
+            for (int r = 0; r < 4 && rects[r][2] > rects[r][0]; ++r) {
+                blur::add_damage(snapshot, ImVec2((float)rects[r][0], (float)rects[r][1]), ImVec2((float)rects[r][2], (float)rects[r][3]));
+                any = true;
+            }
+            if (!any)
+                blur::add_damage(snapshot, ImVec2(0.0f, 0.0f), ImVec2(0.0f, 0.0f));
+        }
+        textures[i] = blur::get_texture(snapshot);
+    }
+    blur::set_cpu_target(target);
+    render_frame();
+}
+
+static void check_script(blur::Algorithm algorithm, float radius) {
+    blur::AdaptiveParameters parameters;
+    parameters.budget_ms = 0.0f;
+    parameters.radius = radius;
+    parameters.algorithm = algorithm;
+
+    Frame frame;
+    ImTextureID textures[2];
+    ImVector<unsigned char> incremental, full;
+    run_frame(frame, parameters, g_script[0], false, textures);
+
+    // Twice through, so every rectangle also damages a pyramid that kept the last pass's result.
+    for (int pass = 0; pass < 2; ++pass) {
+        for (int f = 0; f < IM_ARRAYSIZE(g_script); ++f) {
+            const int seed = pass * IM_ARRAYSIZE(g_script) + f + 1;
+            for (int r = 0; r < 4 && g_script[f][r][2] > g_script[f][r][0]; ++r)
+                frame.redraw(g_script[f][r], seed);
+            run_frame(frame, parameters, g_script[f], true, textures);
+            if (!CHECK(textures[0] != 0 && textures[1] != 0))
+                return;
+
+            read(textures[0], incremental);
+            read(textures[1], full);
+            const int difference = first_difference(incremental, full);
+            if (!CHECK(difference < 0))
+                printf("  algorithm %d radius %g, frame %d of the script: pixel %d, %d differs from the full blur\n",
+                       (int)algorithm, radius, f, difference / 4 % g_width, difference / 4 / g_width);
+        }
+    }
+}
+
+int main() {
+    create_imgui_context();
+    if (!CHECK(blur::setup_cpu()))
+        return report("test_incremental");
+
+    check_script(blur::Algorithm_Kawase, 6.0f);
+    check_script(blur::Algorithm_Kawase, 24.0f);
+    check_script(blur::Algorithm_Gaussian, 2.0f);
+    check_script(blur::Algorithm_Gaussian, 7.0f);
+    check_script(blur::Algorithm_Box, 4.0f);
+    check_script(blur::Algorithm_Box, 20.0f);
+
+    blur::destroy();
+    ImGui::DestroyContext();
+    return report("test_incremental");
+}
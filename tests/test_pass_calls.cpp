@@ -0,0 +1,168 @@
+// Checks blur::BoundState, which decides the binds of every D3D11 pass, then runs blurred frames on the recording
+// backend of tests/recording_backend.h and checks what they cost in calls: the pass graph compiled by the first frame
+// is replayed unchanged by the next one, which creates no constants and no framebuffers; every pass binds its target
+// and input once and draws once per region, the shader only changes between kernels, and chains of a frame share their
+// transient levels. Backends no longer save and restore the renderer's viewport, rasterizer or depth stencil state,
+// they rely on an ImDrawCallback_ResetRenderState after every blur callback, which is checked too.
+//
+//   g++ -std=c++17 -pthread -I. -I<imgui> tests/test_pass_calls.cpp imgui_blur.cpp imgui_blur_shader_cache.cpp
+//       <imgui>/imgui.cpp <imgui>/imgui_draw.cpp <imgui>/imgui_tables.cpp <imgui>/imgui_widgets.cpp
+
+#include "imgui.h"
+#include "imgui_blur.h"
+#include "imgui_blur_internal.h"
+
+#include "recording_backend.h"
+#include "test.h"
+
+static const int g_width = 1280, g_height = 720;
+static const int g_iterations = 4;
+
+// 'chains' blurred panels on the background draw list, each from its own process() call.
+static void run_frame(RecordingBackend& backend, int chains) {
+    begin_frame(g_width, g_height);
+    ImDrawList* draw_list = ImGui::GetBackgroundDrawList();
+    for (int i = 0; i < chains; ++i) {
+        blur::process(draw_list, g_iterations, 2.0f + i, 0.01f, 1.0f);
+        blur::render(draw_list, ImVec2(200.0f, 150.0f), ImVec2(900.0f, 550.0f), 0xFFFFFFFF, 12.0f);
+    }
+
+    backend.reset();
+    render_frame();
+    blur::garbage_collect();
+}
+
+static bool same_passes(const ImVector<RecordingBackend::RecordedPass>& a, const ImVector<RecordingBackend::RecordedPass>& b) {
+    if (a.Size != b.Size)
+        return false;
+    for (int i = 0; i < a.Size; ++i) {
+        if (a[i].chain != b[i].chain || a[i].target != b[i].target || a[i].input != b[i].input || a[i].kernel != b[i].kernel
+            || a[i].width != b[i].width || a[i].height != b[i].height || !(a[i].regions == b[i].regions))
+            return false;
+    }
+    return true;
+}
+
+// The last frame's draw data: one ImDrawCallback_ResetRenderState per process() call and per render() call drawing
+// through the backend's upsample, each right after a blur callback, and none of the blur's state left bound at the end
+// of a draw list.
+static void check_reset_render_state(int expected) {
+    int resets = 0;
+    const ImDrawData* draw_data = ImGui::GetDrawData();
+    for (const ImDrawList* list : draw_data->CmdLists) {
+        bool blur_state = false;
+        bool after_callback = false;
+        for (const ImDrawCmd& cmd : list->CmdBuffer) {
+            if (cmd.UserCallback == ImDrawCallback_ResetRenderState) {
+                CHECK(after_callback);
+                blur_state = false;
+                ++resets;
+            } else if (cmd.UserCallback != nullptr) {
+                blur_state = true;
+            }
+            after_callback = cmd.UserCallback != nullptr && cmd.UserCallback != ImDrawCallback_ResetRenderState;
+        }
+        CHECK(!blur_state);
+    }
+    CHECK(resets == expected);
+}
+
+// blur::BoundState on its own, as Dx11Backend::render_pass() and the recording backend use it.
+static void check_bound_state() {
+    int textures[3], shaders[2], buffers[3];
+    blur::BoundState bound;
+
+    // Everything is bound by the first pass and nothing but the target by the same pass again.
+    blur::PassBinds binds = bound.bind_pass(&textures[1], &textures[0], &shaders[0], &buffers[0], nullptr, 64, 32);
+    CHECK(!binds.unbind_input && binds.viewport && binds.shader && binds.constants && binds.input && !binds.kernel);
+    binds = bound.bind_pass(&textures[1], &textures[0], &shaders[0], &buffers[0], nullptr, 64, 32);
+    CHECK(!binds.unbind_input && !binds.viewport && !binds.shader && !binds.constants && !binds.input && !binds.kernel);
+
+    // The next level reads the last target: the viewport, constants and input change, the shader stays.
+    binds = bound.bind_pass(&textures[2], &textures[1], &shaders[0], &buffers[1], nullptr, 32, 16);
+    CHECK(!binds.unbind_input && binds.viewport && !binds.shader && binds.constants && binds.input);
+
+    // Rendering into the bound input takes it out of its slot first and binds the new input again.
+    binds = bound.bind_pass(&textures[1], &textures[2], &shaders[1], &buffers[1], nullptr, 64, 32);
+    CHECK(binds.unbind_input && binds.viewport && binds.shader && !binds.constants && binds.input);
+
+    // A kernel buffer is bound when it changes and stays bound through passes without one.
+    binds = bound.bind_pass(&textures[2], &textures[1], &shaders[1], &buffers[1], &buffers[2], 32, 16);
+    CHECK(binds.kernel && binds.input);
+    binds = bound.bind_pass(&textures[1], &textures[2], &shaders[0], &buffers[0], nullptr, 64, 32);
+    CHECK(!binds.kernel && binds.unbind_input);
+    binds = bound.bind_pass(&textures[2], &textures[1], &shaders[1], &buffers[1], &buffers[2], 32, 16);
+    CHECK(!binds.kernel);
+
+    bound.forget();
+    binds = bound.bind_pass(&textures[2], &textures[1], &shaders[1], &buffers[1], &buffers[2], 32, 16);
+    CHECK(!binds.unbind_input && binds.viewport && binds.shader && binds.constants && binds.kernel && binds.input);
+}
+
+// Two frames of one chain. Kawase runs a downsample into level 0, 'g_iterations' more and as many upsamples, then the
+// final upsample into the output unless the backend fuses it into blur::render().
+static void check_steady_frames(RecordingBackend& backend, bool fuse_upsample) {
+    backend.fuse_upsample = fuse_upsample;
+    run_frame(backend, 1);
+    const RecordingBackend::Calls first = backend.calls;
+    const ImVector<RecordingBackend::RecordedPass> first_passes = backend.passes;
+
+    run_frame(backend, 1);
+    const RecordingBackend::Calls& second = backend.calls;
+    const int passes = g_iterations * 2 + (fuse_upsample ? 1 : 2);
+    CHECK(first.chains == 1);
+    CHECK(first.passes == passes);
+    CHECK(first.constant_updates <= passes);
+
+    CHECK(second.chains == 1);
+    CHECK(second.passes == passes);
+    CHECK(second.draws == passes);
+    CHECK(second.target_binds == passes);
+    CHECK(second.input_binds == passes);
+    CHECK(second.shader_binds == 2);
+    CHECK(second.viewport_binds <= passes);
+    CHECK(second.constant_binds <= passes);
+    CHECK(second.constant_updates == 0);
+    CHECK(second.framebuffers_created == 0);
+    CHECK(second.upsample_binds == (fuse_upsample ? 1 : 0));
+    CHECK(same_passes(first_passes, backend.passes));
+    check_reset_render_state(fuse_upsample ? 2 : 1);
+}
+
+// Levels past 0 only live while a chain runs, so a second chain renders into the same textures.
+static void check_transient_levels(RecordingBackend& backend) {
+    backend.fuse_upsample = false;
+    run_frame(backend, 2);
+    run_frame(backend, 2);
+    const RecordingBackend::Calls& calls = backend.calls;
+    CHECK(calls.chains == 2);
+    CHECK(calls.framebuffers_created == 0);
+    check_reset_render_state(2);
+
+    const int passes = g_iterations * 2 + 2;
+    if (!CHECK(backend.passes.Size == passes * 2))
+        return;
+    const RecordingBackend::RecordedPass* a = &backend.passes[0];
+    const RecordingBackend::RecordedPass* b = &backend.passes[passes];
+    CHECK(a[0].target != b[0].target);
+    for (int i = 1; i <= g_iterations; ++i)
+        CHECK(a[i].target == b[i].target);
+}
+
+int main() {
+    create_imgui_context();
+    check_bound_state();
+
+    RecordingBackend* backend = IM_NEW(RecordingBackend);
+    backend->source_width = g_width;
+    backend->source_height = g_height;
+    blur::set_backend(backend);
+
+    check_steady_frames(*backend, false);
+    check_steady_frames(*backend, true);
+    check_transient_levels(*backend);
+
+    blur::destroy();
+    ImGui::DestroyContext();
+    return report("test_pass_calls");
+}
@@ -0,0 +1,113 @@
+// Checks how the core picks the format of each pyramid level (blur::level_format()): PyramidFormat_Auto follows the
+// captured frame, levels from deep_level on take deep_format, and formats the backend cannot render to fall back to
+// RGBA8, sRGB encoded behind sRGB targets. Then blurs frames on the recording backend of tests/recording_backend.h and
+// checks the formats of the levels it creates.
+//
+//   g++ -std=c++17 -pthread -I. -I<imgui> tests/test_pyramid_format.cpp imgui_blur.cpp
+//       <imgui>/imgui.cpp <imgui>/imgui_draw.cpp <imgui>/imgui_tables.cpp <imgui>/imgui_widgets.cpp
+
+#include "imgui.h"
+#include "imgui_blur.h"
+#include "imgui_blur_internal.h"
+
+#include "recording_backend.h"
+#include "test.h"
+
+static const int g_all_formats = (1 << blur::Format_COUNT) - 1;
+
+static blur::Format level_format(RecordingBackend& backend, blur::PyramidFormat format, blur::Format source, int level = 0,
+                                 blur::PyramidFormat deep_format = blur::PyramidFormat_Auto, int deep_level = 2) {
+    blur::BlurParameters parameters;
+    parameters.format = format;
+    parameters.deep_format = deep_format;
+    parameters.deep_level = deep_level;
+    return blur::level_format(&backend, parameters, source, level);
+}
+
+static void check_auto() {
+    RecordingBackend backend;
+    backend.supported_formats = g_all_formats;
+    CHECK(level_format(backend, blur::PyramidFormat_Auto, blur::Format_RGBA8) == blur::Format_RGBA8);
+    CHECK(level_format(backend, blur::PyramidFormat_Auto, blur::Format_RGBA8_SRGB) == blur::Format_RGBA8_SRGB);
+    CHECK(level_format(backend, blur::PyramidFormat_Auto, blur::Format_RGB10A2) == blur::Format_RGB10A2);
+    CHECK(level_format(backend, blur::PyramidFormat_Auto, blur::Format_RGBA16F) == blur::Format_R11G11B10F);
+    CHECK(level_format(backend, blur::PyramidFormat_Auto, blur::Format_R11G11B10F) == blur::Format_R11G11B10F);
+}
+
+static void check_requested() {
+    RecordingBackend backend;
+    backend.supported_formats = g_all_formats;
+    CHECK(level_format(backend, blur::PyramidFormat_RGBA16F, blur::Format_RGBA8) == blur::Format_RGBA16F);
+    CHECK(level_format(backend, blur::PyramidFormat_RGBA8, blur::Format_RGBA16F) == blur::Format_RGBA8);
+    CHECK(level_format(backend, blur::PyramidFormat_RGBA8, blur::Format_RGBA8_SRGB) == blur::Format_RGBA8_SRGB);
+
+    // Levels before deep_level keep the format, Auto as deep_format keeps it everywhere.
+    for (int level = 0; level < 5; ++level) {
+        const blur::Format deep = level_format(backend, blur::PyramidFormat_RGBA8, blur::Format_RGBA8, level, blur::PyramidFormat_RGB565, 2);
+        CHECK(deep == (level < 2 ? blur::Format_RGBA8 : blur::Format_RGB565));
+        const blur::Format same = level_format(backend, blur::PyramidFormat_RGB10A2, blur::Format_RGBA8, level, blur::PyramidFormat_Auto, 2);
+        CHECK(same == blur::Format_RGB10A2);
+    }
+}
+
+static void check_fallback() {
+    RecordingBackend backend;
+    backend.supported_formats = (1 << blur::Format_RGBA8) | (1 << blur::Format_RGBA8_SRGB);
+    CHECK(level_format(backend, blur::PyramidFormat_Auto, blur::Format_RGB10A2) == blur::Format_RGBA8);
+    CHECK(level_format(backend, blur::PyramidFormat_RGB565, blur::Format_RGBA8) == blur::Format_RGBA8);
+    CHECK(level_format(backend, blur::PyramidFormat_R11G11B10F, blur::Format_RGBA8_SRGB) == blur::Format_RGBA8_SRGB);
+
+    // Without sRGB levels, sRGB frames blur their encoded values.
+    backend.supported_formats = 1 << blur::Format_RGBA8;
+    CHECK(level_format(backend, blur::PyramidFormat_Auto, blur::Format_RGBA8_SRGB) == blur::Format_RGBA8);
+}
+
+static void run_frame(RecordingBackend& backend) {
+    begin_frame(1280, 720);
+    ImDrawList* draw_list = ImGui::GetBackgroundDrawList();
+    blur::process(draw_list, 4, 2.0f, 0.01f, 1.0f);
+    blur::render(draw_list, ImVec2(200.0f, 100.0f), ImVec2(1000.0f, 600.0f), 0xFFFFFFFF, 12.0f);
+
+    backend.source_width = 1280;
+    backend.source_height = 720;
+    backend.reset();
+    render_frame();
+}
+
+// Four iterations make five levels: 0 and 1 in the frame's format, 2 to 4 in the deep format. Changing the format
+// takes effect on the next process() and replaces every level.
+static void check_frames(RecordingBackend& backend) {
+    backend.supported_formats = g_all_formats;
+    backend.source_format = blur::Format_RGB10A2;
+    blur::set_pyramid_format(blur::PyramidFormat_Auto, blur::PyramidFormat_RGB565, 2);
+    run_frame(backend);
+    CHECK(backend.calls.formats_created[blur::Format_RGB565] == 3);
+    CHECK(backend.calls.formats_created[blur::Format_RGB10A2] >= 2);
+    CHECK(backend.calls.formats_created[blur::Format_RGB10A2] + backend.calls.formats_created[blur::Format_RGB565] == backend.calls.framebuffers_created);
+
+    blur::set_pyramid_format(blur::PyramidFormat_RGBA8);
+    run_frame(backend);
+    CHECK(backend.calls.formats_created[blur::Format_RGBA8] >= 5);
+    CHECK(backend.calls.formats_created[blur::Format_RGBA8] == backend.calls.framebuffers_created);
+
+    // A backend that only renders RGBA8 gets RGBA8 whatever was asked for, the levels of the last frame stay.
+    blur::set_pyramid_format(blur::PyramidFormat_RGBA16F, blur::PyramidFormat_RGB565, 1);
+    backend.supported_formats = 1 << blur::Format_RGBA8;
+    run_frame(backend);
+    CHECK(backend.calls.framebuffers_created == 0);
+}
+
+int main() {
+    create_imgui_context();
+    check_auto();
+    check_requested();
+    check_fallback();
+
+    RecordingBackend* backend = IM_NEW(RecordingBackend);
+    blur::set_backend(backend);
+    check_frames(*backend);
+
+    blur::destroy();
+    ImGui::DestroyContext();
+    return report("test_pyramid_format");
+}
@@ -0,0 +1,112 @@
+// Runs the draw callback of one frame on a second thread and holds it inside a pass while the main thread records the
+// next frame: process() and get_texture() on the chain being run have to return before the pass is let go, and the
+// result of the run is kept once it ends. A pass left waiting for two seconds counts as a recording thread that
+// waited for the chain.
+//
+//   g++ -std=c++17 -pthread -I. -I<imgui> tests/test_render_overlap.cpp imgui_blur.cpp
+//       <imgui>/imgui.cpp <imgui>/imgui_draw.cpp <imgui>/imgui_tables.cpp <imgui>/imgui_widgets.cpp
+
+#include "imgui.h"
+#include "imgui_blur.h"
+#include "imgui_blur_internal.h"
+
+#include "recording_backend.h"
+#include "test.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+static const int g_width = 640, g_height = 360;
+
+// Holds the first pass of a chain until released, or until two seconds went by.
+class BlockingBackend : public RecordingBackend {
+public:
+    void render_pass(const blur::Framebuffer& target, const blur::Framebuffer& input, blur::Kernel kernel, float offset, float noise, const blur::RegionSet& regions) override {
+        if (block.exchange(false)) {
+            entered.store(true);
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+            while (!released.load() && std::chrono::steady_clock::now() < deadline)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            timed_out.store(!released.load());
+        }
+        RecordingBackend::render_pass(target, input, kernel, offset, noise, regions);
+    }
+
+    std::atomic<bool> block{ false };
+    std::atomic<bool> entered{ false };
+    std::atomic<bool> released{ false };
+    std::atomic<bool> timed_out{ false };
+};
+
+static blur::Snapshot record(ImTextureID& texture) {
+    begin_frame(g_width, g_height);
+    const blur::Snapshot snapshot = blur::process(ImGui::GetBackgroundDrawList(), 3, 2.0f, 0.0f, 1.0f);
+    blur::add_region(snapshot, ImVec2(0.0f, 0.0f), ImVec2((float)g_width, (float)g_height));
+    texture = blur::get_texture(snapshot);
+    return snapshot;
+}
+
+// The blur callback of the frame ImGui::Render() just finished, copied so NewFrame() can reuse the draw lists.
+static bool find_callback(ImDrawCmd& out) {
+    for (ImDrawList* list : ImGui::GetDrawData()->CmdLists) {
+        for (const ImDrawCmd& cmd : list->CmdBuffer) {
+            if (cmd.UserCallback != nullptr && cmd.UserCallback != ImDrawCallback_ResetRenderState) {
+                out = cmd;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+int main() {
+    create_imgui_context();
+    BlockingBackend* backend = IM_NEW(BlockingBackend);
+    backend->source_width = g_width;
+    backend->source_height = g_height;
+    blur::set_backend(backend);
+
+    // The pyramid and the output exist from here on, so the next frames allocate nothing.
+    ImTextureID texture = 0;
+    record(texture);
+    render_frame();
+    CHECK(texture != 0);
+
+    ImTextureID running_texture = 0;
+    record(running_texture);
+    ImGui::Render();
+    ImDrawCmd callback;
+    if (!CHECK(find_callback(callback))) {
+        blur::destroy();
+        ImGui::DestroyContext();
+        return report("test_render_overlap");
+    }
+
+    backend->block.store(true);
+    std::thread render_thread([&callback] { callback.UserCallback(nullptr, &callback); });
+    while (!backend->entered.load())
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    // The same parameters claim the chain the other thread is running.
+    ImTextureID next_texture = 0;
+    const blur::Snapshot snapshot = record(next_texture);
+    const bool recorded_during_run = !backend->timed_out.load();
+    backend->released.store(true);
+    render_thread.join();
+
+    CHECK(snapshot != 0);
+    CHECK(recorded_during_run);
+    CHECK(next_texture == running_texture && running_texture == texture);
+    CHECK(backend->calls.chains == 2);
+
+    // The run stored its result, so the frame being recorded still blurs with the same chain.
+    backend->reset();
+    render_frame();
+    CHECK(backend->calls.chains == 1);
+    CHECK(backend->calls.framebuffers_created == 0);
+
+    blur::destroy();
+    ImGui::DestroyContext();
+    return report("test_render_overlap");
+}
@@ -0,0 +1,194 @@
+// Checks the kernel tables of imgui_blur_kernels.h against a gaussian computed in double precision: every bilinear tap
+// of the gaussian family expands back to the texel weights of a gaussian truncated at its reach, the fixed point
+// weights stay within one step of them, and the three box widths are odd and add up to the variance. Then blurs a frame
+// with Algorithm_Gaussian and Algorithm_Box on the CPU backend and compares it with the reference gaussian blur.
+//
+//   g++ -std=c++17 -pthread -I. -I<imgui> tests/test_separable_kernels.cpp imgui_blur.cpp imgui_blur_cpu.cpp
+//       imgui_blur_shader_cache.cpp <imgui>/imgui.cpp <imgui>/imgui_draw.cpp <imgui>/imgui_tables.cpp <imgui>/imgui_widgets.cpp
+
+#include "imgui.h"
+#include "imgui_blur.h"
+#include "imgui_blur_internal.h"
+
+#include "test.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+
+static const int g_width = 192, g_height = 112;
+
+// Weights of texels 0 to 'reach' of a gaussian truncated at 'reach', normalized over both sides.
+static std::vector<double> reference_weights(double sigma, int reach) {
+    std::vector<double> weights(reach + 1);
+    double total = 0.0;
+    for (int d = 0; d <= reach; ++d) {
+        weights[d] = exp(-d * d / (2.0 * sigma * sigma));
+        total += d == 0 ? weights[d] : weights[d] * 2.0;
+    }
+    for (double& weight : weights)
+        weight /= total;
+    return weights;
+}
+
+// A bilinear tap at offset o between texels 2i - 1 and 2i reads them with (2i - o) and (o - 2i + 1) of its weight.
+static void check_gaussian_tables() {
+    for (const blur::GaussianKernel& kernel : blur::gaussian_family.kernels) {
+        CHECK(kernel.reach == (int)ceil(kernel.sigma * 3.0 - 0.001));
+        CHECK(kernel.tap_count == 1 + (kernel.reach + 1) / 2);
+        const std::vector<double> reference = reference_weights(kernel.sigma, kernel.reach);
+
+        std::vector<double> texels(kernel.tap_count * 2, 0.0);
+        texels[0] = kernel.weights[0];
+        int fixed_total = kernel.fixed_weights[0];
+        for (int i = 1; i < kernel.tap_count; ++i) {
+            const double far_share = kernel.offsets[i] - (2 * i - 1);
+            CHECK(far_share >= 0.0 && far_share <= 1.0);
+            texels[2 * i - 1] += kernel.weights[i] * (1.0 - far_share);
+            texels[2 * i] += kernel.weights[i] * far_share;
+            fixed_total += kernel.fixed_weights[i] * 2;
+        }
+        for (int d = 0; d <= kernel.reach; ++d) {
+            if (!CHECK(fabs(texels[d] - reference[d]) < 1e-5))
+                printf("  sigma %g, texel %d: %g instead of %g\n", kernel.sigma, d, texels[d], reference[d]);
+        }
+
+        CHECK(fixed_total == blur::gaussian_fixed_total);
+        for (int i = 0; i < kernel.tap_count; ++i)
+            CHECK(fabs(kernel.fixed_weights[i] - kernel.weights[i] * blur::gaussian_fixed_total) <= 1.0);
+    }
+
+    CHECK(&blur::gaussian_kernel(0.1f) == &blur::gaussian_family.kernels[0]);
+    CHECK(blur::gaussian_kernel(3.0f).sigma == 3.0f);
+    CHECK(blur::gaussian_kernel(100.0f).sigma == blur::max_gaussian_sigma);
+}
+
+// A box of odd width w has the variance (w² - 1) / 12. Kovesi's widths get within a third of a texel of sigma from 3
+// texels on, the smallest radius Algorithm_Auto picks the box blur for.
+static void check_box_widths() {
+    for (float sigma = 0.5f; sigma <= 64.0f; sigma += 0.25f) {
+        const blur::BoxKernel kernel = blur::make_box_kernel(sigma);
+        double variance = 0.0;
+        int reach = 0;
+        for (int width : kernel.widths) {
+            CHECK(width % 2 == 1);
+            CHECK(width == kernel.widths[0] || width == kernel.widths[0] + 2);
+            variance += (width * width - 1) / 12.0;
+            reach += width / 2;
+        }
+        CHECK(kernel.reach == reach);
+        if (sigma >= 3.0f && !CHECK(fabs(sqrt(variance) - sigma) < 0.34))
+            printf("  sigma %g: the boxes %d %d %d make %g\n", sigma, kernel.widths[0], kernel.widths[1], kernel.widths[2], sqrt(variance));
+    }
+}
+
+static int mirror(int i, int size) {
+    const int period = size * 2;
+    i %= period;
+    if (i < 0) i += period;
+    return i < size ? i : period - 1 - i;
+}
+
+// RGB of a gaussian of 'sigma' pixels over an RGBA8 frame, mirrored at the edges like the backends sample it. Truncated
+// at four standard deviations rather than the three the kernels stop at, so their truncation counts as error too.
+static void reference_blur(const std::vector<unsigned char>& frame, double sigma, std::vector<double>& out) {
+    const std::vector<double> weights = reference_weights(sigma, (int)ceil(sigma * 4.0));
+    const int reach = (int)weights.size() - 1;
+    std::vector<double> horizontal((size_t)g_width * g_height * 3, 0.0);
+    for (int y = 0; y < g_height; ++y) {
+        for (int x = 0; x < g_width; ++x) {
+            for (int d = -reach; d <= reach; ++d) {
+                const unsigned char* texel = &frame[((size_t)y * g_width + mirror(x + d, g_width)) * 4];
+                for (int c = 0; c < 3; ++c)
+                    horizontal[((size_t)y * g_width + x) * 3 + c] += texel[c] * weights[d < 0 ? -d : d];
+            }
+        }
+    }
+
+    out.assign((size_t)g_width * g_height * 3, 0.0);
+    for (int y = 0; y < g_height; ++y) {
+        for (int x = 0; x < g_width; ++x) {
+            for (int d = -reach; d <= reach; ++d) {
+                const double* texel = &horizontal[((size_t)mirror(y + d, g_height) * g_width + x) * 3];
+                for (int c = 0; c < 3; ++c)
+                    out[((size_t)y * g_width + x) * 3 + c] += texel[c] * weights[d < 0 ? -d : d];
+            }
+        }
+    }
+}
+
+// Soft gradients under hard edged squares, so both the flat and the steep parts count.
+static void fill_frame(std::vector<unsigned char>& frame) {
+    frame.resize((size_t)g_width * g_height * 4);
+    for (int y = 0; y < g_height; ++y) {
+        for (int x = 0; x < g_width; ++x) {
+            unsigned char* pixel = &frame[((size_t)y * g_width + x) * 4];
+            const bool square = ((x / 24) + (y / 24)) % 3 == 0;
+            pixel[0] = (unsigned char)(square ? 240 : x * 200 / g_width);
+            pixel[1] = (unsigned char)(square ? 16 : y * 200 / g_height);
+            pixel[2] = (unsigned char)(square ? 128 : 60);
+            pixel[3] = 255;
+        }
+    }
+}
+
+// RMS and max error of every output pixel, in 8 bit steps.
+static void check_output(std::vector<unsigned char>& frame, blur::Algorithm algorithm, float radius, double max_rms, double max_error) {
+    blur::AdaptiveParameters parameters;
+    parameters.budget_ms = 0.0f;
+    parameters.radius = radius;
+    parameters.noise = 0.0f;
+    parameters.algorithm = algorithm;
+
+    begin_frame(g_width, g_height);
+    const blur::Snapshot snapshot = blur::process(ImGui::GetBackgroundDrawList(), parameters);
+    blur::add_region(snapshot, ImVec2(0.0f, 0.0f), ImVec2((float)g_width, (float)g_height));
+    const ImTextureID texture = blur::get_texture(snapshot);
+    blur::CpuImage target;
+    target.pixels = frame.data();
+    target.width = g_width;
+    target.height = g_height;
+    target.stride = g_width * 4;
+    blur::set_cpu_target(target);
+    render_frame();
+    if (!CHECK(texture != 0))
+        return;
+
+    std::vector<double> reference;
+    reference_blur(frame, radius, reference);
+    const blur::CpuImage& output = *(const blur::CpuImage*)(intptr_t)texture;
+    double squares = 0.0, largest = 0.0;
+    for (int y = 0; y < g_height; ++y) {
+        for (int x = 0; x < g_width; ++x) {
+            for (int c = 0; c < 3; ++c) {
+                const double error = fabs(output.pixels[(size_t)y * output.stride + x * 4 + c] - reference[((size_t)y * g_width + x) * 3 + c]);
+                squares += error * error;
+                largest = error > largest ? error : largest;
+            }
+        }
+    }
+    const double rms = sqrt(squares / ((double)g_width * g_height * 3));
+    if (!CHECK(rms <= max_rms && largest <= max_error))
+        printf("  algorithm %d radius %g: RMS %.3f, max %.1f\n", (int)algorithm, radius, rms, largest);
+}
+
+int main() {
+    create_imgui_context();
+    check_gaussian_tables();
+    check_box_widths();
+
+    if (!CHECK(blur::setup_cpu()))
+        return report("test_separable_kernels");
+    std::vector<unsigned char> frame;
+    fill_frame(frame);
+    for (float radius : { 0.5f, 1.0f, 2.0f, 3.5f, 5.0f, 8.0f })
+        check_output(frame, blur::Algorithm_Gaussian, radius, 0.6, 4.0);
+    for (float radius : { 3.0f, 6.0f, 12.0f, 24.0f })
+        check_output(frame, blur::Algorithm_Box, radius, 1.0, 6.0);
+
+    blur::destroy();
+    ImGui::DestroyContext();
+    return report("test_separable_kernels");
+}
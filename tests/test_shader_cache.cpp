@@ -0,0 +1,262 @@
+// Checks blur::ShaderLibrary (imgui_blur_shader_cache.cpp) against a stub compiler: a miss compiles and writes the
+// cache, a hit loads it without compiling, a new compiler version or a damaged, truncated or foreign cache file compiles
+// again without allocating what a damaged size claims, embedded blobs are only used for the compiler version they were
+// built with, and blur::get_setup_report() counts each load where it came from. Writes to a temporary directory, which
+// has to be empty again once the cache files are removed. POSIX only.
+//
+//   g++ -std=c++17 -I. -I<imgui> tests/test_shader_cache.cpp imgui_blur_shader_cache.cpp
+//       <imgui>/imgui.cpp <imgui>/imgui_draw.cpp <imgui>/imgui_tables.cpp <imgui>/imgui_widgets.cpp
+
+#include "imgui.h"
+#include "imgui_blur.h"
+#include "imgui_blur_internal.h"
+
+#include "test.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// "Bytecode" naming what it was compiled from and with which version.
+class StubCompiler : public blur::ShaderCompiler {
+public:
+    ImU64 version() override { return compiler_version; }
+
+    bool compile(const blur::ShaderSource& shader, ImVector<unsigned char>& bytecode) override {
+        ++compiles;
+        if (fail)
+            return false;
+
+        char text[256];
+        snprintf(text, sizeof(text), "%s/%s/%s/%llu", shader.source, shader.entry, shader.target, (unsigned long long)compiler_version);
+        bytecode.resize((int)strlen(text));
+        memcpy(bytecode.Data, text, (size_t)bytecode.Size);
+        return true;
+    }
+
+    ImU64 compiler_version = 1;
+    int compiles = 0;
+    bool fail = false;
+};
+
+static const blur::ShaderSource g_shader = { "downsample", "float4 main() : SV_Target { return 0; }", "main", "ps_4_0" };
+static const blur::ShaderSource g_variant = { "downsample", "float4 main() : SV_Target { return 0; }", "main", "ps_5_0" };
+
+static char g_directory[64] = "/tmp/imgui_blur_test_XXXXXX";
+
+// The largest allocation made through ImGui since it was last reset.
+static size_t g_largest_allocation = 0;
+
+static void* counting_alloc(size_t size, void*) {
+    g_largest_allocation = size > g_largest_allocation ? size : g_largest_allocation;
+    return malloc(size);
+}
+
+static void counting_free(void* pointer, void*) {
+    free(pointer);
+}
+
+static void cache_file(char* path, size_t path_size, const blur::ShaderSource& shader, ImU64 version) {
+    snprintf(path, path_size, "%s/imgui_blur_%016llx.cso", g_directory, (unsigned long long)blur::shader_key(shader, version));
+}
+
+static bool file_exists(const blur::ShaderSource& shader, ImU64 version) {
+    char path[128];
+    cache_file(path, sizeof(path), shader, version);
+    FILE* file = fopen(path, "rb");
+    if (file != nullptr)
+        fclose(file);
+    return file != nullptr;
+}
+
+static long file_size(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr)
+        return -1;
+    fseek(file, 0, SEEK_END);
+    const long size = ftell(file);
+    fclose(file);
+    return size;
+}
+
+// Overwrites 'count' bytes at 'offset' from the end of the cache file, or cuts that many off when 'cut' is set.
+static void damage_file(const blur::ShaderSource& shader, ImU64 version, long offset, long count, bool cut) {
+    char path[128];
+    cache_file(path, sizeof(path), shader, version);
+    const long size = file_size(path);
+    if (cut) {
+        CHECK(truncate(path, size - count) == 0);
+        return;
+    }
+
+    FILE* file = fopen(path, "r+b");
+    if (!CHECK(file != nullptr))
+        return;
+    fseek(file, size - offset, SEEK_SET);
+    for (long i = 0; i < count; ++i)
+        fputc(0x5A, file);
+    fclose(file);
+}
+
+static bool same_bytes(const ImVector<unsigned char>& a, const ImVector<unsigned char>& b) {
+    return a.Size == b.Size && memcmp(a.Data, b.Data, (size_t)a.Size) == 0;
+}
+
+// Loads 'shader' through a fresh library and returns what the setup report counted for it.
+static blur::SetupReport load(StubCompiler& compiler, const blur::ShaderSource& shader, ImVector<unsigned char>& bytecode, bool expect_success = true,
+                              const blur::PrecompiledShader* precompiled = nullptr, int precompiled_count = 0) {
+    blur::begin_setup_report();
+    blur::ShaderLibrary library(&compiler, precompiled, precompiled_count);
+    CHECK(library.load(shader, bytecode) == expect_success);
+    blur::end_setup_report();
+    return blur::get_setup_report();
+}
+
+static void check_keys() {
+    const ImU64 key = blur::shader_key(g_shader, 1);
+    CHECK(key == blur::shader_key(g_shader, 1));
+    CHECK(key != blur::shader_key(g_shader, 2));
+    CHECK(key != blur::shader_key(g_variant, 1));
+
+    // Fields are separated, moving characters from one into the next changes the key.
+    const blur::ShaderSource shifted = { "downsample", "float4 main() : SV_Target { return 0; }m", "ain", "ps_4_0" };
+    CHECK(key != blur::shader_key(shifted, 1));
+}
+
+static void check_cache() {
+    StubCompiler compiler;
+    ImVector<unsigned char> compiled, loaded;
+
+    // Miss: compiled and written back.
+    blur::SetupReport report = load(compiler, g_shader, compiled);
+    CHECK(compiler.compiles == 1 && report.compiled == 1 && report.cached == 0);
+    CHECK(file_exists(g_shader, 1));
+
+    // Hit: the same bytecode without compiling.
+    report = load(compiler, g_shader, loaded);
+    CHECK(compiler.compiles == 1 && report.cached == 1 && report.compiled == 0);
+    CHECK(same_bytes(compiled, loaded));
+
+    // Another variant of the same shader has its own entry.
+    report = load(compiler, g_variant, loaded);
+    CHECK(compiler.compiles == 2 && report.compiled == 1);
+    CHECK(!same_bytes(compiled, loaded));
+
+    // A new compiler version ignores the old file and writes its own.
+    compiler.compiler_version = 2;
+    report = load(compiler, g_shader, loaded);
+    CHECK(compiler.compiles == 3 && report.compiled == 1 && report.cached == 0);
+    CHECK(!same_bytes(compiled, loaded));
+    CHECK(file_exists(g_shader, 2));
+    report = load(compiler, g_shader, compiled);
+    CHECK(compiler.compiles == 3 && report.cached == 1);
+    CHECK(same_bytes(compiled, loaded));
+}
+
+// Every kind of damage compiles again and rewrites the file, which the next load hits.
+static void check_damage() {
+    StubCompiler compiler;
+    compiler.compiler_version = 3;
+    ImVector<unsigned char> compiled, loaded;
+    load(compiler, g_shader, compiled);
+
+    class Damage {
+    public:
+        const char* name;
+        long offset; // from the end of the file
+        long count;
+        bool cut;
+    };
+    const long file_bytes = 24 + compiled.Size; // a 24 byte header, then the bytecode
+    const Damage damages[] = {
+        { "last byte of the bytecode", 1, 1, false },
+        { "first byte of the bytecode", compiled.Size, 1, false },
+        { "truncated bytecode", 0, 3, true },
+        { "truncated header", 0, file_bytes - 10, true },
+        { "magic", file_bytes, 4, false },
+        { "size", file_bytes - 4, 4, false },
+    };
+    for (const Damage& damage : damages) {
+        damage_file(g_shader, 3, damage.offset, damage.count, damage.cut);
+        const int compiles = compiler.compiles;
+        g_largest_allocation = 0;
+        blur::SetupReport report = load(compiler, g_shader, loaded);
+        if (!CHECK(compiler.compiles == compiles + 1 && report.compiled == 1 && report.cached == 0))
+            printf("  not compiled again after damaging the %s\n", damage.name);
+        CHECK(g_largest_allocation < 4096);
+        CHECK(same_bytes(compiled, loaded));
+
+        report = load(compiler, g_shader, loaded);
+        CHECK(compiler.compiles == compiles + 1 && report.cached == 1);
+        CHECK(same_bytes(compiled, loaded));
+    }
+}
+
+static void check_embedded() {
+    StubCompiler compiler;
+    compiler.compiler_version = 4;
+    static const unsigned char blob[] = { 1, 2, 3, 4 };
+    const blur::PrecompiledShader precompiled[] = {
+        { "downsample", blur::shader_key(g_shader, 4), blob, sizeof(blob), 12.0f },
+        { "downsample", blur::shader_key(g_variant, 3), blob, sizeof(blob), 12.0f },
+    };
+    ImVector<unsigned char> loaded;
+
+    blur::SetupReport report = load(compiler, g_shader, loaded, true, precompiled, IM_ARRAYSIZE(precompiled));
+    CHECK(compiler.compiles == 0 && report.embedded == 1 && report.saved_ms > 0.0f);
+    CHECK(loaded.Size == (int)sizeof(blob) && memcmp(loaded.Data, blob, sizeof(blob)) == 0);
+
+    // Built by another compiler version: stale, compiled instead.
+    report = load(compiler, g_variant, loaded, true, precompiled, IM_ARRAYSIZE(precompiled));
+    CHECK(compiler.compiles == 1 && report.embedded == 0 && report.compiled == 1);
+}
+
+static void check_failures() {
+    StubCompiler compiler;
+    compiler.compiler_version = 5;
+    compiler.fail = true;
+    ImVector<unsigned char> bytecode;
+    blur::SetupReport report = load(compiler, g_shader, bytecode, false);
+    CHECK(compiler.compiles == 1 && report.compiled == 0);
+    CHECK(!file_exists(g_shader, 5));
+
+    // Without a cache directory every load compiles.
+    compiler.fail = false;
+    blur::set_shader_cache_path(nullptr);
+    load(compiler, g_shader, bytecode);
+    report = load(compiler, g_shader, bytecode);
+    CHECK(compiler.compiles == 3 && report.compiled == 1 && report.cached == 0);
+    CHECK(!file_exists(g_shader, 5));
+}
+
+static void remove_cache_files() {
+    const blur::ShaderSource* shaders[] = { &g_shader, &g_variant };
+    for (const blur::ShaderSource* shader : shaders) {
+        for (ImU64 version = 1; version <= 5; ++version) {
+            char path[128];
+            cache_file(path, sizeof(path), *shader, version);
+            remove(path);
+        }
+    }
+    CHECK(rmdir(g_directory) == 0); // no temporary file left behind
+}
+
+int main() {
+    // ImVector allocates through ImGui.
+    ImGui::SetAllocatorFunctions(counting_alloc, counting_free);
+    ImGui::CreateContext();
+    if (!CHECK(mkdtemp(g_directory) != nullptr))
+        return report("test_shader_cache");
+    blur::set_shader_cache_path(g_directory);
+
+    check_keys();
+    check_cache();
+    check_damage();
+    check_embedded();
+    check_failures();
+
+    remove_cache_files();
+    ImGui::DestroyContext();
+    return report("test_shader_cache");
+}
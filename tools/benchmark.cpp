@@ -0,0 +1,1162 @@
+// Headless benchmark of the blur pipeline. Drives blur::process() and blur::render() on synthetic animated frames across
+// resolutions (720p to 8K), iterations, scale, offset and noise, and writes per-pass and total times, allocations and
+// framebuffer rebuilds as JSON.
+//
+//   g++ -O2 -std=c++17 -pthread -I. -I<imgui> tools/benchmark.cpp imgui_blur.cpp imgui_blur_cpu.cpp
+//       imgui_blur_shader_cache.cpp <imgui>/imgui.cpp <imgui>/imgui_draw.cpp <imgui>/imgui_tables.cpp <imgui>/imgui_widgets.cpp
+//   OpenGL on EGL (Mesa llvmpipe works without a GPU): add -DIMGUI_BLUR_BENCHMARK_OPENGL3 imgui_blur_opengl3.cpp -lEGL -lGL
+//   Direct3D 11 on WARP: add /DIMGUI_BLUR_BENCHMARK_DX11 imgui_blur_dx11.cpp d3d11.lib
+//
+//   benchmark [--backend cpu|opengl3|dx11] [--sweep axes|full] [--frames N] [--cpu-threads N]
+//             [--output results.json] [--baseline previous.json] [--threshold percent] [--kernels] [--damage]
+//
+// 'axes' varies one parameter at a time around the defaults (1080p, 4 iterations, scale 1, offset 2, noise 0.01),
+// 'full' runs every combination and takes a while on the CPU backend. Total frame times are measured first without
+// interruption; passes are then timed one by one with a device sync around each, so they add up to slightly more.
+// With --baseline every configuration is compared with the same one in the old results, and the exit code is 1 when
+// a median frame time grew by more than the threshold (10% by default).
+//
+// --kernels runs every blur algorithm the backend supports through the adaptive process() over a range of radii at
+// 720p instead, and writes their frame times, which algorithm select_algorithm() would pick, and how far the output
+// is from a gaussian of the same radius computed in double precision (RMS and max error in 8 bit steps).
+//
+// --damage keeps a 1080p frame still except for a few rectangles (about 4% of the pixels), reports them with
+// blur::add_damage() and runs each algorithm with ProcessFlags_Incremental next to the same blur recomputed in full.
+// It writes both frame times and how many output texels differ between the two, which has to be none.
+
+#include "imgui.h"
+#include "imgui_blur.h"
+#include "imgui_blur_internal.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <math.h>
+#include <vector>
+
+#ifdef IMGUI_BLUR_BENCHMARK_OPENGL3
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#define GL_GLEXT_PROTOTYPES
+#include <GL/glcorearb.h>
+#endif
+
+#ifdef IMGUI_BLUR_BENCHMARK_DX11
+#include "imgui_impl_dx11.h"
+#include <d3d11.h>
+#pragma comment(lib, "d3d11.lib")
+#endif
+
+typedef std::chrono::steady_clock Clock;
+
+static double elapsed_ms(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static std::atomic<int> g_allocations{ 0 };
+
+static void* counting_alloc(size_t size, void*) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return malloc(size);
+}
+
+static void counting_free(void* ptr, void*) {
+    free(ptr);
+}
+
+// Moving gradients and a scrolling checker pattern, so every frame differs everywhere inside [x0, x1) x [y0, y1).
+static void fill_rect(unsigned char* pixels, int width, int height, int stride, int x0, int y0, int x1, int y1, int frame) {
+    for (int y = y0; y < y1; ++y) {
+        unsigned char* row = pixels + (size_t)y * stride;
+        for (int x = x0; x < x1; ++x) {
+            const int u = x + frame * 7;
+            const int v = y + frame * 3;
+            row[x * 4 + 0] = (unsigned char)(u * 255 / (width + 1));
+            row[x * 4 + 1] = (unsigned char)(v * 255 / (height + 1));
+            row[x * 4 + 2] = ((u >> 5) ^ (v >> 5)) & 1 ? 230 : 25;
+            row[x * 4 + 3] = 255;
+        }
+    }
+}
+
+static void fill_frame(unsigned char* pixels, int width, int height, int stride, int frame) {
+    fill_rect(pixels, width, height, stride, 0, 0, width, height, frame);
+}
+
+// What the benchmark needs from a backend besides blur itself: somewhere to draw the synthetic frame and a way to
+// wait for the device.
+class Device {
+public:
+    virtual ~Device() {}
+
+    virtual bool setup() = 0;
+    virtual const char* name() = 0;
+    virtual const char* description() = 0;
+    virtual bool resize(int width, int height) = 0;
+    virtual void draw_frame(int frame) = 0;
+    // Redraws the display rectangle [x0, x1) x [y0, y1) of the synthetic frame as it looks at 'frame'.
+    virtual void draw_rect(int x0, int y0, int x1, int y1, int frame) = 0;
+    // Makes the synthetic frame the target the renderer is drawing into, as the ImGui backend would.
+    virtual void bind_target() = 0;
+    virtual void finish() = 0;
+    // The last synthetic frame and the top left of a texture blur::get_texture() returned, as RGBA8 with the top of
+    // the display first. Devices that cannot read textures back return false and --kernels leaves the errors out.
+    virtual void read_frame(std::vector<unsigned char>& out) = 0;
+    virtual bool read_texture(ImTextureID texture, int width, int height, std::vector<unsigned char>& out) = 0;
+};
+
+class CpuDevice : public Device {
+public:
+    explicit CpuDevice(int thread_count) : thread_count(thread_count) {}
+
+    bool setup() override {
+        if (!blur::setup_cpu())
+            return false;
+
+        blur::set_cpu_threads(thread_count);
+        static const char* kernel_names[] = { "auto", "scalar", "sse2", "avx2", "neon" };
+        if (thread_count > 0)
+            snprintf(info, sizeof(info), "%s kernel, %d threads", kernel_names[blur::get_cpu_kernel()], thread_count);
+        else
+            snprintf(info, sizeof(info), "%s kernel, every core", kernel_names[blur::get_cpu_kernel()]);
+        return true;
+    }
+
+    const char* name() override { return "cpu"; }
+    const char* description() override { return info; }
+
+    bool resize(int new_width, int new_height) override {
+        width = new_width;
+        height = new_height;
+        pixels.resize(width * height * 4);
+        return true;
+    }
+
+    void draw_frame(int frame) override {
+        fill_frame(pixels.data(), width, height, width * 4, frame);
+    }
+
+    void draw_rect(int x0, int y0, int x1, int y1, int frame) override {
+        fill_rect(pixels.data(), width, height, width * 4, x0, y0, x1, y1, frame);
+    }
+
+    void bind_target() override {
+        blur::CpuImage target;
+        target.pixels = pixels.data();
+        target.width = width;
+        target.height = height;
+        target.stride = width * 4;
+        blur::set_cpu_target(target);
+    }
+
+    void finish() override {}
+
+    void read_frame(std::vector<unsigned char>& out) override {
+        out = pixels;
+    }
+
+    bool read_texture(ImTextureID texture, int read_width, int read_height, std::vector<unsigned char>& out) override {
+        const blur::CpuImage& image = *(const blur::CpuImage*)(intptr_t)texture;
+        out.resize(read_width * read_height * 4);
+        for (int y = 0; y < read_height; ++y)
+            memcpy(&out[y * read_width * 4], image.pixels + (size_t)y * image.stride, read_width * 4);
+        return true;
+    }
+
+private:
+    int thread_count;
+    int width = 0, height = 0;
+    std::vector<unsigned char> pixels;
+    char info[64] = {};
+};
+
+#ifdef IMGUI_BLUR_BENCHMARK_OPENGL3
+class Gl3Device : public Device {
+public:
+    ~Gl3Device() override {
+        destroy_target();
+        if (display != EGL_NO_DISPLAY) {
+            eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            if (context != EGL_NO_CONTEXT)
+                eglDestroyContext(display, context);
+            eglTerminate(display);
+        }
+    }
+
+    // Surfaceless, so no window system is needed.
+    bool setup() override {
+        display = eglGetPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr) || !eglBindAPI(EGL_OPENGL_API))
+            return false;
+
+        const EGLint context_attributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 3,
+            EGL_CONTEXT_MINOR_VERSION, 3,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE,
+        };
+        context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, context_attributes);
+        if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+            return false;
+
+        snprintf(info, sizeof(info), "%s", (const char*)glGetString(GL_RENDERER));
+        return blur::setup_opengl3();
+    }
+
+    const char* name() override { return "opengl3"; }
+    const char* description() override { return info; }
+
+    bool resize(int new_width, int new_height) override {
+        destroy_target();
+        width = new_width;
+        height = new_height;
+        pixels.resize(width * height * 4);
+
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+        return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    }
+
+    void draw_frame(int frame) override {
+        fill_frame(pixels.data(), width, height, width * 4, frame);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    }
+
+    // The frame is stored bottom row first, see read_frame().
+    void draw_rect(int x0, int y0, int x1, int y1, int frame) override {
+        fill_rect(pixels.data(), width, height, width * 4, x0, height - y1, x1, height - y0, frame);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, x0, height - y1, x1 - x0, y1 - y0, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[((height - y1) * width + x0) * 4]);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    }
+
+    void bind_target() override {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glViewport(0, 0, width, height);
+    }
+
+    void finish() override {
+        glFinish();
+    }
+
+    // The frame was uploaded bottom row first, the blur textures are addressed with the top of the display at v = 0.
+    void read_frame(std::vector<unsigned char>& out) override {
+        out.resize(pixels.size());
+        for (int y = 0; y < height; ++y)
+            memcpy(&out[y * width * 4], &pixels[(height - 1 - y) * width * 4], width * 4);
+    }
+
+    bool read_texture(ImTextureID id, int read_width, int read_height, std::vector<unsigned char>& out) override {
+        GLuint read_framebuffer = 0;
+        glGenFramebuffers(1, &read_framebuffer);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, read_framebuffer);
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, (GLuint)(intptr_t)id, 0);
+        out.resize(read_width * read_height * 4);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, read_width, read_height, GL_RGBA, GL_UNSIGNED_BYTE, out.data());
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &read_framebuffer);
+        return glGetError() == GL_NO_ERROR;
+    }
+
+private:
+    void destroy_target() {
+        if (framebuffer != 0) { glDeleteFramebuffers(1, &framebuffer); framebuffer = 0; }
+        if (texture != 0) { glDeleteTextures(1, &texture); texture = 0; }
+    }
+
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+    GLuint texture = 0;
+    GLuint framebuffer = 0;
+    int width = 0, height = 0;
+    std::vector<unsigned char> pixels;
+    char info[128] = {};
+};
+#endif
+
+#ifdef IMGUI_BLUR_BENCHMARK_DX11
+class Dx11Device : public Device {
+public:
+    ~Dx11Device() override {
+        destroy_target();
+        if (event_query) event_query->Release();
+        if (device_context) device_context->Release();
+        if (device) device->Release();
+    }
+
+    // WARP is the software rasterizer every Windows install ships with.
+    bool setup() override {
+        const D3D_FEATURE_LEVEL feature_levels[] = { D3D_FEATURE_LEVEL_11_0, D3D_FEATURE_LEVEL_10_0 };
+        if (FAILED(D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_WARP, nullptr, 0, feature_levels, IM_ARRAYSIZE(feature_levels), D3D11_SDK_VERSION, &device, nullptr, &device_context)))
+            return false;
+
+        D3D11_QUERY_DESC query_desc = {};
+        query_desc.Query = D3D11_QUERY_EVENT;
+        if (FAILED(device->CreateQuery(&query_desc, &event_query)))
+            return false;
+
+        // What imgui_impl_dx11 hands to draw callbacks.
+        render_state = {};
+        render_state.Device = device;
+        render_state.DeviceContext = device_context;
+        ImGui::GetPlatformIO().Renderer_RenderState = &render_state;
+        return blur::setup(device, device_context);
+    }
+
+    const char* name() override { return "dx11"; }
+    const char* description() override { return "WARP"; }
+
+    bool resize(int new_width, int new_height) override {
+        destroy_target();
+        width = new_width;
+        height = new_height;
+        pixels.resize(width * height * 4);
+
+        D3D11_TEXTURE2D_DESC tex_desc = {};
+        tex_desc.Width = width;
+        tex_desc.Height = height;
+        tex_desc.MipLevels = 1;
+        tex_desc.ArraySize = 1;
+        tex_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+        tex_desc.SampleDesc.Count = 1;
+        tex_desc.Usage = D3D11_USAGE_DEFAULT;
+        tex_desc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+        if (FAILED(device->CreateTexture2D(&tex_desc, nullptr, &texture)))
+            return false;
+
+        return SUCCEEDED(device->CreateRenderTargetView(texture, nullptr, &rtv));
+    }
+
+    void draw_frame(int frame) override {
+        fill_frame(pixels.data(), width, height, width * 4, frame);
+        device_context->UpdateSubresource(texture, 0, nullptr, pixels.data(), width * 4, 0);
+    }
+
+    void draw_rect(int x0, int y0, int x1, int y1, int frame) override {
+        fill_rect(pixels.data(), width, height, width * 4, x0, y0, x1, y1, frame);
+        const D3D11_BOX box = { (UINT)x0, (UINT)y0, 0, (UINT)x1, (UINT)y1, 1 };
+        device_context->UpdateSubresource(texture, 0, &box, &pixels[(y0 * width + x0) * 4], width * 4, 0);
+    }
+
+    void bind_target() override {
+        D3D11_VIEWPORT viewport = {};
+        viewport.Width = (float)width;
+        viewport.Height = (float)height;
+        viewport.MaxDepth = 1.0f;
+        device_context->OMSetRenderTargets(1, &rtv, nullptr);
+        device_context->RSSetViewports(1, &viewport);
+    }
+
+    void finish() override {
+        device_context->End(event_query);
+        BOOL done = FALSE;
+        while (device_context->GetData(event_query, &done, sizeof(done), 0) != 0 || !done) {}
+    }
+
+    void read_frame(std::vector<unsigned char>& out) override {
+        out = pixels;
+    }
+
+    // Through a staging copy; only RGBA8 pyramids, the other formats would need converting.
+    bool read_texture(ImTextureID id, int read_width, int read_height, std::vector<unsigned char>& out) override {
+        ID3D11Resource* resource = nullptr;
+        ((ID3D11ShaderResourceView*)id)->GetResource(&resource);
+        ID3D11Texture2D* source = nullptr;
+        const bool is_texture = SUCCEEDED(resource->QueryInterface(__uuidof(ID3D11Texture2D), (void**)&source));
+        resource->Release();
+        if (!is_texture)
+            return false;
+
+        D3D11_TEXTURE2D_DESC desc;
+        source->GetDesc(&desc);
+        ID3D11Texture2D* staging = nullptr;
+        bool result = false;
+        if (desc.Format == DXGI_FORMAT_R8G8B8A8_UNORM || desc.Format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB) {
+            desc.Usage = D3D11_USAGE_STAGING;
+            desc.BindFlags = 0;
+            desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+            desc.MiscFlags = 0;
+            if (SUCCEEDED(device->CreateTexture2D(&desc, nullptr, &staging))) {
+                device_context->CopyResource(staging, source);
+                D3D11_MAPPED_SUBRESOURCE mapped;
+                if (SUCCEEDED(device_context->Map(staging, 0, D3D11_MAP_READ, 0, &mapped))) {
+                    out.resize(read_width * read_height * 4);
+                    for (int y = 0; y < read_height; ++y)
+                        memcpy(&out[y * read_width * 4], (const unsigned char*)mapped.pData + (size_t)y * mapped.RowPitch, read_width * 4);
+                    device_context->Unmap(staging, 0);
+                    result = true;
+                }
+                staging->Release();
+            }
+        }
+        source->Release();
+        return result;
+    }
+
+private:
+    void destroy_target() {
+        if (rtv) { rtv->Release(); rtv = nullptr; }
+        if (texture) { texture->Release(); texture = nullptr; }
+    }
+
+    ID3D11Device* device = nullptr;
+    ID3D11DeviceContext* device_context = nullptr;
+    ID3D11Query* event_query = nullptr;
+    ID3D11Texture2D* texture = nullptr;
+    ID3D11RenderTargetView* rtv = nullptr;
+    ImGui_ImplDX11_RenderState render_state{};
+    int width = 0, height = 0;
+    std::vector<unsigned char> pixels;
+};
+#endif
+
+class PassSample {
+public:
+    int kernel; // blur::Kernel, -1 for a whole chain run by Backend::render_passes()
+    int width, height;
+    double ms;
+};
+
+// Wraps the backend the device set up: counts framebuffer creations and, while 'time_passes' is set, times every
+// pass between two device syncs.
+class TimingBackend : public blur::Backend {
+public:
+    TimingBackend(blur::Backend* inner, Device* device) : inner(inner), device(device) {}
+    ~TimingBackend() override { IM_DELETE(inner); }
+
+    bool create_framebuffer(blur::Framebuffer& framebuffer, int width, int height, blur::Format format) override {
+        ++framebuffers_created;
+        return inner->create_framebuffer(framebuffer, width, height, format);
+    }
+
+    void destroy_framebuffer(blur::Framebuffer& framebuffer) override { inner->destroy_framebuffer(framebuffer); }
+    bool supports_format(blur::Format format) override { return inner->supports_format(format); }
+    ImTextureID get_texture_id(const blur::Framebuffer& framebuffer) override { return inner->get_texture_id(framebuffer); }
+    bool begin_chain(blur::Framebuffer& source) override { return inner->begin_chain(source); }
+    void end_chain() override { inner->end_chain(); }
+
+    void render_pass(const blur::Framebuffer& target, const blur::Framebuffer& input, blur::Kernel kernel, float offset, float noise, const blur::RegionSet& regions) override {
+        if (!time_passes) {
+            inner->render_pass(target, input, kernel, offset, noise, regions);
+            return;
+        }
+
+        device->finish();
+        const Clock::time_point start = Clock::now();
+        inner->render_pass(target, input, kernel, offset, noise, regions);
+        device->finish();
+        passes.push_back({ (int)kernel, target.width, target.height, elapsed_ms(start) });
+    }
+
+    bool render_passes(const blur::Pass* chain_passes, int count, float offset, float noise) override {
+        if (!time_passes)
+            return inner->render_passes(chain_passes, count, offset, noise);
+
+        device->finish();
+        const Clock::time_point start = Clock::now();
+        const bool handled = inner->render_passes(chain_passes, count, offset, noise);
+        if (handled) {
+            device->finish();
+            passes.push_back({ -1, chain_passes[0].target->width, chain_passes[0].target->height, elapsed_ms(start) });
+        }
+        return handled;
+    }
+
+    blur::ContentCheck begin_content_check(void*& state, const blur::Framebuffer& source, const blur::RegionSet& regions, bool allow_skip) override {
+        return inner->begin_content_check(state, source, regions, allow_skip);
+    }
+
+    void end_content_check() override { inner->end_content_check(); }
+    void destroy_content_state(void* state) override { inner->destroy_content_state(state); }
+    blur::KernelCosts kernel_costs() override { return inner->kernel_costs(); }
+
+    int framebuffers_created = 0;
+    bool time_passes = false;
+    std::vector<PassSample> passes;
+
+private:
+    blur::Backend* inner;
+    Device* device;
+};
+
+class Config {
+public:
+    int width, height;
+    int iterations;
+    float scale, offset, noise;
+
+    bool operator==(const Config& other) const {
+        return width == other.width && height == other.height && iterations == other.iterations
+            && scale == other.scale && offset == other.offset && noise == other.noise;
+    }
+};
+
+class Statistics {
+public:
+    double median = 0.0, mean = 0.0, min = 0.0, max = 0.0;
+};
+
+static Statistics summarize(std::vector<double> samples) {
+    Statistics statistics;
+    if (samples.empty())
+        return statistics;
+
+    std::sort(samples.begin(), samples.end());
+    const size_t count = samples.size();
+    statistics.min = samples.front();
+    statistics.max = samples.back();
+    statistics.median = count % 2 ? samples[count / 2] : (samples[count / 2 - 1] + samples[count / 2]) * 0.5;
+    for (double sample : samples)
+        statistics.mean += sample;
+    statistics.mean /= count;
+    return statistics;
+}
+
+class Result {
+public:
+    Config config;
+    Statistics frame_ms;
+    double record_ms = 0.0; // median time spent in process() and render() while building the frame
+    std::vector<PassSample> passes; // median per pass
+    double allocations_per_frame = 0.0;
+    int framebuffers_created = 0; // while switching to this configuration
+    int framebuffers_created_steady = 0; // during the measured frames, should stay 0
+    bool has_baseline = false;
+    double baseline_ms = 0.0;
+};
+
+static int g_frame_index = 0;
+
+// Stands in for the renderer backend: only the blur callbacks do any work.
+static void render_frame(Device& device) {
+    ImGui::Render();
+
+    device.bind_target();
+    ImDrawData* draw_data = ImGui::GetDrawData();
+    for (ImDrawList* list : draw_data->CmdLists) {
+        for (const ImDrawCmd& cmd : list->CmdBuffer) {
+            if (cmd.UserCallback != nullptr && cmd.UserCallback != ImDrawCallback_ResetRenderState)
+                cmd.UserCallback(list, &cmd);
+        }
+    }
+    device.finish();
+
+    blur::garbage_collect();
+}
+
+// One ImGui frame: a blurred modal panel and a title bar strip over the synthetic frame.
+static void run_frame(Device& device, TimingBackend& backend, const Config& config, double* record_ms) {
+    device.draw_frame(g_frame_index++);
+
+    ImGuiIO& io = ImGui::GetIO();
+    io.DisplaySize = ImVec2((float)config.width, (float)config.height);
+    io.DeltaTime = 1.0f / 60.0f;
+    ImGui::NewFrame();
+
+    const Clock::time_point record_start = Clock::now();
+    ImDrawList* draw_list = ImGui::GetBackgroundDrawList();
+    const float w = (float)config.width, h = (float)config.height;
+    blur::process(draw_list, config.iterations, config.offset, config.noise, config.scale);
+    blur::render(draw_list, ImVec2(w * 0.2f, h * 0.2f), ImVec2(w * 0.8f, h * 0.8f), 0xFFFFFFFF, 12.0f);
+    blur::render(draw_list, ImVec2(0.0f, 0.0f), ImVec2(w, h * 0.05f), 0xFFFFFFFF);
+    if (record_ms != nullptr)
+        *record_ms = elapsed_ms(record_start);
+
+    render_frame(device);
+}
+
+static Result run_config(Device& device, TimingBackend& backend, const Config& config, int frames) {
+    Result result;
+    result.config = config;
+
+    const int created_before = backend.framebuffers_created;
+    device.resize(config.width, config.height);
+    for (int i = 0; i < 3; ++i)
+        run_frame(device, backend, config, nullptr);
+    result.framebuffers_created = backend.framebuffers_created - created_before;
+
+    const int steady_before = backend.framebuffers_created;
+    const int allocations_before = g_allocations.load();
+    std::vector<double> frame_ms, record_ms;
+    for (int i = 0; i < frames; ++i) {
+        double record = 0.0;
+        const Clock::time_point start = Clock::now();
+        run_frame(device, backend, config, &record);
+        frame_ms.push_back(elapsed_ms(start));
+        record_ms.push_back(record);
+    }
+    result.allocations_per_frame = (double)(g_allocations.load() - allocations_before) / frames;
+    result.framebuffers_created_steady = backend.framebuffers_created - steady_before;
+    result.frame_ms = summarize(frame_ms);
+    result.record_ms = summarize(record_ms).median;
+
+    // Second round for the per-pass split, the syncs in between would skew the totals above.
+    std::vector<std::vector<double>> pass_ms;
+    backend.time_passes = true;
+    for (int i = 0; i < frames; ++i) {
+        backend.passes.clear();
+        run_frame(device, backend, config, nullptr);
+        if (result.passes.empty()) {
+            result.passes = backend.passes;
+            pass_ms.resize(backend.passes.size());
+        }
+        for (size_t p = 0; p < backend.passes.size() && p < pass_ms.size(); ++p)
+            pass_ms[p].push_back(backend.passes[p].ms);
+    }
+    backend.time_passes = false;
+    for (size_t p = 0; p < result.passes.size(); ++p)
+        result.passes[p].ms = summarize(pass_ms[p]).median;
+    return result;
+}
+
+static void add_config(std::vector<Config>& configs, const Config& config) {
+    for (const Config& existing : configs) {
+        if (existing == config)
+            return;
+    }
+    configs.push_back(config);
+}
+
+static const int g_resolutions[][2] = { { 1280, 720 }, { 1920, 1080 }, { 2560, 1440 }, { 3840, 2160 }, { 7680, 4320 } };
+static const float g_scales[] = { 0.25f, 0.5f, 1.0f };
+static const float g_offsets[] = { 1.0f, 2.0f, 4.0f, 8.0f };
+static const float g_noises[] = { 0.0f, 0.01f, 0.05f };
+
+static std::vector<Config> build_configs(bool full) {
+    std::vector<Config> configs;
+    const Config defaults = { 1920, 1080, 4, 1.0f, 2.0f, 0.01f };
+    if (full) {
+        for (const int* resolution : g_resolutions)
+            for (int iterations = 1; iterations <= 8; ++iterations)
+                for (float scale : g_scales)
+                    for (float offset : g_offsets)
+                        for (float noise : g_noises)
+                            add_config(configs, { resolution[0], resolution[1], iterations, scale, offset, noise });
+        return configs;
+    }
+
+    for (const int* resolution : g_resolutions) {
+        Config config = defaults;
+        config.width = resolution[0];
+        config.height = resolution[1];
+        add_config(configs, config);
+    }
+    for (int iterations = 1; iterations <= 8; ++iterations) {
+        Config config = defaults;
+        config.iterations = iterations;
+        add_config(configs, config);
+    }
+    for (float scale : g_scales) {
+        Config config = defaults;
+        config.scale = scale;
+        add_config(configs, config);
+    }
+    for (float offset : g_offsets) {
+        Config config = defaults;
+        config.offset = offset;
+        add_config(configs, config);
+    }
+    for (float noise : g_noises) {
+        Config config = defaults;
+        config.noise = noise;
+        add_config(configs, config);
+    }
+    return configs;
+}
+
+// Reads back a file written by write_json(), which puts every result on its own line.
+static bool find_number(const char* line, const char* key, double& value) {
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\": ", key);
+    const char* found = strstr(line, pattern);
+    if (found == nullptr)
+        return false;
+    value = strtod(found + strlen(pattern), nullptr);
+    return true;
+}
+
+static bool load_baseline(const char* path, std::vector<Result>& results) {
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr)
+        return false;
+
+    char line[8192];
+    while (fgets(line, sizeof(line), file) != nullptr) {
+        double width, height, iterations, scale, offset, noise, median;
+        if (!find_number(line, "width", width) || !find_number(line, "height", height) || !find_number(line, "iterations", iterations)
+            || !find_number(line, "scale", scale) || !find_number(line, "offset", offset) || !find_number(line, "noise", noise)
+            || !find_number(line, "median", median))
+            continue;
+
+        const Config config = { (int)width, (int)height, (int)iterations, (float)scale, (float)offset, (float)noise };
+        for (Result& result : results) {
+            if (result.config == config) {
+                result.has_baseline = true;
+                result.baseline_ms = median;
+            }
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+static const char* g_kernel_names[] = { "downsample", "upsample", "gaussian_x", "gaussian_y", "box_x", "box_y" };
+static const char* g_algorithm_names[] = { "auto", "kawase", "gaussian", "box" };
+
+static void write_json(FILE* file, Device& device, const std::vector<Result>& results) {
+    fprintf(file, "{\n  \"backend\": \"%s\",\n  \"device\": \"%s\",\n  \"results\": [\n", device.name(), device.description());
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& result = results[i];
+        const Config& config = result.config;
+        fprintf(file, "    { \"width\": %d, \"height\": %d, \"iterations\": %d, \"scale\": %g, \"offset\": %g, \"noise\": %g, ",
+            config.width, config.height, config.iterations, config.scale, config.offset, config.noise);
+        fprintf(file, "\"frame_ms\": { \"median\": %.4f, \"mean\": %.4f, \"min\": %.4f, \"max\": %.4f }, \"record_ms\": %.4f, ",
+            result.frame_ms.median, result.frame_ms.mean, result.frame_ms.min, result.frame_ms.max, result.record_ms);
+        fprintf(file, "\"allocations_per_frame\": %.2f, \"framebuffers_created\": %d, \"framebuffers_created_steady\": %d, ",
+            result.allocations_per_frame, result.framebuffers_created, result.framebuffers_created_steady);
+        if (result.has_baseline) {
+            fprintf(file, "\"baseline_ms\": %.4f, \"change_percent\": %.2f, ",
+                result.baseline_ms, (result.frame_ms.median / result.baseline_ms - 1.0) * 100.0);
+        }
+        fprintf(file, "\"passes\": [");
+        for (size_t p = 0; p < result.passes.size(); ++p) {
+            const PassSample& pass = result.passes[p];
+            const char* kernel = pass.kernel >= 0 ? g_kernel_names[pass.kernel] : "chain";
+            fprintf(file, "%s{ \"kernel\": \"%s\", \"width\": %d, \"height\": %d, \"ms\": %.4f }", p ? ", " : "", kernel, pass.width, pass.height, pass.ms);
+        }
+        fprintf(file, "] }%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+}
+
+static const int g_kernel_width = 1280, g_kernel_height = 720;
+static const float g_kernel_radii[] = { 1.0f, 2.0f, 3.0f, 4.0f, 6.0f, 8.0f, 12.0f, 16.0f, 24.0f, 32.0f, 48.0f, 64.0f };
+// The errors are taken on a grid of this spacing, the reference is too slow to compute everywhere.
+static const int g_error_spacing = 16;
+
+class KernelResult {
+public:
+    blur::Algorithm algorithm;
+    float radius;
+    blur::Algorithm selected; // what Algorithm_Auto would run at this radius
+    Statistics frame_ms;
+    bool has_error = false;
+    double rms_error = 0.0, max_error = 0.0;
+};
+
+static int mirror(int i, int size) {
+    const int period = size * 2;
+    i %= period;
+    if (i < 0) i += period;
+    return i < size ? i : period - 1 - i;
+}
+
+// RGB of a gaussian of 'sigma' pixels over an RGBA8 frame, mirrored at the edges like the backends sample it, at every
+// g_error_spacing pixels starting from half of it. Truncated at four standard deviations rather than the three the
+// kernels stop at, so their truncation counts as error too.
+static void reference_gaussian(const std::vector<unsigned char>& frame, int width, int height, double sigma, std::vector<double>& out) {
+    const int reach = (int)ceil(sigma * 4.0);
+    std::vector<double> weights(reach * 2 + 1);
+    double total = 0.0;
+    for (int d = -reach; d <= reach; ++d)
+        total += weights[d + reach] = exp(-d * d / (2.0 * sigma * sigma));
+    for (double& weight : weights)
+        weight /= total;
+
+    const int columns = width / g_error_spacing, rows = height / g_error_spacing;
+    std::vector<double> horizontal((size_t)height * columns * 3, 0.0);
+    for (int y = 0; y < height; ++y) {
+        for (int i = 0; i < columns; ++i) {
+            double* sum = &horizontal[((size_t)y * columns + i) * 3];
+            const int x = i * g_error_spacing + g_error_spacing / 2;
+            for (int d = -reach; d <= reach; ++d) {
+                const unsigned char* texel = &frame[((size_t)y * width + mirror(x + d, width)) * 4];
+                for (int c = 0; c < 3; ++c)
+                    sum[c] += texel[c] * weights[d + reach];
+            }
+        }
+    }
+
+    out.assign((size_t)rows * columns * 3, 0.0);
+    for (int j = 0; j < rows; ++j) {
+        const int y = j * g_error_spacing + g_error_spacing / 2;
+        for (int i = 0; i < columns; ++i) {
+            double* sum = &out[((size_t)j * columns + i) * 3];
+            for (int d = -reach; d <= reach; ++d) {
+                const double* texel = &horizontal[((size_t)mirror(y + d, height) * columns + i) * 3];
+                for (int c = 0; c < 3; ++c)
+                    sum[c] += texel[c] * weights[d + reach];
+            }
+        }
+    }
+}
+
+// A full display blur of one frame, returning the output texture so it can be read back.
+static ImTextureID run_kernel_frame(Device& device, const blur::AdaptiveParameters& parameters) {
+    device.draw_frame(g_frame_index++);
+
+    ImGuiIO& io = ImGui::GetIO();
+    io.DisplaySize = ImVec2((float)g_kernel_width, (float)g_kernel_height);
+    io.DeltaTime = 1.0f / 60.0f;
+    ImGui::NewFrame();
+
+    const blur::Snapshot snapshot = blur::process(ImGui::GetBackgroundDrawList(), parameters);
+    blur::add_region(snapshot, ImVec2(0.0f, 0.0f), io.DisplaySize);
+    const ImTextureID texture = blur::get_texture(snapshot);
+    render_frame(device);
+    return texture;
+}
+
+static KernelResult run_kernel(Device& device, blur::Algorithm algorithm, float radius, int frames) {
+    KernelResult result;
+    result.algorithm = algorithm;
+    result.radius = radius;
+    result.selected = blur::select_algorithm(radius, g_kernel_width, g_kernel_height);
+
+    blur::AdaptiveParameters parameters;
+    parameters.budget_ms = 0.0f;
+    parameters.radius = radius;
+    parameters.noise = 0.0f;
+    parameters.algorithm = algorithm;
+
+    for (int i = 0; i < 3; ++i)
+        run_kernel_frame(device, parameters);
+    std::vector<double> frame_ms;
+    ImTextureID texture = 0;
+    for (int i = 0; i < frames; ++i) {
+        const Clock::time_point start = Clock::now();
+        texture = run_kernel_frame(device, parameters);
+        frame_ms.push_back(elapsed_ms(start));
+    }
+    result.frame_ms = summarize(frame_ms);
+
+    std::vector<unsigned char> frame, output;
+    if (texture == 0 || !device.read_texture(texture, g_kernel_width, g_kernel_height, output))
+        return result;
+    device.read_frame(frame);
+
+    std::vector<double> reference;
+    reference_gaussian(frame, g_kernel_width, g_kernel_height, radius, reference);
+    const int columns = g_kernel_width / g_error_spacing, rows = g_kernel_height / g_error_spacing;
+    double squares = 0.0;
+    for (int j = 0; j < rows; ++j) {
+        for (int i = 0; i < columns; ++i) {
+            const int x = i * g_error_spacing + g_error_spacing / 2, y = j * g_error_spacing + g_error_spacing / 2;
+            for (int c = 0; c < 3; ++c) {
+                const double error = fabs(output[((size_t)y * g_kernel_width + x) * 4 + c] - reference[((size_t)j * columns + i) * 3 + c]);
+                squares += error * error;
+                result.max_error = std::max(result.max_error, error);
+            }
+        }
+    }
+    result.rms_error = sqrt(squares / (rows * columns * 3));
+    result.has_error = true;
+    return result;
+}
+
+static std::vector<KernelResult> run_kernels(Device& device, TimingBackend& backend, int frames) {
+    std::vector<KernelResult> results;
+    device.resize(g_kernel_width, g_kernel_height);
+    const blur::Algorithm algorithms[] = { blur::Algorithm_Kawase, blur::Algorithm_Gaussian, blur::Algorithm_Box };
+    for (blur::Algorithm algorithm : algorithms) {
+        if (algorithm == blur::Algorithm_Box && backend.kernel_costs().box_axis <= 0.0f)
+            continue;
+        for (float radius : g_kernel_radii) {
+            if (algorithm == blur::Algorithm_Gaussian && radius > blur::max_gaussian_sigma)
+                continue;
+            fprintf(stderr, "%s radius %g\n", g_algorithm_names[algorithm], radius);
+            results.push_back(run_kernel(device, algorithm, radius, frames));
+        }
+    }
+    return results;
+}
+
+static void write_kernels_json(FILE* file, Device& device, const std::vector<KernelResult>& results) {
+    fprintf(file, "{\n  \"backend\": \"%s\",\n  \"device\": \"%s\",\n  \"width\": %d,\n  \"height\": %d,\n  \"kernels\": [\n",
+        device.name(), device.description(), g_kernel_width, g_kernel_height);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const KernelResult& result = results[i];
+        fprintf(file, "    { \"algorithm\": \"%s\", \"radius\": %g, \"selected\": \"%s\", ",
+            g_algorithm_names[result.algorithm], result.radius, g_algorithm_names[result.selected]);
+        fprintf(file, "\"frame_ms\": { \"median\": %.4f, \"mean\": %.4f, \"min\": %.4f, \"max\": %.4f }",
+            result.frame_ms.median, result.frame_ms.mean, result.frame_ms.min, result.frame_ms.max);
+        if (result.has_error)
+            fprintf(file, ", \"rms_error\": %.4f, \"max_error\": %.4f", result.rms_error, result.max_error);
+        fprintf(file, " }%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+}
+
+static const int g_damage_width = 1920, g_damage_height = 1080;
+// What changes every frame of --damage: a spinner, a log line and a chart behind the panel, a clock in the title strip.
+static const int g_damage_rects[][4] = { { 936, 516, 984, 564 }, { 420, 760, 1180, 776 }, { 600, 300, 920, 480 }, { 1800, 8, 1880, 40 } };
+
+class DamageResult {
+public:
+    blur::Algorithm algorithm;
+    float radius;
+    double changed_percent = 0.0;
+    Statistics full_ms, incremental_ms;
+    int frames_compared = 0;
+    long long differing_texels = 0; // over every compared frame
+    int max_difference = 0;
+};
+
+// The damaged rectangles redrawn over the still frame, then the blur with and without ProcessFlags_Incremental as
+// asked. Both read back the whole display, so both results are textures.
+static void run_damage_frame(Device& device, const blur::AdaptiveParameters& parameters, bool incremental, bool full, ImTextureID* textures) {
+    const int frame = g_frame_index++;
+    for (const int* rect : g_damage_rects)
+        device.draw_rect(rect[0], rect[1], rect[2], rect[3], frame);
+
+    ImGuiIO& io = ImGui::GetIO();
+    io.DisplaySize = ImVec2((float)g_damage_width, (float)g_damage_height);
+    io.DeltaTime = 1.0f / 60.0f;
+    ImGui::NewFrame();
+
+    for (int i = 0; i < 2; ++i) {
+        textures[i] = 0;
+        if (!(i == 0 ? incremental : full))
+            continue;
+
+        blur::AdaptiveParameters variant = parameters;
+        variant.flags = i == 0 ? blur::ProcessFlags_Incremental : 0;
+        const blur::Snapshot snapshot = blur::process(ImGui::GetBackgroundDrawList(), variant);
+        blur::add_region(snapshot, ImVec2(0.0f, 0.0f), io.DisplaySize);
+        for (const int* rect : g_damage_rects)
+            blur::add_damage(snapshot, ImVec2((float)rect[0], (float)rect[1]), ImVec2((float)rect[2], (float)rect[3]));
+        textures[i] = blur::get_texture(snapshot);
+    }
+    render_frame(device);
+}
+
+static Statistics time_damage_frames(Device& device, const blur::AdaptiveParameters& parameters, bool incremental, int frames) {
+    ImTextureID textures[2];
+    for (int i = 0; i < 3; ++i)
+        run_damage_frame(device, parameters, incremental, !incremental, textures);
+
+    std::vector<double> frame_ms;
+    for (int i = 0; i < frames; ++i) {
+        const Clock::time_point start = Clock::now();
+        run_damage_frame(device, parameters, incremental, !incremental, textures);
+        frame_ms.push_back(elapsed_ms(start));
+    }
+    return summarize(frame_ms);
+}
+
+static DamageResult run_damage(Device& device, blur::Algorithm algorithm, float radius, int frames) {
+    DamageResult result;
+    result.algorithm = algorithm;
+    result.radius = radius;
+    long long changed = 0;
+    for (const int* rect : g_damage_rects)
+        changed += (long long)(rect[2] - rect[0]) * (rect[3] - rect[1]);
+    result.changed_percent = changed * 100.0 / ((double)g_damage_width * g_damage_height);
+
+    blur::AdaptiveParameters parameters;
+    parameters.budget_ms = 0.0f;
+    parameters.radius = radius;
+    parameters.algorithm = algorithm;
+
+    // The first frame computes both in full, every later one has to match.
+    std::vector<unsigned char> incremental, full;
+    for (int i = 0; i < frames + 1; ++i) {
+        ImTextureID textures[2];
+        run_damage_frame(device, parameters, true, true, textures);
+        if (i == 0 || textures[0] == 0 || textures[1] == 0)
+            continue;
+        if (!device.read_texture(textures[0], g_damage_width, g_damage_height, incremental) || !device.read_texture(textures[1], g_damage_width, g_damage_height, full))
+            break;
+
+        ++result.frames_compared;
+        for (size_t t = 0; t < full.size(); t += 4) {
+            int difference = 0;
+            for (int c = 0; c < 4; ++c)
+                difference = std::max(difference, abs(incremental[t + c] - full[t + c]));
+            result.differing_texels += difference > 0 ? 1 : 0;
+            result.max_difference = std::max(result.max_difference, difference);
+        }
+    }
+
+    result.incremental_ms = time_damage_frames(device, parameters, true, frames);
+    result.full_ms = time_damage_frames(device, parameters, false, frames);
+    return result;
+}
+
+static std::vector<DamageResult> run_damages(Device& device, TimingBackend& backend, int frames) {
+    std::vector<DamageResult> results;
+    device.resize(g_damage_width, g_damage_height);
+    device.draw_frame(g_frame_index);
+
+    const blur::Algorithm algorithms[] = { blur::Algorithm_Kawase, blur::Algorithm_Kawase, blur::Algorithm_Gaussian, blur::Algorithm_Box };
+    const float radii[] = { 8.0f, 32.0f, 4.0f, 16.0f };
+    for (int i = 0; i < IM_ARRAYSIZE(algorithms); ++i) {
+        if (algorithms[i] == blur::Algorithm_Box && backend.kernel_costs().box_axis <= 0.0f)
+            continue;
+        fprintf(stderr, "%s radius %g\n", g_algorithm_names[algorithms[i]], radii[i]);
+        results.push_back(run_damage(device, algorithms[i], radii[i], frames));
+    }
+    return results;
+}
+
+static void write_damage_json(FILE* file, Device& device, const std::vector<DamageResult>& results) {
+    fprintf(file, "{\n  \"backend\": \"%s\",\n  \"device\": \"%s\",\n  \"width\": %d,\n  \"height\": %d,\n  \"damage\": [\n",
+        device.name(), device.description(), g_damage_width, g_damage_height);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const DamageResult& result = results[i];
+        fprintf(file, "    { \"algorithm\": \"%s\", \"radius\": %g, \"changed_percent\": %.2f, ",
+            g_algorithm_names[result.algorithm], result.radius, result.changed_percent);
+        fprintf(file, "\"full_ms\": { \"median\": %.4f, \"min\": %.4f }, \"incremental_ms\": { \"median\": %.4f, \"min\": %.4f }, ",
+            result.full_ms.median, result.full_ms.min, result.incremental_ms.median, result.incremental_ms.min);
+        fprintf(file, "\"frames_compared\": %d, \"differing_texels\": %lld, \"max_difference\": %d }%s\n",
+            result.frames_compared, result.differing_texels, result.max_difference, i + 1 < results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+}
+
+static Device* create_device(const char* name, int cpu_threads) {
+    if (strcmp(name, "cpu") == 0)
+        return new CpuDevice(cpu_threads);
+#ifdef IMGUI_BLUR_BENCHMARK_OPENGL3
+    if (strcmp(name, "opengl3") == 0)
+        return new Gl3Device();
+#endif
+#ifdef IMGUI_BLUR_BENCHMARK_DX11
+    if (strcmp(name, "dx11") == 0)
+        return new Dx11Device();
+#endif
+    return nullptr;
+}
+
+int main(int argc, char** argv) {
+    const char* backend_name = "cpu";
+    const char* output_path = nullptr;
+    const char* baseline_path = nullptr;
+    bool full = false;
+    bool kernels = false;
+    bool damage = false;
+    int frames = 10;
+    int cpu_threads = 0;
+    double threshold = 10.0;
+    for (int i = 1; i < argc; ++i) {
+        const bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--backend") == 0 && has_value) backend_name = argv[++i];
+        else if (strcmp(argv[i], "--sweep") == 0 && has_value) full = strcmp(argv[++i], "full") == 0;
+        else if (strcmp(argv[i], "--frames") == 0 && has_value) frames = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--cpu-threads") == 0 && has_value) cpu_threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--output") == 0 && has_value) output_path = argv[++i];
+        else if (strcmp(argv[i], "--baseline") == 0 && has_value) baseline_path = argv[++i];
+        else if (strcmp(argv[i], "--threshold") == 0 && has_value) threshold = atof(argv[++i]);
+        else if (strcmp(argv[i], "--kernels") == 0) kernels = true;
+        else if (strcmp(argv[i], "--damage") == 0) damage = true;
+        else {
+            fprintf(stderr, "usage: %s [--backend cpu|opengl3|dx11] [--sweep axes|full] [--frames N] [--cpu-threads N]\n"
+                            "       [--output results.json] [--baseline previous.json] [--threshold percent] [--kernels] [--damage]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    ImGui::SetAllocatorFunctions(counting_alloc, counting_free, nullptr);
+    ImGui::CreateContext();
+    ImGuiIO& io = ImGui::GetIO();
+    unsigned char* font_pixels = nullptr;
+    int font_width = 0, font_height = 0;
+    io.Fonts->GetTexDataAsRGBA32(&font_pixels, &font_width, &font_height);
+
+    Device* device = create_device(backend_name, cpu_threads);
+    if (device == nullptr || !device->setup()) {
+        fprintf(stderr, "backend '%s' is not available in this build\n", backend_name);
+        delete device;
+        ImGui::DestroyContext();
+        return 2;
+    }
+
+    TimingBackend* backend = IM_NEW(TimingBackend)(blur::exchange_backend(nullptr), device);
+    blur::exchange_backend(backend);
+
+    if (kernels) {
+        const std::vector<KernelResult> results = run_kernels(*device, *backend, frames);
+        FILE* output = output_path != nullptr ? fopen(output_path, "wb") : stdout;
+        if (output != nullptr) {
+            write_kernels_json(output, *device, results);
+            if (output != stdout)
+                fclose(output);
+        }
+
+        blur::destroy();
+        delete device;
+        ImGui::DestroyContext();
+        return 0;
+    }
+
+    if (damage) {
+        const std::vector<DamageResult> results = run_damages(*device, *backend, frames);
+        FILE* output = output_path != nullptr ? fopen(output_path, "wb") : stdout;
+        if (output != nullptr) {
+            write_damage_json(output, *device, results);
+            if (output != stdout)
+                fclose(output);
+        }
+
+        bool matched = true;
+        for (const DamageResult& result : results)
+            matched = matched && result.frames_compared > 0 && result.differing_texels == 0;
+        blur::destroy();
+        delete device;
+        ImGui::DestroyContext();
+        return matched ? 0 : 1;
+    }
+
+    const std::vector<Config> configs = build_configs(full);
+    std::vector<Result> results;
+    for (size_t i = 0; i < configs.size(); ++i) {
+        const Config& config = configs[i];
+        fprintf(stderr, "[%d/%d] %dx%d iterations %d scale %g offset %g noise %g\n",
+            (int)i + 1, (int)configs.size(), config.width, config.height, config.iterations, config.scale, config.offset, config.noise);
+        results.push_back(run_config(*device, *backend, config, frames));
+    }
+
+    if (baseline_path != nullptr && !load_baseline(baseline_path, results))
+        fprintf(stderr, "cannot read baseline %s\n", baseline_path);
+
+    int regressions = 0;
+    for (const Result& result : results) {
+        if (!result.has_baseline)
+            continue;
+
+        const double change = (result.frame_ms.median / result.baseline_ms - 1.0) * 100.0;
+        if (change > threshold) {
+            ++regressions;
+            fprintf(stderr, "regression: %dx%d iterations %d scale %g offset %g noise %g: %.3f ms -> %.3f ms (%+.1f%%)\n",
+                result.config.width, result.config.height, result.config.iterations, result.config.scale, result.config.offset,
+                result.config.noise, result.baseline_ms, result.frame_ms.median, change);
+        }
+    }
+
+    FILE* output = output_path != nullptr ? fopen(output_path, "wb") : stdout;
+    if (output != nullptr) {
+        write_json(output, *device, results);
+        if (output != stdout)
+            fclose(output);
+    }
+
+    blur::destroy();
+    delete device;
+    ImGui::DestroyContext();
+
+    if (baseline_path != nullptr)
+        fprintf(stderr, "%d of %d configurations regressed by more than %.1f%%\n", regressions, (int)results.size(), threshold);
+    return regressions > 0 ? 1 : 0;
+}
@@ -0,0 +1,67 @@
+// Compiles the D3D11 backend shaders and writes their bytecode as constexpr arrays, see IMGUI_BLUR_PRECOMPILED_SHADERS.
+//
+//   cl /std:c++17 /I. /I<imgui> tools/shadergen.cpp imgui_blur_shader_cache.cpp <imgui>/imgui.cpp d3dcompiler.lib
+//   shadergen imgui_blur_dx11_shaders.inl
+//
+// Rerun it whenever the HLSL changes; stale blobs are detected by their key and compiled at setup() instead.
+
+#include "imgui_blur_dx11_shaders.h"
+
+#include <stdio.h>
+
+#include <chrono>
+
+static void write_identifier(FILE* file, const char* name) {
+    fputs("g_precompiled_", file);
+    for (; *name; ++name)
+        fputc(*name == ' ' ? '_' : *name, file);
+}
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <output.inl>\n", argv[0]);
+        return 1;
+    }
+
+    D3DShaderCompiler compiler;
+    ImVector<unsigned char> bytecode[Dx11Shader_Count];
+    float compile_ms[Dx11Shader_Count];
+    for (int i = 0; i < Dx11Shader_Count; ++i) {
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if (!compiler.compile(g_dx11_shaders[i], bytecode[i])) {
+            fprintf(stderr, "failed to compile %s\n", g_dx11_shaders[i].name);
+            return 1;
+        }
+        compile_ms[i] = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    FILE* file = fopen(argv[1], "w");
+    if (file == nullptr) {
+        fprintf(stderr, "cannot open %s\n", argv[1]);
+        return 1;
+    }
+
+    fprintf(file, "// Generated by tools/shadergen.cpp from imgui_blur_dx11_shaders.h, do not edit.\n\n");
+    for (int i = 0; i < Dx11Shader_Count; ++i) {
+        fputs("static constexpr unsigned char ", file);
+        write_identifier(file, g_dx11_shaders[i].name);
+        fputs("[] = {", file);
+        for (int b = 0; b < bytecode[i].Size; ++b)
+            fprintf(file, "%s0x%02x,", b % 16 == 0 ? "\n    " : " ", bytecode[i][b]);
+        fputs("\n};\n\n", file);
+    }
+
+    fputs("static constexpr blur::PrecompiledShader g_precompiled_shaders[] = {\n", file);
+    for (int i = 0; i < Dx11Shader_Count; ++i) {
+        fprintf(file, "    { \"%s\", 0x%016llxull, ", g_dx11_shaders[i].name, (unsigned long long)blur::shader_key(g_dx11_shaders[i], compiler.version()));
+        write_identifier(file, g_dx11_shaders[i].name);
+        fputs(", sizeof(", file);
+        write_identifier(file, g_dx11_shaders[i].name);
+        fprintf(file, "), %.3ff },\n", compile_ms[i]);
+    }
+    fputs("};\n", file);
+
+    fclose(file);
+    printf("wrote %d shaders to %s\n", (int)Dx11Shader_Count, argv[1]);
+    return 0;
+}